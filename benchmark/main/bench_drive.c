@@ -0,0 +1,302 @@
+#include "bench_drive.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "bench_util.h"
+#include "map_tiles.h"
+
+// Define BENCH_DRIVE_GPX as the path of a GPX file to drive its track instead of the built-in route
+#ifndef BENCH_DRIVE_KMH
+#define BENCH_DRIVE_KMH 50                                          /**< Speed along a GPX track */
+#endif
+#ifndef BENCH_DRIVE_BUDGET_US
+#define BENCH_DRIVE_BUDGET_US 8000                                  /**< Loading budget per frame */
+#endif
+
+#define FRAME_MS 100                                                /**< Simulated time per frame */
+#define GRID 5
+#define CITY_ZOOM 16
+#define HIGHWAY_ZOOM 15
+#define HIGHWAY_KMH 60                                              /**< Zoom out from this speed */
+#define EARTH_RADIUS_M 6371000.0
+#define PI 3.14159265358979323846
+
+/**
+ * @brief Route point; the leg to the next point is driven at kmh
+ */
+typedef struct {
+    double lat;
+    double lon;
+    double kmh;
+} waypoint_t;
+
+// Through a city centre, onto a highway and off into a suburb
+static const waypoint_t builtin_route[] = {
+    { 48.1370, 11.5750, 40 },
+    { 48.1370, 11.5950, 40 },
+    { 48.1500, 11.5950, 100 },
+    { 48.1500, 11.6800, 100 },
+    { 48.1800, 11.7000, 30 },
+    { 48.1850, 11.7100, 0 },
+};
+
+static double distance_m(const waypoint_t* a, const waypoint_t* b)
+{
+    double lat = (a->lat + b->lat) / 2 * PI / 180;
+    double dx = (b->lon - a->lon) * PI / 180 * cos(lat);
+    double dy = (b->lat - a->lat) * PI / 180;
+    return sqrt(dx * dx + dy * dy) * EARTH_RADIUS_M;
+}
+
+static int zoom_for_speed(double kmh)
+{
+    return kmh >= HIGHWAY_KMH ? HIGHWAY_ZOOM : CITY_ZOOM;
+}
+
+static void gps_to_tile(double lat, double lon, int zoom, int* x, int* y)
+{
+    double n = (double)(1 << zoom);
+    double rad = lat * PI / 180;
+    *x = (int)floor((lon + 180) / 360 * n);
+    *y = (int)floor((1 - log(tan(rad) + 1 / cos(rad)) / PI) / 2 * n);
+}
+
+#ifdef BENCH_DRIVE_GPX
+/**
+ * @brief Read the trkpt coordinates of a GPX file
+ * 
+ * @return Waypoints driven at BENCH_DRIVE_KMH (free with free()), NULL on error
+ */
+static waypoint_t* load_gpx(const char* path, int* count)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        printf("drive: cannot open %s\n", path);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* text = (char*)malloc(size + 1);
+    if (!text || fread(text, 1, size, f) != (size_t)size) {
+        printf("drive: cannot read %s\n", path);
+        free(text);
+        fclose(f);
+        return NULL;
+    }
+    text[size] = '\0';
+    fclose(f);
+    
+    int capacity = 0;
+    waypoint_t* points = NULL;
+    *count = 0;
+    for (char* p = strstr(text, "<trkpt"); p; p = strstr(p + 1, "<trkpt")) {
+        char* end = strchr(p, '>');
+        char* lat = strstr(p, "lat=");
+        char* lon = strstr(p, "lon=");
+        if (!end || !lat || !lon || lat > end || lon > end) {
+            continue;
+        }
+        if (*count == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            waypoint_t* grown = (waypoint_t*)realloc(points, capacity * sizeof(waypoint_t));
+            if (!grown) {
+                break;
+            }
+            points = grown;
+        }
+        points[*count].lat = strtod(lat + 5, NULL);
+        points[*count].lon = strtod(lon + 5, NULL);
+        points[*count].kmh = BENCH_DRIVE_KMH;
+        (*count)++;
+    }
+    free(text);
+    if (*count < 2) {
+        printf("drive: %s has no track\n", path);
+        free(points);
+        return NULL;
+    }
+    return points;
+}
+#endif
+
+/**
+ * @brief Write the tiles the grid can show anywhere along the route, at the zoom of each leg
+ * 
+ * @return Number of route samples, which bounds the frame count
+ */
+static int make_route_dataset(const char* base_path, const waypoint_t* route, int count)
+{
+    int frames = 0;
+    int last_x = -1, last_y = -1, last_zoom = -1;
+    int margin = GRID / 2 + 1;
+    for (int i = 0; i + 1 < count; i++) {
+        double length = distance_m(&route[i], &route[i + 1]);
+        double speed = route[i].kmh / 3.6;
+        int steps = speed > 0 ? (int)ceil(length / (speed * FRAME_MS / 1000.0)) : 0;
+        int zoom = zoom_for_speed(route[i].kmh);
+        for (int step = 0; step <= steps; step++) {
+            double t = steps ? (double)step / steps : 0;
+            int x, y;
+            gps_to_tile(route[i].lat + (route[i + 1].lat - route[i].lat) * t,
+                        route[i].lon + (route[i + 1].lon - route[i].lon) * t, zoom, &x, &y);
+            if (x != last_x || y != last_y || zoom != last_zoom) {
+                bench_make_dataset(base_path, "bench_drive", zoom, x - margin, y - margin,
+                                   2 * margin + 1, 2 * margin + 1, false);
+                last_x = x;
+                last_y = y;
+                last_zoom = zoom;
+            }
+        }
+        frames += steps + 1;
+    }
+    return frames;
+}
+
+/**
+ * @brief Plan preloading of the rest of the route at the current zoom
+ */
+static void plan_preload(map_tiles_handle_t handle, const waypoint_t* route, int count, int from)
+{
+    map_tiles_gps_point_t* points = (map_tiles_gps_point_t*)malloc((count - from) * sizeof(map_tiles_gps_point_t));
+    if (!points) {
+        return;
+    }
+    for (int i = from; i < count; i++) {
+        points[i - from].lat = route[i].lat;
+        points[i - from].lon = route[i].lon;
+    }
+    map_tiles_preload_config_t config = { .buffer_m = 500, .zoom_levels_around = 0 };
+    map_tiles_preload_route(handle, points, count - from, &config);
+    free(points);
+}
+
+static void run_drive_case(const char* base_path, const waypoint_t* route, int count, int max_frames,
+                           int cache_tiles, bool preload)
+{
+    int64_t* samples = (int64_t*)malloc(max_frames * sizeof(int64_t));
+    if (!samples) {
+        printf("drive: out of memory\n");
+        return;
+    }
+    size_t heap_base = bench_heap_used();
+    
+    map_tiles_config_t config = {
+        .base_path = base_path,
+        .tile_folders = { "bench_drive" },
+        .tile_type_count = 1,
+        .grid_cols = GRID,
+        .grid_rows = GRID,
+        .default_zoom = zoom_for_speed(route[0].kmh),
+        .use_spiram = true,
+        .default_tile_type = 0,
+        .cache_tiles = cache_tiles,
+    };
+    map_tiles_handle_t handle = map_tiles_init(&config);
+    if (!handle) {
+        printf("drive: init failed\n");
+        free(samples);
+        return;
+    }
+    if (preload) {
+        plan_preload(handle, route, count, 0);
+    }
+    
+    size_t heap_peak = 0;
+    int frames = 0;
+    int stalled = 0;
+    int shown_x = 0, shown_y = 0, shown_zoom = -1;
+    for (int i = 0; i + 1 < count; i++) {
+        double length = distance_m(&route[i], &route[i + 1]);
+        double speed = route[i].kmh / 3.6;
+        int steps = speed > 0 ? (int)ceil(length / (speed * FRAME_MS / 1000.0)) : 0;
+        int zoom = zoom_for_speed(route[i].kmh);
+        if (zoom != map_tiles_get_zoom(handle)) {
+            map_tiles_set_zoom(handle, zoom);
+            if (preload) {
+                plan_preload(handle, route, count, i);
+            }
+        }
+        
+        for (int step = 0; step <= steps && frames < max_frames; step++) {
+            double t = steps ? (double)step / steps : 0;
+            map_tiles_set_center_from_gps(handle, route[i].lat + (route[i + 1].lat - route[i].lat) * t,
+                                          route[i].lon + (route[i + 1].lon - route[i].lon) * t);
+            
+            // Request the grid whenever it moves, as the map screen of an application does
+            int tile_x, tile_y;
+            map_tiles_get_position(handle, &tile_x, &tile_y);
+            if (tile_x != shown_x || tile_y != shown_y || zoom != shown_zoom) {
+                for (int row = 0; row < GRID; row++) {
+                    for (int col = 0; col < GRID; col++) {
+                        map_tiles_request_tile(handle, row * GRID + col, tile_x + col, tile_y + row);
+                    }
+                }
+                shown_x = tile_x;
+                shown_y = tile_y;
+                shown_zoom = zoom;
+            }
+            
+            int64_t start = bench_now_us();
+            map_tiles_process(handle, BENCH_DRIVE_BUDGET_US);
+            samples[frames++] = bench_now_us() - start;
+            
+            // A frame stalls when any slot still shows something other than the tile it should
+            if (map_tiles_requests_pending(handle) > 0) {
+                stalled++;
+            }
+            size_t heap = bench_heap_used();
+            if (heap > heap_peak) {
+                heap_peak = heap;
+            }
+        }
+    }
+    map_tiles_stats_t totals;
+    map_tiles_get_stats(handle, &totals);
+    map_tiles_cleanup(handle);
+    
+    char name[48];
+    snprintf(name, sizeof(name), "drive, cache %d%s", cache_tiles, preload ? ", preload" : "");
+    bench_stats_t stats;
+    bench_stats_compute(samples, frames, &stats);
+    bench_report(name, &stats, 0);
+    printf("  %lu tiles read (%.1f MB, %lu us avg, %lu us peak), %lu cache hits, %lu failed, loading %.1f ms in total\n",
+           (unsigned long)totals.loads, totals.bytes_read / (1024.0 * 1024.0), (unsigned long)totals.load_time_avg_us,
+           (unsigned long)totals.load_time_peak_us, (unsigned long)totals.cache_hits,
+           (unsigned long)totals.load_failures, stats.mean * frames / 1000);
+    printf("  %d stalled frames (%.1f s), heap peak %.1f MB\n", stalled, stalled * FRAME_MS / 1000.0,
+           (heap_peak > heap_base ? heap_peak - heap_base : 0) / (1024.0 * 1024.0));
+    free(samples);
+}
+
+void bench_drive_run(const char* base_path)
+{
+    const waypoint_t* route = builtin_route;
+    int count = sizeof(builtin_route) / sizeof(builtin_route[0]);
+    const char* source = "built-in route";
+#ifdef BENCH_DRIVE_GPX
+    waypoint_t* track = load_gpx(BENCH_DRIVE_GPX, &count);
+    if (!track) {
+        return;
+    }
+    route = track;
+    source = BENCH_DRIVE_GPX;
+#endif
+    
+    int frames = make_route_dataset(base_path, route, count);
+    printf("\n-- Drive (%s, %d frames of %d ms, %d us loading budget) --\n", source, frames, FRAME_MS,
+           BENCH_DRIVE_BUDGET_US);
+    
+    // Keep the per-frame position log out of the timing
+    esp_log_level_set("map_tiles", ESP_LOG_WARN);
+    run_drive_case(base_path, route, count, frames, 0, false);
+    run_drive_case(base_path, route, count, frames, GRID * GRID, false);
+    run_drive_case(base_path, route, count, frames, GRID * GRID, true);
+    esp_log_level_set("map_tiles", ESP_LOG_INFO);
+    
+#ifdef BENCH_DRIVE_GPX
+    free(track);
+#endif
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+/**
+ * @brief Replay a drive along a GPX track or the built-in route and report I/O, stalls and memory
+ * 
+ * @param base_path Base path of the synthetic tile tree
+ */
+void bench_drive_run(const char* base_path);
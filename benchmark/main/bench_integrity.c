@@ -0,0 +1,87 @@
+#include "bench_integrity.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench_util.h"
+#include "map_tiles.h"
+
+#define ITERATIONS 200
+#define BENCH_ZOOM 12
+#define BENCH_X 700
+#define BENCH_Y 1600
+#define BENCH_TILES 4                                               /**< More than a 1x1 grid caches, so every load reads */
+
+static void run_crc_case(int64_t* samples)
+{
+    uint8_t* buf = (uint8_t*)malloc(MAP_TILES_TILE_SIZE * MAP_TILES_TILE_SIZE * MAP_TILES_BYTES_PER_PIXEL);
+    if (!buf) {
+        printf("integrity: out of memory\n");
+        return;
+    }
+    const size_t bytes = MAP_TILES_TILE_SIZE * MAP_TILES_TILE_SIZE * MAP_TILES_BYTES_PER_PIXEL;
+    for (size_t i = 0; i < bytes; i++) {
+        buf[i] = (uint8_t)(i * 31 + (i >> 9));
+    }
+    
+    volatile uint32_t sink = 0;
+    for (int i = 0; i < ITERATIONS; i++) {
+        int64_t start = bench_now_us();
+        sink ^= map_tiles_crc32c(0, buf, bytes);
+        samples[i] = bench_now_us() - start;
+    }
+    (void)sink;
+    
+    bench_stats_t stats;
+    bench_stats_compute(samples, ITERATIONS, &stats);
+    bench_report("crc32c 128KB tile", &stats, (double)bytes);
+    free(buf);
+}
+
+static void run_load_case(const char* base_path, bool verify, int64_t* samples)
+{
+    map_tiles_config_t config = {
+        .base_path = base_path,
+        .tile_folders = { "bench_crc" },
+        .tile_type_count = 1,
+        .grid_cols = 1,
+        .grid_rows = 1,
+        .default_zoom = BENCH_ZOOM,
+        .use_spiram = true,
+        .default_tile_type = 0,
+        .verify_checksums = verify,
+    };
+    map_tiles_handle_t handle = map_tiles_init(&config);
+    if (!handle) {
+        printf("integrity: init failed\n");
+        return;
+    }
+    
+    for (int i = 0; i < ITERATIONS; i++) {
+        int64_t start = bench_now_us();
+        map_tiles_load_tile(handle, 0, BENCH_X + i % BENCH_TILES, BENCH_Y);
+        samples[i] = bench_now_us() - start;
+    }
+    
+    bench_stats_t stats;
+    bench_stats_compute(samples, ITERATIONS, &stats);
+    bench_report(verify ? "load tile, crc32c verified" : "load tile, unverified", &stats,
+                 (double)MAP_TILES_TILE_SIZE * MAP_TILES_TILE_SIZE * MAP_TILES_BYTES_PER_PIXEL);
+    map_tiles_cleanup(handle);
+}
+
+void bench_integrity_run(const char* base_path)
+{
+    bench_make_dataset(base_path, "bench_crc", BENCH_ZOOM, BENCH_X, BENCH_Y, BENCH_TILES, 1, true);
+    
+    int64_t* samples = (int64_t*)malloc(ITERATIONS * sizeof(int64_t));
+    if (!samples) {
+        printf("integrity: out of memory\n");
+        return;
+    }
+    
+    printf("\n-- Tile integrity --\n");
+    run_crc_case(samples);
+    run_load_case(base_path, false, samples);
+    run_load_case(base_path, true, samples);
+    
+    free(samples);
+}
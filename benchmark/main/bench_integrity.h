@@ -0,0 +1,8 @@
+#pragma once
+
+/**
+ * @brief Benchmark CRC32C tile checksums and their cost per tile load
+ * 
+ * @param base_path Base path of the synthetic tile tree
+ */
+void bench_integrity_run(const char* base_path);
@@ -0,0 +1,160 @@
+#include "bench_io.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench_util.h"
+#include "map_tiles.h"
+
+// Size of the synthetic tile tree at BENCH_IO_ZOOM; override to test larger trees
+#ifndef BENCH_IO_COLS
+#define BENCH_IO_COLS 16
+#endif
+#ifndef BENCH_IO_ROWS
+#define BENCH_IO_ROWS 12
+#endif
+
+#define ITERATIONS 200
+#define BENCH_IO_ZOOM 12
+#define BENCH_IO_X 800
+#define BENCH_IO_Y 1500
+#define GRID 5
+#define TILE_BYTES ((double)MAP_TILES_TILE_SIZE * MAP_TILES_TILE_SIZE * MAP_TILES_BYTES_PER_PIXEL)
+
+static map_tiles_handle_t open_handle(const char* base_path, int grid, int cache_tiles)
+{
+    map_tiles_config_t config = {
+        .base_path = base_path,
+        .tile_folders = { "bench_io" },
+        .tile_type_count = 1,
+        .grid_cols = grid,
+        .grid_rows = grid,
+        .default_zoom = BENCH_IO_ZOOM,
+        .use_spiram = true,
+        .default_tile_type = 0,
+        .cache_tiles = cache_tiles,
+    };
+    map_tiles_handle_t handle = map_tiles_init(&config);
+    if (!handle) {
+        printf("io: init failed\n");
+    }
+    return handle;
+}
+
+/**
+ * @brief Load every slot of the grid at a position, as an application does after a move
+ */
+static void load_grid(map_tiles_handle_t handle, int x0, int y0)
+{
+    map_tiles_set_position(handle, x0, y0);
+    for (int row = 0; row < GRID; row++) {
+        for (int col = 0; col < GRID; col++) {
+            map_tiles_load_tile(handle, row * GRID + col, x0 + col, y0 + row);
+        }
+    }
+}
+
+static void report(const char* name, int64_t* samples, double bytes_per_iter)
+{
+    bench_stats_t stats;
+    bench_stats_compute(samples, ITERATIONS, &stats);
+    bench_report(name, &stats, bytes_per_iter);
+}
+
+static void run_single_cases(const char* base_path, int64_t* samples)
+{
+    map_tiles_handle_t handle = open_handle(base_path, 1, 1);
+    if (!handle) {
+        return;
+    }
+    
+    // Every tile of the tree in turn: the cache never has it
+    for (int i = 0; i < ITERATIONS; i++) {
+        int n = i % (BENCH_IO_COLS * BENCH_IO_ROWS);
+        int64_t start = bench_now_us();
+        map_tiles_load_tile(handle, 0, BENCH_IO_X + n % BENCH_IO_COLS, BENCH_IO_Y + n / BENCH_IO_COLS);
+        samples[i] = bench_now_us() - start;
+    }
+    report("single tile, cold", samples, TILE_BYTES);
+    
+    // Two tiles taking turns: both stay cached
+    for (int i = 0; i < ITERATIONS; i++) {
+        int64_t start = bench_now_us();
+        map_tiles_load_tile(handle, 0, BENCH_IO_X + (i & 1), BENCH_IO_Y);
+        samples[i] = bench_now_us() - start;
+    }
+    report("single tile, cache hit", samples, TILE_BYTES);
+    
+    map_tiles_cleanup(handle);
+}
+
+static void run_grid_cases(const char* base_path, int cache_tiles, int64_t* samples)
+{
+    map_tiles_handle_t handle = open_handle(base_path, GRID, cache_tiles);
+    if (!handle) {
+        return;
+    }
+    char name[48];
+    
+    // Two grids without overlap taking turns
+    for (int i = 0; i < ITERATIONS; i++) {
+        int64_t start = bench_now_us();
+        load_grid(handle, BENCH_IO_X + (i & 1) * GRID, BENCH_IO_Y);
+        samples[i] = bench_now_us() - start;
+    }
+    snprintf(name, sizeof(name), "grid %dx%d, cache %d", GRID, GRID, cache_tiles);
+    report(name, samples, GRID * GRID * TILE_BYTES);
+    
+    // One column per step, back and forth across the tree: GRID new tiles per step
+    int span = BENCH_IO_COLS - GRID;
+    for (int i = 0; i < ITERATIONS; i++) {
+        int step = i % (2 * span);
+        int x = step < span ? step : 2 * span - step;
+        int64_t start = bench_now_us();
+        load_grid(handle, BENCH_IO_X + x, BENCH_IO_Y + 1);
+        samples[i] = bench_now_us() - start;
+    }
+    snprintf(name, sizeof(name), "pan east/west, cache %d", cache_tiles);
+    report(name, samples, GRID * TILE_BYTES);
+    
+    // Zoom in and out around the grid centre, as with a zoom button
+    int cx = BENCH_IO_X + GRID / 2;
+    int cy = BENCH_IO_Y + GRID / 2;
+    for (int i = 0; i < ITERATIONS; i++) {
+        bool in = i & 1;
+        int64_t start = bench_now_us();
+        map_tiles_set_zoom(handle, BENCH_IO_ZOOM + in);
+        if (in) {
+            load_grid(handle, cx * 2 - GRID / 2, cy * 2 - GRID / 2);
+        } else {
+            load_grid(handle, BENCH_IO_X, BENCH_IO_Y);
+        }
+        samples[i] = bench_now_us() - start;
+    }
+    map_tiles_set_zoom(handle, BENCH_IO_ZOOM);
+    snprintf(name, sizeof(name), "zoom in/out, cache %d", cache_tiles);
+    report(name, samples, GRID * GRID * TILE_BYTES);
+    
+    map_tiles_cleanup(handle);
+}
+
+void bench_io_run(const char* base_path)
+{
+    int cx = BENCH_IO_X + GRID / 2;
+    int cy = BENCH_IO_Y + GRID / 2;
+    int tiles = bench_make_dataset(base_path, "bench_io", BENCH_IO_ZOOM, BENCH_IO_X, BENCH_IO_Y,
+                                   BENCH_IO_COLS, BENCH_IO_ROWS, false);
+    tiles += bench_make_dataset(base_path, "bench_io", BENCH_IO_ZOOM + 1, cx * 2 - GRID / 2, cy * 2 - GRID / 2,
+                                GRID, GRID, false);
+    
+    int64_t* samples = (int64_t*)malloc(ITERATIONS * sizeof(int64_t));
+    if (!samples) {
+        printf("io: out of memory\n");
+        return;
+    }
+    
+    printf("\n-- Tile loading (%d tiles, %.1f MB) --\n", tiles, tiles * TILE_BYTES / (1024 * 1024));
+    run_single_cases(base_path, samples);
+    run_grid_cases(base_path, 0, samples);
+    run_grid_cases(base_path, GRID * GRID, samples);
+    
+    free(samples);
+}
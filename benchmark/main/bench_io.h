@@ -0,0 +1,8 @@
+#pragma once
+
+/**
+ * @brief Benchmark tile loading: single tiles, full grids, pans and zooms, with and without a cache
+ * 
+ * @param base_path Base path of the synthetic tile tree
+ */
+void bench_io_run(const char* base_path);
@@ -0,0 +1,21 @@
+#include <stdio.h>
+#include "bench_drive.h"
+#include "bench_integrity.h"
+#include "bench_io.h"
+#include "bench_render.h"
+
+#ifndef BENCH_BASE_PATH
+#define BENCH_BASE_PATH "/tmp/map_tiles_bench"
+#endif
+
+void app_main(void)
+{
+    printf("map_tiles benchmark, tiles under %s\n", BENCH_BASE_PATH);
+    
+    bench_io_run(BENCH_BASE_PATH);
+    bench_drive_run(BENCH_BASE_PATH);
+    bench_render_run(BENCH_BASE_PATH);
+    bench_integrity_run(BENCH_BASE_PATH);
+    
+    printf("\nDone\n");
+}
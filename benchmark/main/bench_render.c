@@ -0,0 +1,107 @@
+#include "bench_render.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench_util.h"
+#include "map_tiles.h"
+
+#define OUT_W 800
+#define OUT_H 480
+#define ITERATIONS 200
+#define BENCH_ZOOM 12
+#define BENCH_X 650
+#define BENCH_Y 1580
+#define BENCH_COLS 9
+#define BENCH_ROWS 5
+
+static void run_viewport_case(map_tiles_handle_t handle, const char* name, int src_x, int src_y,
+                              uint16_t* out, int64_t* samples)
+{
+    for (int i = 0; i < ITERATIONS; i++) {
+        int64_t start = bench_now_us();
+        map_tiles_render_viewport(handle, src_x, src_y, (uint8_t*)out, OUT_W, OUT_H, OUT_W * sizeof(uint16_t));
+        samples[i] = bench_now_us() - start;
+    }
+    
+    bench_stats_t stats;
+    bench_stats_compute(samples, ITERATIONS, &stats);
+    bench_report(name, &stats, (double)OUT_W * OUT_H * sizeof(uint16_t));
+}
+
+static void run_scaled_case(map_tiles_handle_t handle, uint32_t scale_q16, map_tiles_filter_t filter,
+                            uint16_t* out, int64_t* samples)
+{
+    for (int i = 0; i < ITERATIONS; i++) {
+        int64_t start = bench_now_us();
+        map_tiles_render_viewport_scaled(handle, 100, 100, scale_q16, filter,
+                                         (uint8_t*)out, OUT_W, OUT_H, OUT_W * sizeof(uint16_t));
+        samples[i] = bench_now_us() - start;
+    }
+    
+    char name[48];
+    snprintf(name, sizeof(name), "scaled %.2fx %s", scale_q16 / (double)MAP_TILES_SCALE_ONE,
+             filter == MAP_TILES_FILTER_BILINEAR ? "bilinear" : "nearest");
+    
+    bench_stats_t stats;
+    bench_stats_compute(samples, ITERATIONS, &stats);
+    bench_report(name, &stats, (double)OUT_W * OUT_H * sizeof(uint16_t));
+}
+
+void bench_render_run(const char* base_path)
+{
+    // 9x5 tiles cover an 800x480 window down to 0.5x scale
+    const int cols = BENCH_COLS, rows = BENCH_ROWS;
+    bench_make_dataset(base_path, "bench", BENCH_ZOOM, BENCH_X, BENCH_Y, cols, rows, false);
+    
+    map_tiles_config_t config = {
+        .base_path = base_path,
+        .tile_folders = { "bench" },
+        .tile_type_count = 1,
+        .grid_cols = cols,
+        .grid_rows = rows,
+        .default_zoom = BENCH_ZOOM,
+        .use_spiram = true,
+        .default_tile_type = 0,
+    };
+    map_tiles_handle_t handle = map_tiles_init(&config);
+    if (!handle) {
+        printf("render: init failed\n");
+        return;
+    }
+    
+    map_tiles_set_position(handle, BENCH_X, BENCH_Y);
+    for (int row = 0; row < rows; row++) {
+        for (int col = 0; col < cols; col++) {
+            map_tiles_load_tile(handle, row * cols + col, BENCH_X + col, BENCH_Y + row);
+        }
+    }
+    
+    uint16_t* out = (uint16_t*)malloc(OUT_W * OUT_H * sizeof(uint16_t));
+    int64_t* samples = (int64_t*)malloc(ITERATIONS * sizeof(int64_t));
+    if (!out || !samples) {
+        printf("render: out of memory\n");
+        free(out);
+        free(samples);
+        map_tiles_cleanup(handle);
+        return;
+    }
+    
+    printf("\n-- Viewport %dx%d --\n", OUT_W, OUT_H);
+    run_viewport_case(handle, "viewport aligned", 0, 0, out, samples);
+    run_viewport_case(handle, "viewport offset (37, 91)", 37, 91, out, samples);
+    run_viewport_case(handle, "viewport odd offset (129, 3)", 129, 3, out, samples);
+    run_viewport_case(handle, "viewport half outside grid", -300, -200, out, samples);
+    
+    static const uint32_t scales[] = {
+        MAP_TILES_SCALE_ONE / 2, MAP_TILES_SCALE_ONE * 3 / 4, MAP_TILES_SCALE_ONE,
+        MAP_TILES_SCALE_ONE * 3 / 2, MAP_TILES_SCALE_ONE * 2,
+    };
+    printf("\n-- Scaled viewport %dx%d --\n", OUT_W, OUT_H);
+    for (size_t i = 0; i < sizeof(scales) / sizeof(scales[0]); i++) {
+        run_scaled_case(handle, scales[i], MAP_TILES_FILTER_NEAREST, out, samples);
+        run_scaled_case(handle, scales[i], MAP_TILES_FILTER_BILINEAR, out, samples);
+    }
+    
+    free(samples);
+    free(out);
+    map_tiles_cleanup(handle);
+}
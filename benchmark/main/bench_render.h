@@ -0,0 +1,8 @@
+#pragma once
+
+/**
+ * @brief Benchmark compositing tiles into one contiguous image
+ * 
+ * @param base_path Base path of the synthetic tile tree
+ */
+void bench_render_run(const char* base_path);
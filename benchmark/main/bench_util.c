@@ -0,0 +1,147 @@
+#include "bench_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#else
+#include "esp_heap_caps.h"
+#endif
+#include "esp_timer.h"
+#include "map_tiles.h"
+
+int64_t bench_now_us(void)
+{
+    return esp_timer_get_time();
+}
+
+size_t bench_heap_used(void)
+{
+#if defined(__GLIBC__)
+    // Host (linux target): large tile buffers are mmapped, so count those too
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+#else
+    return heap_caps_get_total_size(MALLOC_CAP_8BIT) - heap_caps_get_free_size(MALLOC_CAP_8BIT);
+#endif
+}
+
+static int compare_i64(const void* a, const void* b)
+{
+    int64_t x = *(const int64_t*)a;
+    int64_t y = *(const int64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const int64_t* sorted, int count, double p)
+{
+    int index = (int)(p * (count - 1) + 0.5);
+    return (double)sorted[index];
+}
+
+void bench_stats_compute(int64_t* samples, int count, bench_stats_t* stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    if (count <= 0) {
+        return;
+    }
+    
+    qsort(samples, count, sizeof(int64_t), compare_i64);
+    
+    double sum = 0;
+    for (int i = 0; i < count; i++) {
+        sum += (double)samples[i];
+    }
+    
+    stats->min = (double)samples[0];
+    stats->p50 = percentile(samples, count, 0.50);
+    stats->p95 = percentile(samples, count, 0.95);
+    stats->p99 = percentile(samples, count, 0.99);
+    stats->max = (double)samples[count - 1];
+    stats->mean = sum / count;
+}
+
+void bench_report(const char* name, const bench_stats_t* stats, double bytes_per_iter)
+{
+    if (bytes_per_iter > 0 && stats->mean > 0) {
+        printf("%-32s p50 %9.1f us  p95 %9.1f us  p99 %9.1f us  max %9.1f us  %8.1f MB/s\n",
+               name, stats->p50, stats->p95, stats->p99, stats->max, bytes_per_iter / stats->mean);
+    } else {
+        printf("%-32s p50 %9.1f us  p95 %9.1f us  p99 %9.1f us  max %9.1f us\n",
+               name, stats->p50, stats->p95, stats->p99, stats->max);
+    }
+}
+
+static void make_dirs(const char* path)
+{
+    char tmp[256];
+    snprintf(tmp, sizeof(tmp), "%s", path);
+    for (char* p = tmp + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            mkdir(tmp, 0755);
+            *p = '/';
+        }
+    }
+    mkdir(tmp, 0755);
+}
+
+bool bench_write_tile(const char* base_path, const char* folder, int zoom, int x, int y, bool checksum)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s/%d/%d", base_path, folder, zoom, x);
+    make_dirs(path);
+    snprintf(path, sizeof(path), "%s/%s/%d/%d/%d.bin", base_path, folder, zoom, x, y);
+    
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        return false;
+    }
+    
+    // LVGL v9 image header, as written by script/lvgl_map_tile_converter.py
+    uint8_t header[12] = { 0x19, 0x12, 0, checksum ? 0x01 : 0,
+                           MAP_TILES_TILE_SIZE & 0xFF, MAP_TILES_TILE_SIZE >> 8,
+                           MAP_TILES_TILE_SIZE & 0xFF, MAP_TILES_TILE_SIZE >> 8,
+                           (MAP_TILES_TILE_SIZE * 2) & 0xFF, (MAP_TILES_TILE_SIZE * 2) >> 8, 0, 0 };
+    fwrite(header, 1, sizeof(header), f);
+    
+    // Gradient that differs per tile, so seams are visible when inspecting output
+    uint16_t row[MAP_TILES_TILE_SIZE];
+    uint32_t crc = 0;
+    for (int py = 0; py < MAP_TILES_TILE_SIZE; py++) {
+        for (int px = 0; px < MAP_TILES_TILE_SIZE; px++) {
+            uint16_t r = (uint16_t)((x * 7 + px / 8) & 0x1F);
+            uint16_t g = (uint16_t)((y * 5 + py / 4) & 0x3F);
+            uint16_t b = (uint16_t)((zoom + (px ^ py)) & 0x1F);
+            row[px] = (uint16_t)((r << 11) | (g << 5) | b);
+        }
+        fwrite(row, sizeof(uint16_t), MAP_TILES_TILE_SIZE, f);
+        crc = map_tiles_crc32c(crc, row, sizeof(row));
+    }
+    if (checksum) {
+        uint8_t trailer[4] = { (uint8_t)crc, (uint8_t)(crc >> 8), (uint8_t)(crc >> 16), (uint8_t)(crc >> 24) };
+        fwrite(trailer, 1, sizeof(trailer), f);
+    }
+    
+    bool ok = ferror(f) == 0;
+    fclose(f);
+    return ok;
+}
+
+int bench_make_dataset(const char* base_path, const char* folder, int zoom, int x0, int y0, int cols, int rows,
+                       bool checksum)
+{
+    int present = 0;
+    for (int y = y0; y < y0 + rows; y++) {
+        for (int x = x0; x < x0 + cols; x++) {
+            char path[256];
+            struct stat st;
+            snprintf(path, sizeof(path), "%s/%s/%d/%d/%d.bin", base_path, folder, zoom, x, y);
+            if (stat(path, &st) == 0 || bench_write_tile(base_path, folder, zoom, x, y, checksum)) {
+                present++;
+            }
+        }
+    }
+    return present;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Latency distribution of one benchmark case, in microseconds
+ */
+typedef struct {
+    double min;
+    double p50;
+    double p95;
+    double p99;
+    double max;
+    double mean;
+} bench_stats_t;
+
+/**
+ * @brief Current time in microseconds
+ */
+int64_t bench_now_us(void);
+
+/**
+ * @brief Bytes of heap currently allocated, for peak memory tracking
+ */
+size_t bench_heap_used(void);
+
+/**
+ * @brief Compute percentiles of a set of samples (sorts samples in place)
+ * 
+ * @param samples Latency samples in microseconds
+ * @param count Number of samples
+ * @param stats Output statistics
+ */
+void bench_stats_compute(int64_t* samples, int count, bench_stats_t* stats);
+
+/**
+ * @brief Print one result line
+ * 
+ * @param name Case name
+ * @param stats Latency statistics
+ * @param bytes_per_iter Bytes processed per sample, used for MB/s (0 to omit)
+ */
+void bench_report(const char* name, const bench_stats_t* stats, double bytes_per_iter);
+
+/**
+ * @brief Write one synthetic RGB565 tile in the component's file format
+ * 
+ * @param base_path Base path of the tile tree
+ * @param folder Tile type folder
+ * @param zoom Zoom level
+ * @param x Tile X coordinate
+ * @param y Tile Y coordinate
+ * @param checksum Append a CRC32C trailer, as the converter does with --checksum
+ * @return true on success
+ */
+bool bench_write_tile(const char* base_path, const char* folder, int zoom, int x, int y, bool checksum);
+
+/**
+ * @brief Write a rectangle of synthetic tiles, skipping tiles that already exist
+ * 
+ * @return Number of tiles in the rectangle that exist afterwards
+ */
+int bench_make_dataset(const char* base_path, const char* folder, int zoom, int x0, int y0, int cols, int rows,
+                       bool checksum);
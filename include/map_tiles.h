@@ -26,6 +26,73 @@ extern "C" {
 #define MAP_TILES_COLOR_FORMAT LV_COLOR_FORMAT_RGB565
 #define MAP_TILES_MAX_TYPES 8
 #define MAP_TILES_MAX_FOLDER_NAME 32
+#define MAP_TILES_MAX_OVERLAY_FRAMES 32
+#define MAP_TILES_QUARANTINE_SIZE 16                                /**< Bad tiles remembered per handle */
+#define MAP_TILES_SCALE_ONE 0x10000                                 /**< 1.0 in 16.16 fixed point */
+#define MAP_TILES_MAX_ZOOM 30
+#define MAP_TILES_WORLD_SHIFT (MAP_TILES_MAX_ZOOM + 8)              /**< World coordinates are pixels at MAP_TILES_MAX_ZOOM */
+
+/**
+ * @brief Sampling filter for scaled rendering
+ */
+typedef enum {
+    MAP_TILES_FILTER_NEAREST,                                       /**< Nearest neighbour, fastest */
+    MAP_TILES_FILTER_BILINEAR,                                      /**< Bilinear interpolation, smoother */
+} map_tiles_filter_t;
+
+/**
+ * @brief Outcome of one map_tiles_process_step()
+ */
+typedef enum {
+    MAP_TILES_STEP_IDLE,                                            /**< Nothing to load */
+    MAP_TILES_STEP_BUSY,                                            /**< Loading work was done, more may follow */
+    MAP_TILES_STEP_UPDATED,                                         /**< A grid slot shows a new tile (invalidate its image) */
+} map_tiles_step_t;
+
+/**
+ * @brief Position in 64-bit fixed-point world coordinates
+ * 
+ * Units are pixels at MAP_TILES_MAX_ZOOM (2^MAP_TILES_WORLD_SHIFT per world
+ * width), so a point keeps sub-pixel precision at every zoom level and the
+ * pixel at zoom z is obtained exactly by shifting right by MAP_TILES_MAX_ZOOM - z.
+ */
+typedef struct {
+    int64_t x;
+    int64_t y;
+} map_tiles_world_point_t;
+
+/**
+ * @brief Map projection and tile grid of one tile type
+ * 
+ * Tiles follow the usual top-left origin layout: at zoom z a pixel covers
+ * resolution / 2^z projected units, column X grows east from origin_x and
+ * row Y grows south from origin_y. Leave the projection of a tile type NULL
+ * in map_tiles_config_t to use the built-in Web Mercator grid.
+ */
+typedef struct {
+    bool (*forward)(void* ctx, double lat, double lon, double* x, double* y);   /**< GPS degrees to projected units (x east, y north) */
+    bool (*inverse)(void* ctx, double x, double y, double* lat, double* lon);   /**< Projected units to GPS degrees */
+    void* ctx;                                                      /**< Passed to forward and inverse */
+    double origin_x;                                                /**< Projected X of the left edge of column 0 */
+    double origin_y;                                                /**< Projected Y of the top edge of row 0 */
+    double resolution;                                              /**< Projected units per pixel at zoom 0 */
+    int matrix_width;                                               /**< Columns at zoom 0, doubling per level (0: unbounded) */
+    int matrix_height;                                              /**< Rows at zoom 0, doubling per level (0: unbounded) */
+    bool wrap_x;                                                    /**< Columns wrap around (requires matrix_width) */
+} map_tiles_projection_t;
+
+/**
+ * @brief Tile cache handle, shareable between several map tiles handles
+ */
+typedef struct map_tiles_cache_t* map_tiles_cache_handle_t;
+
+/**
+ * @brief Configuration structure for a shared tile cache
+ */
+typedef struct {
+    int capacity_tiles;                                             /**< Tile buffers kept beyond the grids of attached handles */
+    bool use_spiram;                                               /**< Whether to use SPIRAM for tile buffers */
+} map_tiles_cache_config_t;
 
 /**
  * @brief Configuration structure for map tiles
@@ -39,13 +106,166 @@ typedef struct {
     int default_zoom;                                               /**< Default zoom level */
     bool use_spiram;                                               /**< Whether to use SPIRAM for tile buffers */
     int default_tile_type;                                         /**< Default tile type index (0 to tile_type_count-1) */
+    int cache_tiles;                                               /**< Extra tiles kept in the LRU cache beyond the grid (default: 0) */
+    map_tiles_cache_handle_t shared_cache;                         /**< Cache shared with other handles (default: NULL, private cache) */
+    const map_tiles_projection_t* projections[MAP_TILES_MAX_TYPES]; /**< Projection of each tile type (default: NULL, Web Mercator) */
+    const char* dem_folder;                                         /**< Folder of 16-bit elevation tiles for hillshading (default: NULL) */
+    int dem_max_zoom;                                               /**< Deepest zoom with elevation tiles, upsampled beyond (default: 0, every zoom) */
+    int retry_limit;                                                /**< Retries of a truncated or out-of-memory tile per slot (default: 0, none) */
+    int retry_delay_ms;                                             /**< Delay before the first retry, doubled for each further one (default: 0, 100 ms) */
+    bool verify_checksums;                                          /**< Check the CRC32C trailer of tiles that have one (default: false) */
+    int io_burst_ms;                                                /**< Longest a requested tile waits to be read in one burst with others (default: 0, read at once) */
 } map_tiles_config_t;
 
+/**
+ * @brief Load status of a grid slot
+ */
+typedef enum {
+    MAP_TILES_STATUS_EMPTY,                                         /**< Nothing loaded yet */
+    MAP_TILES_STATUS_OK,                                            /**< The slot shows its tile */
+    MAP_TILES_STATUS_PENDING,                                       /**< Waiting for map_tiles_process() */
+    MAP_TILES_STATUS_MISSING,                                       /**< No tile file, or outside the world */
+    MAP_TILES_STATUS_TRUNCATED,                                     /**< Short read; shown zero-filled, retried */
+    MAP_TILES_STATUS_CORRUPT,                                       /**< Not an RGB565 256x256 tile, or its CRC32C trailer does not match (verify_checksums); quarantined */
+    MAP_TILES_STATUS_NO_MEMORY,                                     /**< No tile buffer available; retried */
+} map_tiles_tile_status_t;
+
+/**
+ * @brief Hillshading parameters
+ */
+typedef struct {
+    float azimuth_deg;                                              /**< Sun direction, clockwise from north (e.g. 315) */
+    float altitude_deg;                                             /**< Sun elevation above the horizon (e.g. 45) */
+    float z_factor;                                                 /**< Vertical exaggeration (1.0: true scale) */
+    uint8_t strength;                                               /**< Shading opacity over the base map (0-255) */
+} map_tiles_hillshade_config_t;
+
+/**
+ * @brief Pixel format of time-series overlay tiles
+ */
+typedef enum {
+    MAP_TILES_OVERLAY_I8,                                           /**< 256-colour ARGB8888 palette + 8-bit indices (LV_COLOR_FORMAT_I8) */
+    MAP_TILES_OVERLAY_A8,                                           /**< 8-bit alpha, coloured by the image recolor style (LV_COLOR_FORMAT_A8) */
+} map_tiles_overlay_format_t;
+
+/**
+ * @brief Time-series overlay configuration (e.g. weather radar)
+ */
+typedef struct {
+    const char* folder;                                             /**< Folder under base_path holding {zoom}/{x}/{y}/{time}.bin */
+    map_tiles_overlay_format_t format;                              /**< Pixel format of the overlay tiles */
+    int frame_count;                                                /**< Time steps kept for the grid (1 to MAP_TILES_MAX_OVERLAY_FRAMES) */
+} map_tiles_overlay_config_t;
+
+/**
+ * @brief Label layer configuration
+ */
+typedef struct {
+    const char* folder;                                             /**< Folder under base_path holding {zoom}/{x}/{y}.txt label tiles */
+    const lv_font_t* font;                                          /**< Label font (default: NULL, LV_FONT_DEFAULT) */
+    int max_labels;                                                 /**< Labels shown at once, LVGL objects created up front (default: 0, 32) */
+    int spacing;                                                    /**< Minimum gap between labels in pixels (default: 0) */
+    int32_t view_width;                                             /**< Visible area from screen (0, 0), labels outside are dropped (default: 0, no limit) */
+    int32_t view_height;
+} map_tiles_labels_config_t;
+
+/**
+ * @brief GPS coordinate pair
+ */
+typedef struct {
+    double lat;                                                     /**< Latitude in degrees */
+    double lon;                                                     /**< Longitude in degrees */
+} map_tiles_gps_point_t;
+
+/**
+ * @brief Route preloading options
+ */
+typedef struct {
+    double buffer_m;                                                /**< Corridor half-width around the route in meters */
+    int zoom_levels_around;                                         /**< Also preload this many zoom levels above and below (0: current zoom only) */
+} map_tiles_preload_config_t;
+
+/**
+ * @brief Axis-aligned rectangle in world coordinates (max edges exclusive)
+ */
+typedef struct {
+    int64_t min_x;
+    int64_t min_y;
+    int64_t max_x;
+    int64_t max_y;
+} map_tiles_world_rect_t;
+
 /**
  * @brief Map tiles handle
  */
 typedef struct map_tiles_t* map_tiles_handle_t;
 
+/**
+ * @brief Spatial index of polygons for view queries
+ */
+typedef struct map_tiles_geo_index_t* map_tiles_geo_index_handle_t;
+
+/**
+ * @brief Time-series overlay frames over the grid of a map handle
+ */
+typedef struct map_tiles_overlay_t* map_tiles_overlay_handle_t;
+
+/**
+ * @brief Text labels drawn by LVGL on top of the map tiles
+ */
+typedef struct map_tiles_labels_t* map_tiles_labels_handle_t;
+
+/**
+ * @brief Tile lifecycle and view events
+ */
+typedef enum {
+    MAP_TILES_EVENT_TILE_LOADED,                                    /**< A grid slot shows a new tile: set or invalidate its image */
+    MAP_TILES_EVENT_TILE_FAILED,                                    /**< A slot's tile is missing, corrupt, outside the world or out of memory; the slot is unchanged */
+    MAP_TILES_EVENT_TILE_EVICTED,                                   /**< A slot's tile was released without replacement: hide its image */
+    MAP_TILES_EVENT_VIEW_CHANGED,                                   /**< Zoom, tile type or grid position changed: tiles need loading */
+} map_tiles_event_type_t;
+
+/**
+ * @brief Event passed to the event callback
+ */
+typedef struct {
+    map_tiles_event_type_t type;
+    int index;                                                      /**< Grid slot, -1 for MAP_TILES_EVENT_VIEW_CHANGED */
+    int zoom;                                                       /**< Zoom of the tile, or the new zoom */
+    int tile_x;                                                     /**< Tile coordinates, or the new grid origin */
+    int tile_y;
+} map_tiles_event_t;
+
+/**
+ * @brief Event callback; runs in the context of the map tiles call causing the event
+ */
+typedef void (*map_tiles_event_cb_t)(map_tiles_handle_t handle, const map_tiles_event_t* event, void* ctx);
+
+/**
+ * @brief Snapshot of the screen <-> world <-> GPS mapping of a handle
+ * 
+ * Filled in by map_tiles_get_transform() and evaluated without allocation.
+ * Refresh it whenever the grid position, zoom, tile type or its place on
+ * screen changes. Fields are internal.
+ */
+typedef struct {
+    map_tiles_handle_t handle;
+    int64_t origin_x;                                               /**< World X of screen pixel (0, 0) */
+    int64_t origin_y;                                               /**< World Y of screen pixel (0, 0) */
+    int64_t world_width;                                            /**< Wrap width in world units, 0 if columns do not wrap */
+    int shift;                                                      /**< log2 of world units per screen pixel */
+    
+    // Fast path: series expansion of Web Mercator around the grid centre
+    bool fast;
+    double anchor_lat;
+    double anchor_lon;
+    float anchor_x;
+    float anchor_y;
+    float x_per_deg;                                                /**< Screen pixels per degree of longitude */
+    float y_coef[3];                                                /**< Screen Y offset per radian of latitude offset, orders 1-3 */
+    float lat_coef[3];                                              /**< Radians of latitude offset per screen pixel, orders 1-3 */
+} map_tiles_transform_t;
+
 /**
  * @brief Initialize the map tiles system
  * 
@@ -54,11 +274,33 @@ typedef struct map_tiles_t* map_tiles_handle_t;
  */
 map_tiles_handle_t map_tiles_init(const map_tiles_config_t* config);
 
+/**
+ * @brief Create a tile cache that several map tiles handles can share
+ * 
+ * Handles attach by setting config->shared_cache in map_tiles_init(). They may
+ * use different zoom levels, grid sizes and tile types; a tile loaded by one
+ * handle is served to the others from the same buffer without reading it again.
+ * Each attached handle grows the cache by its grid size plus its cache_tiles.
+ * 
+ * @param config Cache configuration
+ * @return map_tiles_cache_handle_t Handle to the cache, NULL on failure
+ */
+map_tiles_cache_handle_t map_tiles_cache_create(const map_tiles_cache_config_t* config);
+
+/**
+ * @brief Release a shared tile cache
+ * 
+ * The cache is freed once the last attached handle has been cleaned up.
+ * 
+ * @param cache Cache handle
+ */
+void map_tiles_cache_destroy(map_tiles_cache_handle_t cache);
+
 /**
  * @brief Set the zoom level
  * 
  * @param handle Map tiles handle
- * @param zoom_level Zoom level (typically 0-18)
+ * @param zoom_level Zoom level (0 to MAP_TILES_MAX_ZOOM, typically 0-18)
  */
 void map_tiles_set_zoom(map_tiles_handle_t handle, int zoom_level);
 
@@ -124,6 +366,10 @@ const char* map_tiles_get_tile_type_folder(map_tiles_handle_t handle, int tile_t
 /**
  * @brief Load a specific tile dynamically
  * 
+ * tile_x wraps around the antimeridian, so columns past either edge of the
+ * world load the matching tile on the other side and share its cache entry.
+ * Rows beyond the poles fail without touching the file system.
+ * 
  * @param handle Map tiles handle
  * @param index Tile index (0 to total_tile_count-1)
  * @param tile_x Tile X coordinate
@@ -132,9 +378,131 @@ const char* map_tiles_get_tile_type_folder(map_tiles_handle_t handle, int tile_t
  */
 bool map_tiles_load_tile(map_tiles_handle_t handle, int index, int tile_x, int tile_y);
 
+/**
+ * @brief Request a tile for a grid slot without blocking
+ * 
+ * Cached tiles are shown right away. Others are read by map_tiles_process()
+ * in bounded steps, while the slot keeps showing its previous tile. A new
+ * request for the slot replaces the pending one, and map_tiles_load_tile()
+ * cancels it.
+ * 
+ * @param handle Map tiles handle
+ * @param index Tile index (0 to total_tile_count-1)
+ * @param tile_x Tile X coordinate
+ * @param tile_y Tile Y coordinate
+ * @return true if the tile is shown or queued, false if it is outside the world or on error
+ */
+bool map_tiles_request_tile(map_tiles_handle_t handle, int index, int tile_x, int tile_y);
+
+/**
+ * @brief Do queued loading work within a time budget
+ * 
+ * Call once per frame, e.g. from an LVGL timer. Runs map_tiles_process_step()
+ * until budget_us has elapsed or nothing is left, resuming a partially read
+ * tile on the next call. At least one step is done per call.
+ * 
+ * @param handle Map tiles handle
+ * @param budget_us Time budget in microseconds
+ * @return Number of grid slots that show a new tile (invalidate their images)
+ */
+int map_tiles_process(map_tiles_handle_t handle, uint32_t budget_us);
+
+/**
+ * @brief Do one step of queued loading work
+ * 
+ * Each tile goes through open, header, 8KB pixel chunks and publish steps, so
+ * a main loop can interleave tile I/O with rendering at chunk granularity.
+ * Requested grid tiles come first, from the centre out, then the route
+ * preload queue. Hillshading a tile is part of its publish step.
+ * 
+ * @param handle Map tiles handle
+ * @return What the step did; MAP_TILES_STEP_IDLE once there is nothing to load,
+ *         or while requests wait for a burst (see map_tiles_set_io_burst())
+ */
+map_tiles_step_t map_tiles_process_step(map_tiles_handle_t handle);
+
+/**
+ * @brief Get the number of grid tiles still waiting for map_tiles_process()
+ * 
+ * @param handle Map tiles handle
+ * @return Number of requested tiles not shown yet
+ */
+int map_tiles_requests_pending(map_tiles_handle_t handle);
+
+/**
+ * @brief Batch tile reads into bursts so the SD card can sleep in between
+ * 
+ * While storage is idle, map_tiles_process() leaves requested tiles waiting
+ * until the oldest has waited max_latency_ms, then reads all of them in one
+ * burst. Reads that start while storage is still awake from the last one join
+ * the burst right away. Route preloading only runs within bursts, after the
+ * requested tiles. map_tiles_load_tile() always reads at once.
+ * 
+ * @param handle Map tiles handle
+ * @param max_latency_ms Longest wait of a requested tile, 0 to read at once
+ * @return true on success, false on error
+ */
+bool map_tiles_set_io_burst(map_tiles_handle_t handle, int max_latency_ms);
+
+/**
+ * @brief Plan preloading of all tiles along a route
+ * 
+ * Queues every tile within config->buffer_m of the polyline at the current zoom
+ * and tile type, in route order. Any previously planned route is replaced.
+ * Tiles are read by map_tiles_preload_step(), or a chunk at a time by
+ * map_tiles_process() once no requested tile or due retry is waiting, so the
+ * queue never competes with map_tiles_load_tile() or the grid for I/O.
+ * 
+ * Either way the power mode gates the queue (see map_tiles_set_power_mode()):
+ * PERFORMANCE preloads whenever it is called, or only within bursts when
+ * map_tiles_set_io_burst() is set; BALANCED only while storage is still awake
+ * from other reads, and skips tiles not at the current zoom; LOW pauses it.
+ * 
+ * @param handle Map tiles handle
+ * @param route Route polyline
+ * @param point_count Number of points in route
+ * @param config Preloading options
+ * @return true if the preload queue was built, false otherwise
+ */
+bool map_tiles_preload_route(map_tiles_handle_t handle, const map_tiles_gps_point_t* route, int point_count,
+                             const map_tiles_preload_config_t* config);
+
+/**
+ * @brief Read the next queued route tiles into the cache
+ * 
+ * Call this when the application is idle. Preloading pauses, without evicting
+ * them, once the cache holds only tiles that were preloaded but not shown yet;
+ * size the cache with config->cache_tiles. The power mode may also pause it,
+ * see map_tiles_set_power_mode().
+ * 
+ * @param handle Map tiles handle
+ * @param max_tiles Maximum number of tiles to read in this call
+ * @return Number of tiles read from storage
+ */
+int map_tiles_preload_step(map_tiles_handle_t handle, int max_tiles);
+
+/**
+ * @brief Get the number of route tiles still queued for preloading
+ * 
+ * @param handle Map tiles handle
+ * @return Number of queued tiles
+ */
+int map_tiles_preload_pending(map_tiles_handle_t handle);
+
+/**
+ * @brief Drop the planned route preload
+ * 
+ * @param handle Map tiles handle
+ */
+void map_tiles_preload_cancel(map_tiles_handle_t handle);
+
 /**
  * @brief Convert GPS coordinates to tile coordinates
  * 
+ * All coordinate conversions use the projection of the current tile type.
+ * With Web Mercator, longitudes outside -180..180 are wrapped and latitudes are
+ * clamped to +/-85.0511 degrees, so x and y are always within the world.
+ * 
  * @param handle Map tiles handle
  * @param lat Latitude in degrees
  * @param lon Longitude in degrees
@@ -154,6 +522,53 @@ void map_tiles_gps_to_tile_xy(map_tiles_handle_t handle, double lat, double lon,
  */
 void map_tiles_tile_xy_to_gps(map_tiles_handle_t handle, double x, double y, double* lat, double* lon);
 
+/**
+ * @brief Convert GPS coordinates to world coordinates
+ * 
+ * @param handle Map tiles handle
+ * @param lat Latitude in degrees
+ * @param lon Longitude in degrees
+ * @param world Output world position
+ */
+void map_tiles_gps_to_world(map_tiles_handle_t handle, double lat, double lon, map_tiles_world_point_t* world);
+
+/**
+ * @brief Convert world coordinates to GPS coordinates
+ * 
+ * @param handle Map tiles handle
+ * @param world World position
+ * @param lat Output latitude in degrees
+ * @param lon Output longitude in degrees
+ */
+void map_tiles_world_to_gps(map_tiles_handle_t handle, const map_tiles_world_point_t* world, double* lat, double* lon);
+
+/**
+ * @brief Convert world coordinates to map pixel coordinates at the current zoom
+ * 
+ * The result is exact: the tile is pixel >> 8 and the offset within the
+ * tile is pixel & (MAP_TILES_TILE_SIZE - 1), also west or north of a local grid.
+ * Both outputs are set to 0 if the handle or world point is invalid.
+ * 
+ * @param handle Map tiles handle
+ * @param world World position
+ * @param px Output X pixel coordinate (can be NULL)
+ * @param py Output Y pixel coordinate (can be NULL)
+ */
+void map_tiles_world_to_pixel(map_tiles_handle_t handle, const map_tiles_world_point_t* world, int64_t* px, int64_t* py);
+
+/**
+ * @brief Fill in the callbacks of a UTM (WGS84) projection
+ * 
+ * Only forward, inverse and ctx are set; the caller provides the tile grid
+ * (origin in UTM metres, resolution in metres per pixel at zoom 0 and extent).
+ * 
+ * @param zone UTM zone (1-60)
+ * @param north true for the northern hemisphere
+ * @param projection Projection to fill in
+ * @return true on success, false if the zone is invalid
+ */
+bool map_tiles_projection_utm(int zone, bool north, map_tiles_projection_t* projection);
+
 /**
  * @brief Get center GPS coordinates of current map view
  * 
@@ -166,6 +581,9 @@ void map_tiles_get_center_gps(map_tiles_handle_t handle, double* lat, double* lo
 /**
  * @brief Set the tile center from GPS coordinates
  * 
+ * The grid origin column is wrapped into the world, so a grid centered near
+ * longitude +/-180 continues across the antimeridian.
+ * 
  * @param handle Map tiles handle
  * @param lat Latitude in degrees
  * @param lon Longitude in degrees
@@ -182,6 +600,206 @@ void map_tiles_set_center_from_gps(map_tiles_handle_t handle, double lat, double
  */
 bool map_tiles_is_gps_within_tiles(map_tiles_handle_t handle, double lat, double lon);
 
+/**
+ * @brief Convert a batch of GPS coordinates to world coordinates
+ * 
+ * Project geofences once and keep them in world coordinates; the queries
+ * below then work with integer arithmetic and need no further projection.
+ * 
+ * @param handle Map tiles handle
+ * @param points GPS coordinates
+ * @param count Number of points
+ * @param world Output world positions (count entries)
+ * @return true on success, false if a point is outside the projection (set to 0, 0)
+ */
+bool map_tiles_gps_to_world_batch(map_tiles_handle_t handle, const map_tiles_gps_point_t* points, int count,
+                                  map_tiles_world_point_t* world);
+
+/**
+ * @brief Get the area covered by the tile grid in world coordinates
+ * 
+ * Across the antimeridian max_x exceeds the world width; the queries below
+ * wrap points into the view.
+ * 
+ * @param handle Map tiles handle
+ * @param rect Output rectangle
+ */
+void map_tiles_get_view_rect(map_tiles_handle_t handle, map_tiles_world_rect_t* rect);
+
+/**
+ * @brief Test a batch of points against the tile grid area
+ * 
+ * @param handle Map tiles handle
+ * @param points World positions
+ * @param count Number of points
+ * @param inside Output flags, one per point (can be NULL)
+ * @return Number of points inside the view
+ */
+int map_tiles_points_in_view(map_tiles_handle_t handle, const map_tiles_world_point_t* points, int count, bool* inside);
+
+/**
+ * @brief Test whether a polygon overlaps the tile grid area
+ * 
+ * @param handle Map tiles handle
+ * @param polygon Polygon vertices in world coordinates (implicitly closed)
+ * @param count Number of vertices
+ * @return true if the polygon and the view overlap
+ */
+bool map_tiles_polygon_intersects_view(map_tiles_handle_t handle, const map_tiles_world_point_t* polygon, int count);
+
+/**
+ * @brief Signed distance from a point to the nearest edge of the tile grid area
+ * 
+ * @param handle Map tiles handle
+ * @param point World position
+ * @return Distance in pixels at the current zoom, positive inside the view and negative outside
+ */
+double map_tiles_distance_to_view_edge(map_tiles_handle_t handle, const map_tiles_world_point_t* point);
+
+/**
+ * @brief Create a spatial index for polygons
+ * 
+ * Polygons are bucketed into cells the size of a tile at cell_zoom; pick the
+ * zoom at which a typical polygon spans one or two tiles. Its memory counts
+ * towards the handle, so destroy the index before the map handle.
+ * 
+ * @param handle Map tiles handle whose projection the world coordinates use
+ * @param cell_zoom Zoom level defining the cell size (0 to MAP_TILES_MAX_ZOOM)
+ * @return Index handle, NULL on failure
+ */
+map_tiles_geo_index_handle_t map_tiles_geo_index_create(map_tiles_handle_t handle, int cell_zoom);
+
+/**
+ * @brief Add a polygon to the index
+ * 
+ * The vertices are referenced, not copied, and must stay valid until the
+ * index is cleared or destroyed.
+ * 
+ * @param index Index handle
+ * @param id Caller-defined id reported by queries
+ * @param polygon Polygon vertices in world coordinates
+ * @param count Number of vertices
+ * @return true on success, false on allocation failure
+ */
+bool map_tiles_geo_index_add(map_tiles_geo_index_handle_t index, int id, const map_tiles_world_point_t* polygon, int count);
+
+/**
+ * @brief Find the indexed polygons that overlap the tile grid area
+ * 
+ * @param index Index handle
+ * @param handle Map tiles handle defining the view
+ * @param ids Output polygon ids
+ * @param max_ids Capacity of ids
+ * @return Number of overlapping polygons (may exceed max_ids; only max_ids are stored)
+ */
+int map_tiles_geo_index_query_view(map_tiles_geo_index_handle_t index, map_tiles_handle_t handle, int* ids, int max_ids);
+
+/**
+ * @brief Remove all polygons from the index
+ * 
+ * @param index Index handle
+ */
+void map_tiles_geo_index_clear(map_tiles_geo_index_handle_t index);
+
+/**
+ * @brief Destroy a spatial index
+ * 
+ * @param index Index handle
+ */
+void map_tiles_geo_index_destroy(map_tiles_geo_index_handle_t index);
+
+/**
+ * @brief Capture the screen mapping of the current view
+ * 
+ * To keep the GPS position set by map_tiles_set_center_from_gps() at screen
+ * point (cx, cy), place the grid at cx - (cols / 2 * MAP_TILES_TILE_SIZE + marker_offset_x)
+ * and likewise for y.
+ * 
+ * @param handle Map tiles handle
+ * @param grid_screen_x Screen X of the top-left corner of the tile grid
+ * @param grid_screen_y Screen Y of the top-left corner of the tile grid
+ * @param transform Output transform
+ * @return true on success, false on invalid parameters
+ */
+bool map_tiles_get_transform(map_tiles_handle_t handle, int32_t grid_screen_x, int32_t grid_screen_y,
+                             map_tiles_transform_t* transform);
+
+/**
+ * @brief Convert screen pixels to world coordinates (exact)
+ * 
+ * @param transform Transform from map_tiles_get_transform()
+ * @param screen Screen points
+ * @param count Number of points
+ * @param world Output world positions of the centre of each pixel
+ */
+void map_tiles_transform_screen_to_world(const map_tiles_transform_t* transform, const lv_point_t* screen, int count,
+                                         map_tiles_world_point_t* world);
+
+/**
+ * @brief Convert world coordinates to screen pixels (exact)
+ * 
+ * Positions are taken the short way around the world from the view and
+ * clamped to the int32_t range.
+ * 
+ * @param transform Transform from map_tiles_get_transform()
+ * @param world World positions
+ * @param count Number of points
+ * @param screen Output screen points
+ */
+void map_tiles_transform_world_to_screen(const map_tiles_transform_t* transform, const map_tiles_world_point_t* world,
+                                         int count, lv_point_t* screen);
+
+/**
+ * @brief Convert screen pixels to GPS coordinates (exact, double precision)
+ * 
+ * @param transform Transform from map_tiles_get_transform()
+ * @param screen Screen points
+ * @param count Number of points
+ * @param gps Output GPS coordinates
+ */
+void map_tiles_transform_screen_to_gps(const map_tiles_transform_t* transform, const lv_point_t* screen, int count,
+                                       map_tiles_gps_point_t* gps);
+
+/**
+ * @brief Convert GPS coordinates to screen pixels (exact, double precision)
+ * 
+ * @param transform Transform from map_tiles_get_transform()
+ * @param gps GPS coordinates
+ * @param count Number of points
+ * @param screen Output screen points
+ * @return true on success, false if a point is outside the projection
+ */
+bool map_tiles_transform_gps_to_screen(const map_tiles_transform_t* transform, const map_tiles_gps_point_t* gps,
+                                       int count, lv_point_t* screen);
+
+/**
+ * @brief Convert screen pixels to GPS coordinates using single precision
+ * 
+ * Evaluates a local series expansion around the grid centre with float
+ * arithmetic; the error stays well below one pixel for screen-sized areas
+ * from zoom 8 up. Custom projections and lower zoom levels use the exact path.
+ * 
+ * @param transform Transform from map_tiles_get_transform()
+ * @param screen Screen points
+ * @param count Number of points
+ * @param gps Output GPS coordinates
+ */
+void map_tiles_transform_screen_to_gps_fast(const map_tiles_transform_t* transform, const lv_point_t* screen, int count,
+                                            map_tiles_gps_point_t* gps);
+
+/**
+ * @brief Convert GPS coordinates to screen pixels using single precision
+ * 
+ * See map_tiles_transform_screen_to_gps_fast() for accuracy.
+ * 
+ * @param transform Transform from map_tiles_get_transform()
+ * @param gps GPS coordinates
+ * @param count Number of points
+ * @param screen Output screen points
+ */
+void map_tiles_transform_gps_to_screen_fast(const map_tiles_transform_t* transform, const map_tiles_gps_point_t* gps,
+                                            int count, lv_point_t* screen);
+
 /**
  * @brief Get current tile position
  * 
@@ -236,6 +854,190 @@ lv_image_dsc_t* map_tiles_get_image(map_tiles_handle_t handle, int index);
  */
 uint8_t* map_tiles_get_buffer(map_tiles_handle_t handle, int index);
 
+/**
+ * @brief Enable, update or disable hillshading of the base map
+ * 
+ * Requires config->dem_folder. Elevation tiles hold 256x256 little-endian
+ * int16 heights in metres after the usual 12-byte header. Tiles loaded from
+ * now on are shaded while they are read; tiles already shown keep their
+ * previous shading until they are loaded again.
+ * 
+ * @param handle Map tiles handle
+ * @param config Shading parameters, NULL to disable
+ * @return true on success, false on failure
+ */
+bool map_tiles_set_hillshade(map_tiles_handle_t handle, const map_tiles_hillshade_config_t* config);
+
+/**
+ * @brief Create a time-series overlay over the grid of a map handle
+ * 
+ * Every frame holds one overlay tile per grid slot, so an animation loop only
+ * switches image sources and never reads storage. Overlay tiles live in
+ * {base_path}/{folder}/{zoom}/{x}/{y}/{time}.bin on the grid of the current
+ * tile type. Destroy the overlay before the map handle.
+ * 
+ * @param handle Map tiles handle
+ * @param config Overlay configuration
+ * @return Overlay handle on success, NULL on failure
+ */
+map_tiles_overlay_handle_t map_tiles_overlay_create(map_tiles_handle_t handle, const map_tiles_overlay_config_t* config);
+
+/**
+ * @brief Set the time steps shown by the overlay, oldest first
+ * 
+ * Frames whose time is still in the list keep their tiles, so sliding the
+ * window by one step only reads the new step on the next update.
+ * 
+ * @param overlay Overlay handle
+ * @param times Time step names as used in the tile file names (e.g. Unix time)
+ * @param count Number of time steps (at most the configured frame_count)
+ * @return true on success, false on invalid parameters
+ */
+bool map_tiles_overlay_set_times(map_tiles_overlay_handle_t overlay, const int64_t* times, int count);
+
+/**
+ * @brief Read the overlay tiles missing for the current grid position and zoom
+ * 
+ * Call after the map tiles were loaded for a new position, and after
+ * map_tiles_overlay_set_times(). Tiles still covering a slot are moved, not
+ * read again; missing files are remembered and not retried.
+ * 
+ * @param overlay Overlay handle
+ * @return Number of overlay tiles looked up in storage, -1 on failure
+ */
+int map_tiles_overlay_update(map_tiles_overlay_handle_t overlay);
+
+/**
+ * @brief Get the image descriptor of one overlay frame at one grid slot
+ * 
+ * @param overlay Overlay handle
+ * @param frame Frame index, in the order given to map_tiles_overlay_set_times()
+ * @param index Tile index (0 to total_tile_count-1)
+ * @return Pointer to LVGL image descriptor, NULL if the tile does not exist
+ */
+lv_image_dsc_t* map_tiles_overlay_get_image(map_tiles_overlay_handle_t overlay, int frame, int index);
+
+/**
+ * @brief Get the number of time steps currently set
+ * 
+ * @param overlay Overlay handle
+ * @return Number of frames, 0 if error
+ */
+int map_tiles_overlay_get_frame_count(map_tiles_overlay_handle_t overlay);
+
+/**
+ * @brief Destroy an overlay and free its frames
+ * 
+ * @param overlay Overlay handle
+ */
+void map_tiles_overlay_destroy(map_tiles_overlay_handle_t overlay);
+
+/**
+ * @brief Create a label layer over the grid of a map handle
+ * 
+ * Label tiles are text files {base_path}/{folder}/{zoom}/{x}/{y}.txt with one
+ * label per line: "<x> <y> <priority> <text>", x and y in tile pixels (0-255)
+ * of the label centre, priority 0-255 (higher wins when labels collide).
+ * Labels are LVGL label objects created in parent, so they stay upright and
+ * raster tiles can be rendered without text. Destroy the layer before the
+ * map handle.
+ * 
+ * @param handle Map tiles handle
+ * @param parent LVGL parent of the labels, in the screen space of the transforms passed to updates
+ * @param config Label layer configuration
+ * @return Label layer handle on success, NULL on failure
+ */
+map_tiles_labels_handle_t map_tiles_labels_create(map_tiles_handle_t handle, lv_obj_t* parent,
+                                                  const map_tiles_labels_config_t* config);
+
+/**
+ * @brief Read missing label tiles and place the labels for the current view
+ * 
+ * Label tiles still on the grid are kept, so only tiles coming into view are
+ * read. Labels are placed by priority; a label overlapping one already placed
+ * is hidden. Call after the map tiles were loaded for a new position or zoom,
+ * and whenever the transform changes.
+ * 
+ * @param labels Label layer handle
+ * @param transform Current transform from map_tiles_get_transform()
+ * @return Number of labels shown, -1 on failure
+ */
+int map_tiles_labels_update(map_tiles_labels_handle_t labels, const map_tiles_transform_t* transform);
+
+/**
+ * @brief Destroy a label layer and its LVGL objects
+ * 
+ * @param labels Label layer handle
+ */
+void map_tiles_labels_destroy(map_tiles_labels_handle_t labels);
+
+/**
+ * @brief Render a downscaled overview around a GPS position
+ * 
+ * Composes dst_w x dst_h RGB565 pixels, each the box-filtered average of a
+ * scale_div x scale_div block of map pixels at the current zoom and tile type,
+ * centered on the given position. Cached tiles are used directly, shaded when
+ * hillshading has shaded them. Others are streamed unshaded from storage a few
+ * rows at a time, so no 256x256 tile buffer is allocated for the overview.
+ * Missing tiles are rendered black.
+ * 
+ * @param handle Map tiles handle
+ * @param lat Center latitude in degrees
+ * @param lon Center longitude in degrees
+ * @param scale_div Downscale divisor: 1, 2, 4, 8 or 16
+ * @param dst Output buffer in MAP_TILES_COLOR_FORMAT
+ * @param dst_w Output width in pixels
+ * @param dst_h Output height in pixels
+ * @param dst_stride Output row length in bytes
+ * @return true if the overview was rendered, false on invalid parameters
+ */
+bool map_tiles_render_overview(map_tiles_handle_t handle, double lat, double lon, int scale_div,
+                               uint8_t* dst, int dst_w, int dst_h, int dst_stride);
+
+/**
+ * @brief Render the map into one contiguous image
+ * 
+ * Copies a dst_w x dst_h window of the map at the current zoom and tile type
+ * into dst. The window starts src_x, src_y pixels from the top-left corner of
+ * the grid (see map_tiles_get_position()) and may extend past the grid; tiles
+ * are taken from the grid and the cache only, shaded as the grid shows them,
+ * and anything not loaded is rendered black. Typical uses are screenshots,
+ * thumbnails and remote displays.
+ * 
+ * @param handle Map tiles handle
+ * @param src_x Horizontal offset from the grid origin in pixels (may be negative)
+ * @param src_y Vertical offset from the grid origin in pixels (may be negative)
+ * @param dst Output buffer in MAP_TILES_COLOR_FORMAT
+ * @param dst_w Output width in pixels
+ * @param dst_h Output height in pixels
+ * @param dst_stride Output row length in bytes
+ * @return true if the viewport was rendered, false on invalid parameters
+ */
+bool map_tiles_render_viewport(map_tiles_handle_t handle, int src_x, int src_y,
+                               uint8_t* dst, int dst_w, int dst_h, int dst_stride);
+
+/**
+ * @brief Render the map into one contiguous image at a given scale
+ * 
+ * Like map_tiles_render_viewport(), but each map pixel covers scale_q16 / 65536
+ * output pixels, e.g. MAP_TILES_SCALE_ONE / 2 for 0.5x or MAP_TILES_SCALE_ONE * 2
+ * for 2x. This lets one tile set serve displays of different pixel density.
+ * 
+ * @param handle Map tiles handle
+ * @param src_x Horizontal offset of the window from the grid origin in map pixels
+ * @param src_y Vertical offset of the window from the grid origin in map pixels
+ * @param scale_q16 Output pixels per map pixel in 16.16 fixed point (0.25x to 4x)
+ * @param filter Sampling filter
+ * @param dst Output buffer in MAP_TILES_COLOR_FORMAT
+ * @param dst_w Output width in pixels
+ * @param dst_h Output height in pixels
+ * @param dst_stride Output row length in bytes
+ * @return true if the viewport was rendered, false on invalid parameters or allocation failure
+ */
+bool map_tiles_render_viewport_scaled(map_tiles_handle_t handle, int src_x, int src_y,
+                                      uint32_t scale_q16, map_tiles_filter_t filter,
+                                      uint8_t* dst, int dst_w, int dst_h, int dst_stride);
+
 /**
  * @brief Set tile loading error state
  * 
@@ -252,6 +1054,394 @@ void map_tiles_set_loading_error(map_tiles_handle_t handle, bool error);
  */
 bool map_tiles_has_loading_error(map_tiles_handle_t handle);
 
+/**
+ * @brief Get the load status of a grid slot
+ * 
+ * Missing and corrupt tiles are permanent errors. Truncated and out-of-memory
+ * tiles are transient: map_tiles_process() retries them with exponential
+ * backoff, up to retry_limit times, while the view still shows their zoom and
+ * tile type. After a failed load a slot keeps showing its previous tile.
+ * 
+ * @param handle Map tiles handle
+ * @param index Tile index (0 to total_tile_count-1)
+ * @return Slot status, MAP_TILES_STATUS_EMPTY on error
+ */
+map_tiles_tile_status_t map_tiles_get_tile_status(map_tiles_handle_t handle, int index);
+
+/**
+ * @brief Synchronously reload the slots whose transient error is due for a retry
+ * 
+ * For applications using map_tiles_load_tile(); map_tiles_process() retries
+ * on its own. Only failed slots are read again.
+ * 
+ * @param handle Map tiles handle
+ * @return Number of slots reloaded successfully
+ */
+int map_tiles_retry_failed(map_tiles_handle_t handle);
+
+/**
+ * @brief Tile identified by tile type, zoom and coordinates
+ */
+typedef struct {
+    int tile_type;                                                  /**< Tile type index, -1 for another handle's source */
+    int zoom;
+    int tile_x;
+    int tile_y;
+} map_tiles_tile_id_t;
+
+/**
+ * @brief Get the quarantined tiles
+ * 
+ * Tiles with a bad header or checksum are quarantined: they report
+ * MAP_TILES_STATUS_CORRUPT without being read again, until the quarantine is
+ * cleared (e.g. after the tile files were replaced). The list holds the last
+ * MAP_TILES_QUARANTINE_SIZE tiles.
+ * 
+ * @param handle Map tiles handle
+ * @param tiles Output array, NULL to only count
+ * @param max_tiles Size of tiles
+ * @return Number of tiles written, or the number quarantined if tiles is NULL
+ */
+int map_tiles_get_quarantine(map_tiles_handle_t handle, map_tiles_tile_id_t* tiles, int max_tiles);
+
+/**
+ * @brief Clear the quarantine so its tiles are read again
+ * 
+ * @param handle Map tiles handle
+ */
+void map_tiles_clear_quarantine(map_tiles_handle_t handle);
+
+/**
+ * @brief Compute a CRC32C (Castagnoli), as stored in tile checksum trailers
+ * 
+ * Slice-by-8 table implementation. Pass 0 to start and the previous result to
+ * continue over further data.
+ * 
+ * @param crc Result for the preceding data, 0 to start
+ * @param data Data
+ * @param len Length of data in bytes
+ * @return CRC32C of all data so far
+ */
+uint32_t map_tiles_crc32c(uint32_t crc, const void* data, size_t len);
+
+/**
+ * @brief Set the callback for tile lifecycle and view events
+ * 
+ * Replaces polling: the callback learns which slot shows a new tile, so only
+ * that lv_image needs updating. Slots that already show the requested tile
+ * raise no event. The callback must not load tiles or change the view.
+ * 
+ * @param handle Map tiles handle
+ * @param cb Callback, NULL to remove it
+ * @param ctx Passed to the callback
+ */
+void map_tiles_set_event_cb(map_tiles_handle_t handle, map_tiles_event_cb_t cb, void* ctx);
+
+/**
+ * @brief Loading and memory statistics of a handle
+ * 
+ * A hit is a grid tile shown without reading storage, a miss one that had to
+ * be read. Eviction and memory figures belong to the cache, so they cover all
+ * handles sharing it.
+ */
+typedef struct {
+    uint32_t loads;                                                 /**< Tiles read from storage, including preloaded and DEM tiles */
+    uint32_t load_failures;                                         /**< Grid tiles found missing, corrupt, truncated or out of memory */
+    uint64_t bytes_read;                                            /**< Tile bytes read from storage */
+    uint32_t load_time_avg_us;                                      /**< Mean time to read one tile */
+    uint32_t load_time_peak_us;                                     /**< Longest time to read one tile */
+    uint32_t cache_hits;
+    uint32_t cache_misses;
+    uint32_t cache_evictions;                                       /**< Cached tiles dropped to make room for others */
+    size_t memory_spiram;                                           /**< Bytes of cache tile buffers in PSRAM */
+    size_t memory_internal;                                         /**< Bytes of cache tile buffers in internal RAM */
+    int cache_tiles;                                                /**< Tile buffers allocated in the cache */
+    int cache_capacity;                                             /**< Maximum tile buffers of the cache */
+    int requests_pending;                                           /**< Grid tiles waiting for map_tiles_process() */
+    int preload_pending;                                            /**< Route tiles queued for preloading */
+    uint32_t io_bursts;                                             /**< Runs of tile I/O separated by idle storage */
+    uint32_t io_bursts_per_min;                                     /**< io_bursts per minute since init or reset (plain count in the first minute) */
+} map_tiles_stats_t;
+
+/**
+ * @brief Get the loading and memory statistics
+ * 
+ * Counters accumulate from map_tiles_init() or the last map_tiles_reset_stats().
+ * Cheap enough to call every frame.
+ * 
+ * @param handle Map tiles handle
+ * @param stats Output statistics
+ * @return true on success, false on error
+ */
+bool map_tiles_get_stats(map_tiles_handle_t handle, map_tiles_stats_t* stats);
+
+/**
+ * @brief Reset the statistics counters, including those of the cache
+ * 
+ * @param handle Map tiles handle
+ */
+void map_tiles_reset_stats(map_tiles_handle_t handle);
+
+/**
+ * @brief Heap categories of map_tiles_get_memory()
+ */
+typedef enum {
+    MAP_TILES_MEM_TILE_BUFFERS,                                     /**< Pixels of cached map, shaded and DEM tiles */
+    MAP_TILES_MEM_CACHE,                                            /**< Cache bookkeeping: entry records, LRU index and source paths */
+    MAP_TILES_MEM_DESCRIPTORS,                                      /**< Handle, image descriptors and path strings */
+    MAP_TILES_MEM_INDICES,                                          /**< Grid slot tables, request order, preload queue and geo indices */
+    MAP_TILES_MEM_HILLSHADE,                                        /**< Shading lookup table and shade buffers */
+    MAP_TILES_MEM_OVERLAYS,                                         /**< Time-series overlay frames and tiles */
+    MAP_TILES_MEM_LABELS,                                           /**< Label tiles and label object tables */
+    MAP_TILES_MEM_SCRATCH,                                          /**< Temporary buffers of rendering calls */
+    MAP_TILES_MEM_FETCH,                                            /**< Fetch queue, paths and local backend buffers */
+    MAP_TILES_MEM_CATEGORY_COUNT,
+} map_tiles_mem_category_t;
+
+/**
+ * @brief Heap bytes of one category
+ */
+typedef struct {
+    size_t current;                                                 /**< Bytes allocated now */
+    size_t peak;                                                    /**< Most bytes allocated at once (an upper bound, see map_tiles_get_memory()) */
+} map_tiles_mem_usage_t;
+
+/**
+ * @brief Heap usage of a handle and its cache
+ */
+typedef struct {
+    map_tiles_mem_usage_t categories[MAP_TILES_MEM_CATEGORY_COUNT];
+    map_tiles_mem_usage_t total;                                    /**< Peak is the sum of the handle's, the cache's and the fetcher's peaks */
+} map_tiles_memory_t;
+
+/**
+ * @brief Get the heap usage of a handle per category
+ * 
+ * Counts the bytes requested from the heap, without allocator overhead, for
+ * the handle, its overlays, label layers and geo indices, its cache and its
+ * fetcher. A shared cache or fetcher is counted in full for every handle using it.
+ * The handle, the cache and the fetcher each track their own peaks, which are
+ * summed here. They need not have peaked at the same time, so a peak is an
+ * upper bound on the bytes allocated at once; the current figures are exact.
+ * map_tiles_reset_stats() also resets the peaks to the current usage.
+ * 
+ * @param handle Map tiles handle
+ * @param memory Output usage
+ * @return true on success, false on error
+ */
+bool map_tiles_get_memory(map_tiles_handle_t handle, map_tiles_memory_t* memory);
+
+/**
+ * @brief Create a debug overlay showing the statistics and heap total on screen
+ * 
+ * A small semi-transparent label in the top left corner of parent, refreshed
+ * by an LVGL timer. Delete it with lv_obj_delete(); the handle must outlive it.
+ * 
+ * @param handle Map tiles handle
+ * @param parent Parent object, e.g. the map screen
+ * @param period_ms Refresh period in milliseconds (0 for 500)
+ * @return Overlay label, NULL on failure
+ */
+lv_obj_t* map_tiles_stats_overlay_create(map_tiles_handle_t handle, lv_obj_t* parent, uint32_t period_ms);
+
+/**
+ * @brief Power policy of a handle's storage access
+ */
+typedef enum {
+    MAP_TILES_POWER_PERFORMANCE,                                    /**< Preload whenever idle, full cache (default) */
+    MAP_TILES_POWER_BALANCED,                                       /**< Preload the current zoom only, and only while storage is awake anyway */
+    MAP_TILES_POWER_LOW,                                            /**< No preloading, half of cache_tiles released */
+} map_tiles_power_mode_t;
+
+/**
+ * @brief Set the power policy
+ * 
+ * Lets the SD card sleep longer on battery. In balanced mode, route preloading
+ * only continues a burst of grid tile reads, so the card is woken once for
+ * both; route tiles at other zoom levels are skipped. Low-power mode suspends
+ * preloading, keeping the planned route for a later mode, and releases the
+ * least recently used half of the handle's cache_tiles. Watch the effect with
+ * the io_bursts_per_min statistic.
+ * 
+ * @param handle Map tiles handle
+ * @param mode Power mode
+ * @return true on success, false on error (the mode is unchanged)
+ */
+bool map_tiles_set_power_mode(map_tiles_handle_t handle, map_tiles_power_mode_t mode);
+
+/**
+ * @brief Get the power policy
+ * 
+ * @param handle Map tiles handle
+ * @return Current power mode
+ */
+map_tiles_power_mode_t map_tiles_get_power_mode(map_tiles_handle_t handle);
+
+/**
+ * @brief Tile fetcher handle
+ */
+typedef struct map_tiles_fetch_t* map_tiles_fetch_handle_t;
+
+/**
+ * @brief One tile to fetch from a backend
+ */
+typedef struct {
+    uint32_t id;                                                    /**< Pass to map_tiles_fetch_complete() */
+    const char* folder;                                             /**< Tile folder, e.g. "street"; valid until completion */
+    int zoom;
+    int x;
+    int y;
+} map_tiles_fetch_tile_t;
+
+/**
+ * @brief Source of tiles missing on the card, e.g. an HTTP client for a local gateway
+ * 
+ * start() begins fetching and returns at once; the backend later calls
+ * map_tiles_fetch_complete() with the tile file contents, from any task or
+ * from poll(). The fetcher limits how many fetches run at once.
+ */
+typedef struct {
+    bool (*start)(void* ctx, map_tiles_fetch_handle_t fetch, const map_tiles_fetch_tile_t* tile);   /**< Begin a fetch; false if it cannot start */
+    void (*poll)(void* ctx, map_tiles_fetch_handle_t fetch);        /**< Optional: make progress, from map_tiles_fetch_poll() */
+    void (*destroy)(void* ctx);                                     /**< Optional: free ctx, from map_tiles_fetch_destroy() */
+    void* ctx;
+} map_tiles_fetch_backend_t;
+
+/**
+ * @brief Tile fetcher configuration
+ */
+typedef struct {
+    const char* base_path;                                          /**< Where fetched tiles are written; the base_path of the handles using it */
+    map_tiles_fetch_backend_t backend;
+    int max_concurrent;                                             /**< Fetches running at once (default: 0, 2) */
+    int max_queued;                                                 /**< Fetches waiting to start (default: 0, 64) */
+} map_tiles_fetch_config_t;
+
+/**
+ * @brief Fetch latency and throughput statistics
+ * 
+ * Latency runs from map_tiles_fetch_request() until the tile is on the card,
+ * fetch time from the backend's start() until map_tiles_fetch_complete().
+ */
+typedef struct {
+    uint32_t requests;                                              /**< Tiles queued for fetching */
+    uint32_t coalesced;                                             /**< Requests for a tile already queued or being fetched */
+    uint32_t rejected;                                              /**< Requests dropped because the queue was full */
+    uint32_t fetched;                                               /**< Tiles written to the card */
+    uint32_t failed;                                                /**< Fetches that failed or could not be written */
+    uint64_t bytes_written;
+    uint32_t latency_avg_us;
+    uint32_t latency_peak_us;
+    uint32_t fetch_time_avg_us;
+    uint32_t fetch_time_peak_us;
+    int queued;                                                     /**< Fetches waiting to start */
+    int in_flight;                                                  /**< Fetches started and not complete */
+} map_tiles_fetch_stats_t;
+
+/**
+ * @brief Create a tile fetcher
+ * 
+ * Fetched tiles are written through to the card in the z/x/y layout of
+ * map_tiles_load_tile(), so they are read from the card from then on. The
+ * fetcher takes over the backend and destroys it with itself.
+ * 
+ * @param config Fetcher configuration
+ * @return Fetcher handle, NULL on failure
+ */
+map_tiles_fetch_handle_t map_tiles_fetch_create(const map_tiles_fetch_config_t* config);
+
+/**
+ * @brief Make a backend that serves tile files from a local directory
+ * 
+ * A stand-in for a tile server in tests and on the bench: it fetches
+ * "<root_path>/<folder>/<z>/<x>/<y>.bin", completing the fetches started since
+ * the last map_tiles_fetch_poll() on the next one.
+ * 
+ * @param root_path Directory laid out like a tile card
+ * @param backend Output backend for map_tiles_fetch_config_t
+ * @return true on success, false on failure
+ */
+bool map_tiles_fetch_local_backend(const char* root_path, map_tiles_fetch_backend_t* backend);
+
+/**
+ * @brief Queue a tile for fetching
+ * 
+ * A request for a tile that is already queued or being fetched is merged into
+ * it. Demand requests start before preloading ones.
+ * 
+ * @param fetch Fetcher handle
+ * @param folder Tile folder
+ * @param zoom Zoom level
+ * @param x Tile X coordinate
+ * @param y Tile Y coordinate
+ * @param demand true for a tile on screen, false for preloading
+ * @return true if the tile is queued or being fetched, false if the queue is full
+ */
+bool map_tiles_fetch_request(map_tiles_fetch_handle_t fetch, const char* folder, int zoom, int x, int y, bool demand);
+
+/**
+ * @brief Start queued fetches up to the concurrency limit and poll the backend
+ * 
+ * map_tiles_process() calls this for the fetcher of its handle; call it
+ * yourself when loading with map_tiles_load_tile().
+ * 
+ * @param fetch Fetcher handle
+ */
+void map_tiles_fetch_poll(map_tiles_fetch_handle_t fetch);
+
+/**
+ * @brief Deliver the result of a fetch
+ * 
+ * Writes the tile to the card through a temporary file, so readers never see
+ * a partial tile. May be called from any task.
+ * 
+ * @param fetch Fetcher handle
+ * @param id Id of the fetched tile
+ * @param data Tile file contents, NULL if the fetch failed
+ * @param size Size of data in bytes
+ */
+void map_tiles_fetch_complete(map_tiles_fetch_handle_t fetch, uint32_t id, const uint8_t* data, size_t size);
+
+/**
+ * @brief Get the fetch statistics
+ * 
+ * @param fetch Fetcher handle
+ * @param stats Output statistics
+ * @return true on success, false on error
+ */
+bool map_tiles_fetch_get_stats(map_tiles_fetch_handle_t fetch, map_tiles_fetch_stats_t* stats);
+
+/**
+ * @brief Reset the fetch statistics counters
+ * 
+ * @param fetch Fetcher handle
+ */
+void map_tiles_fetch_reset_stats(map_tiles_fetch_handle_t fetch);
+
+/**
+ * @brief Destroy a tile fetcher and its backend
+ * 
+ * Detach it from all handles first. Fetches still running are dropped; the
+ * backend must not complete them afterwards.
+ * 
+ * @param fetch Fetcher handle
+ */
+void map_tiles_fetch_destroy(map_tiles_fetch_handle_t fetch);
+
+/**
+ * @brief Fetch tiles missing on the card
+ * 
+ * Grid tiles that map_tiles_process() finds missing wait for the fetch and
+ * are then read from the card; route tiles missing while preloading are
+ * fetched onto the card for later. map_tiles_load_tile() only queues the
+ * fetch and reports the tile missing. Several handles may use one fetcher.
+ * 
+ * @param handle Map tiles handle
+ * @param fetch Fetcher handle, NULL to stop fetching
+ * @return true on success, false on error
+ */
+bool map_tiles_set_fetch(map_tiles_handle_t handle, map_tiles_fetch_handle_t fetch);
+
 /**
  * @brief Clean up and free map tiles resources
  * 
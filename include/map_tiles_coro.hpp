@@ -0,0 +1,115 @@
+#pragma once
+
+/**
+ * @brief C++20 coroutine wrapper around map_tiles_process_step()
+ * 
+ * For single-threaded targets and host builds where loading is driven from
+ * the main loop: each resume of a load task does one loading step (open,
+ * header, one 8KB chunk or publish) and suspends, so rendering can run
+ * between chunks. Only available when compiled as C++20 with <coroutine>.
+ */
+
+#include "map_tiles.h"
+
+#if defined(__cplusplus) && __cplusplus >= 202002L && __has_include(<coroutine>)
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+namespace map_tiles {
+
+/**
+ * @brief Resumable task yielding the outcome of each loading step
+ */
+class load_task {
+public:
+    struct promise_type {
+        map_tiles_step_t step = MAP_TILES_STEP_IDLE;
+
+        load_task get_return_object() { return load_task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        std::suspend_always yield_value(map_tiles_step_t value) noexcept
+        {
+            step = value;
+            return {};
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+
+    load_task(load_task&& other) noexcept : coro_(std::exchange(other.coro_, nullptr)) {}
+    load_task& operator=(load_task&& other) noexcept
+    {
+        if (this != &other) {
+            if (coro_) {
+                coro_.destroy();
+            }
+            coro_ = std::exchange(other.coro_, nullptr);
+        }
+        return *this;
+    }
+    load_task(const load_task&) = delete;
+    load_task& operator=(const load_task&) = delete;
+    ~load_task()
+    {
+        if (coro_) {
+            coro_.destroy();
+        }
+    }
+
+    /**
+     * @brief Run one loading step
+     * 
+     * @return false once the task has finished, true otherwise
+     */
+    bool resume()
+    {
+        if (!coro_ || coro_.done()) {
+            return false;
+        }
+        coro_.resume();
+        return !coro_.done();
+    }
+
+    /**
+     * @brief Check whether the task has finished
+     */
+    bool done() const { return !coro_ || coro_.done(); }
+
+    /**
+     * @brief Check whether the last step showed a new tile in a grid slot
+     */
+    bool updated() const { return coro_ && !coro_.done() && coro_.promise().step == MAP_TILES_STEP_UPDATED; }
+
+private:
+    explicit load_task(std::coroutine_handle<promise_type> coro) : coro_(coro) {}
+
+    std::coroutine_handle<promise_type> coro_;
+};
+
+/**
+ * @brief Load the requested tiles, then the route preload queue, one step per resume
+ * 
+ * The task finishes when there is nothing left to load, or when requests wait
+ * for an I/O burst; start a new one after the next map_tiles_request_tile()
+ * calls or on a later frame. The handle must outlive the task.
+ * 
+ * @param handle Map tiles handle
+ * @return Task suspended before its first step
+ */
+inline load_task load(map_tiles_handle_t handle)
+{
+    for (;;) {
+        map_tiles_step_t step = map_tiles_process_step(handle);
+        if (step == MAP_TILES_STEP_IDLE) {
+            co_return;
+        }
+        co_yield step;
+    }
+}
+
+} // namespace map_tiles
+
+#endif
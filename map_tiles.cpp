@@ -1,39 +1,14 @@
-#include "map_tiles.h"
+#include "map_tiles_internal.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include "esp_log.h"
 #include "esp_heap_caps.h"
+#include "esp_timer.h"
 
 static const char* TAG = "map_tiles";
 
-// Internal structure for map tiles instance
-struct map_tiles_t {
-    // Configuration
-    char* base_path;
-    char* tile_folders[MAP_TILES_MAX_TYPES];
-    int tile_type_count;
-    int current_tile_type;
-    int grid_cols;
-    int grid_rows;
-    int tile_count;
-    int zoom;
-    bool use_spiram;
-    bool initialized;
-    
-    // Tile management
-    int tile_x;
-    int tile_y;
-    int marker_offset_x;
-    int marker_offset_y;
-    bool tile_loading_error;
-    
-    // Tile data - arrays will be allocated dynamically based on actual grid size
-    uint8_t** tile_bufs;
-    lv_image_dsc_t* tile_imgs;
-};
-
 map_tiles_handle_t map_tiles_init(const map_tiles_config_t* config)
 {
     if (!config || !config->base_path || config->tile_type_count <= 0 || 
@@ -59,45 +34,60 @@ map_tiles_handle_t map_tiles_init(const map_tiles_config_t* config)
     
     int tile_count = grid_cols * grid_rows;
     
+    int zoom = config->default_zoom;
+    if (zoom < 0 || zoom > MAP_TILES_MAX_ZOOM) {
+        zoom = zoom < 0 ? 0 : MAP_TILES_MAX_ZOOM;
+        ESP_LOGW(TAG, "Invalid default_zoom %d, using %d", config->default_zoom, zoom);
+    }
+    
     // Validate that all tile folders are provided
     for (int i = 0; i < config->tile_type_count; i++) {
         if (!config->tile_folders[i]) {
             ESP_LOGE(TAG, "Tile folder %d is NULL", i);
             return NULL;
         }
+        if (config->projections[i] && !map_tiles_projection_valid(config->projections[i])) {
+            ESP_LOGE(TAG, "Invalid projection for tile type %d", i);
+            return NULL;
+        }
     }
     
-    map_tiles_handle_t handle = (map_tiles_handle_t)calloc(1, sizeof(struct map_tiles_t));
+    map_tiles_handle_t handle = (map_tiles_handle_t)map_tiles_mem_calloc(NULL, MAP_TILES_MEM_DESCRIPTORS, 1,
+                                                                         sizeof(struct map_tiles_t), 0);
     if (!handle) {
         ESP_LOGE(TAG, "Failed to allocate handle");
         return NULL;
     }
+    map_tiles_mem_assign(handle, &handle->memory);
     
     // Copy base path
-    handle->base_path = strdup(config->base_path);
+    handle->base_path = map_tiles_mem_strdup(&handle->memory, MAP_TILES_MEM_DESCRIPTORS, config->base_path);
     if (!handle->base_path) {
         ESP_LOGE(TAG, "Failed to allocate base path");
-        free(handle);
+        map_tiles_mem_free(handle);
         return NULL;
     }
     
     // Copy tile folder names
     handle->tile_type_count = config->tile_type_count;
     for (int i = 0; i < config->tile_type_count; i++) {
-        handle->tile_folders[i] = strdup(config->tile_folders[i]);
+        handle->tile_folders[i] = map_tiles_mem_strdup(&handle->memory, MAP_TILES_MEM_DESCRIPTORS, config->tile_folders[i]);
         if (!handle->tile_folders[i]) {
             ESP_LOGE(TAG, "Failed to allocate tile folder %d", i);
             // Clean up previously allocated folders
             for (int j = 0; j < i; j++) {
-                free(handle->tile_folders[j]);
+                map_tiles_mem_free(handle->tile_folders[j]);
             }
-            free(handle->base_path);
-            free(handle);
+            map_tiles_mem_free(handle->base_path);
+            map_tiles_mem_free(handle);
             return NULL;
         }
+        if (config->projections[i]) {
+            handle->projections[i] = *config->projections[i];
+        }
     }
     
-    handle->zoom = config->default_zoom;
+    handle->zoom = zoom;
     handle->use_spiram = config->use_spiram;
     handle->current_tile_type = config->default_tile_type;
     handle->grid_cols = grid_cols;
@@ -105,28 +95,72 @@ map_tiles_handle_t map_tiles_init(const map_tiles_config_t* config)
     handle->tile_count = tile_count;
     handle->initialized = true;
     handle->tile_loading_error = false;
+    handle->retry_limit = config->retry_limit > 0 ? config->retry_limit : 0;
+    handle->retry_delay_ms = config->retry_delay_ms > 0 ? config->retry_delay_ms : 100;
+    handle->verify_checksums = config->verify_checksums;
+    handle->io_burst_us = config->io_burst_ms > 0 ? (int64_t)config->io_burst_ms * 1000 : 0;
     
-    // Initialize tile data - allocate arrays based on actual tile count
-    handle->tile_bufs = (uint8_t**)calloc(tile_count, sizeof(uint8_t*));
-    handle->tile_imgs = (lv_image_dsc_t*)calloc(tile_count, sizeof(lv_image_dsc_t));
+    int cache_tiles = config->cache_tiles > 0 ? config->cache_tiles : 0;
+    handle->dem_source = -1;
     
-    if (!handle->tile_bufs || !handle->tile_imgs) {
+    // A budgeted read keeps the slot's previous tile until it completes; shading
+    // a tile also holds its plain tile and a DEM tile while the shaded one is claimed
+    int work_tiles = 1 + (config->dem_folder ? 2 : 0);
+    
+    // Initialize tile data - allocate arrays based on actual tile count
+    handle->tile_entries = (map_tiles_cache_entry_t**)map_tiles_mem_calloc(&handle->memory, MAP_TILES_MEM_INDICES, tile_count,
+                                                                            sizeof(map_tiles_cache_entry_t*), 0);
+    handle->tile_imgs = (lv_image_dsc_t*)map_tiles_mem_calloc(&handle->memory, MAP_TILES_MEM_DESCRIPTORS, tile_count,
+                                                              sizeof(lv_image_dsc_t), 0);
+    
+    // Attach to the shared cache, or give this handle a private one
+    if (config->shared_cache) {
+        handle->cache = config->shared_cache;
+    } else {
+        map_tiles_cache_config_t cache_config = {};
+        cache_config.use_spiram = handle->use_spiram;
+        handle->cache = map_tiles_cache_create(&cache_config);
+    }
+    
+    bool attached = handle->cache && map_tiles_cache_attach(handle->cache, tile_count + cache_tiles + work_tiles);
+    if (handle->cache && !config->shared_cache) {
+        // Drop the creator's reference so the private cache goes away with the handle
+        map_tiles_cache_destroy(handle->cache);
+    }
+    handle->cache_reserved = tile_count + cache_tiles + work_tiles;
+    handle->cache_tiles = cache_tiles;
+    handle->counters.since_us = esp_timer_get_time();
+    
+    bool sources_ok = attached;
+    for (int i = 0; sources_ok && i < handle->tile_type_count; i++) {
+        handle->source_ids[i] = map_tiles_cache_register_source(handle->cache, handle->base_path, handle->tile_folders[i]);
+        sources_ok = handle->source_ids[i] >= 0;
+    }
+    sources_ok = sources_ok && map_tiles_hillshade_init(handle, config);
+    bool process_ok = map_tiles_process_init(handle);
+    
+    if (!handle->tile_entries || !handle->tile_imgs || !sources_ok || !process_ok) {
         ESP_LOGE(TAG, "Failed to allocate tile arrays");
         // Clean up
-        if (handle->tile_bufs) free(handle->tile_bufs);
-        if (handle->tile_imgs) free(handle->tile_imgs);
+        map_tiles_mem_free(handle->tile_entries);
+        map_tiles_mem_free(handle->tile_imgs);
+        map_tiles_process_cleanup(handle);
+        if (attached) {
+            map_tiles_hillshade_cleanup(handle);
+            map_tiles_cache_detach(handle->cache, handle->cache_reserved);
+        }
         for (int i = 0; i < handle->tile_type_count; i++) {
-            free(handle->tile_folders[i]);
+            map_tiles_mem_free(handle->tile_folders[i]);
         }
-        free(handle->base_path);
-        free(handle);
+        map_tiles_mem_free(handle->base_path);
+        map_tiles_mem_free(handle);
         return NULL;
     }
     
-    ESP_LOGI(TAG, "Map tiles initialized with base path: %s, %d tile types, current type: %s, zoom: %d, grid: %dx%d", 
+    ESP_LOGI(TAG, "Map tiles initialized with base path: %s, %d tile types, current type: %s, zoom: %d, grid: %dx%d, cache: +%d tiles%s", 
              handle->base_path, handle->tile_type_count, 
              handle->tile_folders[handle->current_tile_type], handle->zoom, 
-             handle->grid_cols, handle->grid_rows);
+             handle->grid_cols, handle->grid_rows, cache_tiles, config->shared_cache ? " (shared)" : "");
     
     return handle;
 }
@@ -138,8 +172,17 @@ void map_tiles_set_zoom(map_tiles_handle_t handle, int zoom_level)
         return;
     }
     
+    if (zoom_level < 0 || zoom_level > MAP_TILES_MAX_ZOOM) {
+        ESP_LOGE(TAG, "Invalid zoom level: %d (valid range: 0-%d)", zoom_level, MAP_TILES_MAX_ZOOM);
+        return;
+    }
+    
+    bool changed = handle->zoom != zoom_level;
     handle->zoom = zoom_level;
     ESP_LOGI(TAG, "Zoom level set to %d", zoom_level);
+    if (changed) {
+        map_tiles_notify(handle, MAP_TILES_EVENT_VIEW_CHANGED, -1, handle->zoom, handle->tile_x, handle->tile_y);
+    }
 }
 
 int map_tiles_get_zoom(map_tiles_handle_t handle)
@@ -164,8 +207,12 @@ bool map_tiles_set_tile_type(map_tiles_handle_t handle, int tile_type)
         return false;
     }
     
+    bool changed = handle->current_tile_type != tile_type;
     handle->current_tile_type = tile_type;
     ESP_LOGI(TAG, "Tile type set to %d (%s)", tile_type, handle->tile_folders[tile_type]);
+    if (changed) {
+        map_tiles_notify(handle, MAP_TILES_EVENT_VIEW_CHANGED, -1, handle->zoom, handle->tile_x, handle->tile_y);
+    }
     return true;
 }
 
@@ -204,72 +251,310 @@ const char* map_tiles_get_tile_type_folder(map_tiles_handle_t handle, int tile_t
     return handle->tile_folders[tile_type];
 }
 
-bool map_tiles_load_tile(map_tiles_handle_t handle, int index, int tile_x, int tile_y)
+bool map_tiles_make_key(map_tiles_handle_t handle, int tile_type, int zoom, int tile_x, int tile_y, map_tiles_key_t* key)
 {
-    if (!handle || !handle->initialized) {
-        ESP_LOGE(TAG, "Handle not initialized");
-        return false;
-    }
-    
-    if (index < 0 || index >= handle->tile_count) {
-        ESP_LOGE(TAG, "Invalid tile index: %d", index);
+    // Canonical coordinates: X wraps around the antimeridian, tiles outside the grid do not exist
+    if (!map_tiles_tile_in_grid(handle, tile_type, zoom, tile_x, tile_y)) {
         return false;
     }
     
+    int64_t columns = map_tiles_wrap_columns(handle, tile_type, zoom);
+    key->source = handle->source_ids[tile_type];
+    key->zoom = zoom;
+    key->x = columns ? (int32_t)map_tiles_wrap(tile_x, columns) : tile_x;
+    key->y = tile_y;
+    return true;
+}
+
+int map_tiles_build_path(map_tiles_handle_t handle, const map_tiles_key_t* key, char* path, size_t size)
+{
+    return map_tiles_cache_tile_path(handle->cache, key, path, size);
+}
+
+FILE* map_tiles_open_file(map_tiles_handle_t handle, const map_tiles_key_t* key)
+{
     char path[256];
-    const char* folder = handle->tile_folders[handle->current_tile_type];
-    snprintf(path, sizeof(path), "%s/%s/%d/%d/%d.bin", 
-             handle->base_path, folder, handle->zoom, tile_x, tile_y);
+    map_tiles_build_path(handle, key, path, sizeof(path));
     
+    map_tiles_stats_io(handle);
     FILE *f = fopen(path, "rb");
     if (!f) {
         ESP_LOGW(TAG, "Tile not found: %s", path);
-        return false;
+    }
+    return f;
+}
+
+FILE* map_tiles_open_tile(map_tiles_handle_t handle, const map_tiles_key_t* key)
+{
+    FILE *f = map_tiles_open_file(handle, key);
+    if (!f) {
+        return NULL;
     }
     
     // Skip 12-byte header
-    fseek(f, 12, SEEK_SET);
-    
-    // Allocate buffer if needed
-    if (!handle->tile_bufs[index]) {
-        uint32_t caps = handle->use_spiram ? (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT) : MALLOC_CAP_DMA;
-        handle->tile_bufs[index] = (uint8_t*)heap_caps_malloc(
-            MAP_TILES_TILE_SIZE * MAP_TILES_TILE_SIZE * MAP_TILES_BYTES_PER_PIXEL, caps);
-        
-        if (!handle->tile_bufs[index]) {
-            ESP_LOGE(TAG, "Tile %d: allocation failed", index);
-            fclose(f);
-            return false;
-        }
+    fseek(f, MAP_TILES_TILE_HEADER_SIZE, SEEK_SET);
+    return f;
+}
+
+bool map_tiles_check_header(FILE* f, const map_tiles_key_t* key, bool* has_crc)
+{
+    uint8_t header[MAP_TILES_TILE_HEADER_SIZE];
+    bool ok = fread(header, 1, sizeof(header), f) == sizeof(header);
+    int flags = header[2] | (header[3] << 8);
+    int w = header[4] | (header[5] << 8);
+    int h = header[6] | (header[7] << 8);
+    if (!ok || header[1] != MAP_TILES_COLOR_FORMAT || w != MAP_TILES_TILE_SIZE || h != MAP_TILES_TILE_SIZE) {
+        ESP_LOGW(TAG, "Unexpected tile format: zoom %d (%d, %d)", (int)key->zoom, (int)key->x, (int)key->y);
+        return false;
     }
-    
+    *has_crc = (flags & MAP_TILES_TILE_FLAG_CRC) != 0;
+    return true;
+}
+
+bool map_tiles_read_tile(FILE* f, uint8_t* buf)
+{
     // Clear buffer
-    memset(handle->tile_bufs[index], 0, 
-           MAP_TILES_TILE_SIZE * MAP_TILES_TILE_SIZE * MAP_TILES_BYTES_PER_PIXEL);
+    memset(buf, 0, MAP_TILES_TILE_BYTES);
     
     // Read tile data
-    size_t bytes_read = fread(handle->tile_bufs[index], 1, 
-                             MAP_TILES_TILE_SIZE * MAP_TILES_TILE_SIZE * MAP_TILES_BYTES_PER_PIXEL, f);
+    size_t bytes_read = fread(buf, 1, MAP_TILES_TILE_BYTES, f);
     fclose(f);
     
-    if (bytes_read != MAP_TILES_TILE_SIZE * MAP_TILES_TILE_SIZE * MAP_TILES_BYTES_PER_PIXEL) {
+    if (bytes_read != MAP_TILES_TILE_BYTES) {
         ESP_LOGW(TAG, "Incomplete tile read: %zu bytes", bytes_read);
+        return false;
+    }
+    return true;
+}
+
+bool map_tiles_shown_key(map_tiles_handle_t handle, const map_tiles_key_t* key, map_tiles_key_t* show_key)
+{
+    // Shaded tiles are cached apart from the plain tiles they are made from
+    *show_key = *key;
+    if (!map_tiles_hillshade_active(handle)) {
+        return false;
+    }
+    show_key->source = handle->shaded_source_ids[handle->current_tile_type];
+    return true;
+}
+
+void map_tiles_notify(map_tiles_handle_t handle, map_tiles_event_type_t type, int index, int zoom, int tile_x, int tile_y)
+{
+    if (!handle->event_cb) {
+        return;
     }
     
+    map_tiles_event_t event = {type, index, zoom, tile_x, tile_y};
+    handle->event_cb(handle, &event, handle->event_ctx);
+}
+
+void map_tiles_set_slot_entry(map_tiles_handle_t handle, int index, map_tiles_cache_entry_t* entry)
+{
+    bool changed = handle->tile_entries[index] != entry;
+    handle->tile_entries[index] = entry;
+    
     // Setup image descriptor
     handle->tile_imgs[index].header.w = MAP_TILES_TILE_SIZE;
     handle->tile_imgs[index].header.h = MAP_TILES_TILE_SIZE;
     handle->tile_imgs[index].header.cf = MAP_TILES_COLOR_FORMAT;
     handle->tile_imgs[index].header.stride = MAP_TILES_TILE_SIZE * MAP_TILES_BYTES_PER_PIXEL;
-    handle->tile_imgs[index].data = (const uint8_t*)handle->tile_bufs[index];
-    handle->tile_imgs[index].data_size = MAP_TILES_TILE_SIZE * MAP_TILES_TILE_SIZE * MAP_TILES_BYTES_PER_PIXEL;
+    handle->tile_imgs[index].data = (const uint8_t*)entry->buf;
+    handle->tile_imgs[index].data_size = MAP_TILES_TILE_BYTES;
     handle->tile_imgs[index].reserved = NULL;
     handle->tile_imgs[index].reserved_2 = NULL;
     
-    ESP_LOGD(TAG, "Loaded tile %d from %s", index, path);
+    if (changed) {
+        map_tiles_notify(handle, MAP_TILES_EVENT_TILE_LOADED, index, entry->key.zoom, entry->key.x, entry->key.y);
+    }
+}
+
+/**
+ * @brief Show the previous tile of a slot again after a failed load, if it is still cached
+ */
+static void restore_slot(map_tiles_handle_t handle, int index, map_tiles_cache_entry_t* old, const map_tiles_key_t* old_key)
+{
+    map_tiles_cache_entry_t* restored = map_tiles_cache_get(handle->cache, old_key);
+    if (restored == old) {
+        handle->tile_entries[index] = old;
+    } else if (restored) {
+        map_tiles_set_slot_entry(handle, index, restored);
+    } else {
+        map_tiles_notify(handle, MAP_TILES_EVENT_TILE_EVICTED, index, old_key->zoom, old_key->x, old_key->y);
+    }
+}
+
+/**
+ * @brief Read a tile into a grid slot, recording the slot status
+ */
+static bool load_slot(map_tiles_handle_t handle, int index, const map_tiles_key_t* key_in)
+{
+    map_tiles_key_t key = *key_in;
+    map_tiles_cache_entry_t* old = handle->tile_entries[index];
+    
+    map_tiles_key_t show_key;
+    bool shaded = map_tiles_shown_key(handle, &key, &show_key);
+    
+    // Serve from the cache when this or another view has shown or preloaded the tile
+    map_tiles_cache_entry_t* entry = map_tiles_cache_get(handle->cache, &show_key);
+    if (entry) {
+        if (old) map_tiles_cache_unref(handle->cache, old);
+        map_tiles_stats_hit(handle);
+        map_tiles_slot_status(handle, index, &key, MAP_TILES_STATUS_OK);
+        map_tiles_set_slot_entry(handle, index, entry);
+        ESP_LOGD(TAG, "Tile %d (%d, %d) served from cache", index, (int)key.x, (int)key.y);
+        return true;
+    }
+    
+    if (map_tiles_quarantined(handle, &key)) {
+        map_tiles_slot_status(handle, index, &key, MAP_TILES_STATUS_CORRUPT);
+        map_tiles_notify(handle, MAP_TILES_EVENT_TILE_FAILED, index, key.zoom, key.x, key.y);
+        return false;
+    }
+    
+    // A preloaded plain tile saves the read when shading
+    map_tiles_cache_entry_t* base = shaded ? map_tiles_cache_get(handle->cache, &key) : NULL;
+    FILE *f = NULL;
+    bool has_crc = false;
+    int64_t start = esp_timer_get_time();
+    if (!base) {
+        f = map_tiles_open_file(handle, &key);
+        map_tiles_tile_status_t status = MAP_TILES_STATUS_MISSING;
+        if (f && !map_tiles_check_header(f, &key, &has_crc)) {
+            fclose(f);
+            f = NULL;
+            status = MAP_TILES_STATUS_CORRUPT;
+            map_tiles_quarantine_add(handle, &key);
+        }
+        if (!f) {
+            if (status == MAP_TILES_STATUS_MISSING) {
+                map_tiles_fetch_missing(handle, &key, true);
+            }
+            map_tiles_slot_status(handle, index, &key, status);
+            map_tiles_notify(handle, MAP_TILES_EVENT_TILE_FAILED, index, key.zoom, key.x, key.y);
+            return false;
+        }
+    }
+    
+    // Release the slot's previous tile first so its buffer can be recycled
+    map_tiles_key_t old_key = {};
+    if (old) {
+        old_key = old->key;
+        map_tiles_cache_unref(handle->cache, old);
+        handle->tile_entries[index] = NULL;
+    }
+    
+    bool existing;
+    entry = map_tiles_cache_claim(handle->cache, &show_key, MAP_TILES_CLAIM_DEMAND, &existing);
+    if (!entry) {
+        ESP_LOGE(TAG, "Tile %d: allocation failed", index);
+        if (f) fclose(f);
+        if (base) map_tiles_cache_unref(handle->cache, base);
+        map_tiles_slot_status(handle, index, &key, MAP_TILES_STATUS_NO_MEMORY);
+        map_tiles_notify(handle, MAP_TILES_EVENT_TILE_FAILED, index, key.zoom, key.x, key.y);
+        if (old) {
+            // Keep showing the previous tile if nothing recycled its buffer
+            restore_slot(handle, index, old, &old_key);
+        }
+        return false;
+    }
+    
+    map_tiles_tile_status_t status = MAP_TILES_STATUS_OK;
+    if (existing) {
+        // Another view finished reading the same tile meanwhile
+        if (f) fclose(f);
+        if (base) map_tiles_cache_unref(handle->cache, base);
+        map_tiles_stats_hit(handle);
+    } else {
+        if (base) {
+            memcpy(entry->buf, base->buf, MAP_TILES_TILE_BYTES);
+            map_tiles_cache_unref(handle->cache, base);
+            map_tiles_stats_hit(handle);
+        } else {
+            status = map_tiles_read_pixels(handle, f, &key, has_crc && handle->verify_checksums, entry->buf);
+            map_tiles_stats_load(handle, true, MAP_TILES_TILE_HEADER_SIZE + MAP_TILES_TILE_BYTES,
+                                 esp_timer_get_time() - start);
+        }
+        if (status == MAP_TILES_STATUS_CORRUPT) {
+            // Never shown: garbage on screen is what the checksum is for
+            map_tiles_cache_publish(handle->cache, entry, false, false);
+            map_tiles_slot_status(handle, index, &key, status);
+            map_tiles_notify(handle, MAP_TILES_EVENT_TILE_FAILED, index, key.zoom, key.x, key.y);
+            if (old) {
+                restore_slot(handle, index, old, &old_key);
+            }
+            return false;
+        }
+        if (shaded) {
+            map_tiles_hillshade_apply(handle, &key, entry->buf);
+        }
+        map_tiles_cache_publish(handle->cache, entry, true, true);
+    }
+    bool complete = status == MAP_TILES_STATUS_OK;
+    map_tiles_slot_status(handle, index, &key, status);
+    map_tiles_set_slot_entry(handle, index, entry);
+    if (!complete) {
+        // Shown zero-filled, but never served from the cache, so a retry reads it again
+        map_tiles_cache_forget(handle->cache, entry);
+        return false;
+    }
+    
+    ESP_LOGD(TAG, "Loaded tile %d (%d, %d)", index, (int)key.x, (int)key.y);
     return true;
 }
 
+bool map_tiles_load_tile(map_tiles_handle_t handle, int index, int tile_x, int tile_y)
+{
+    if (!handle || !handle->initialized) {
+        ESP_LOGE(TAG, "Handle not initialized");
+        return false;
+    }
+    
+    if (index < 0 || index >= handle->tile_count) {
+        ESP_LOGE(TAG, "Invalid tile index: %d", index);
+        return false;
+    }
+    
+    // A synchronous load supersedes a request still waiting for map_tiles_process()
+    map_tiles_process_cancel_slot(handle, index);
+    
+    map_tiles_key_t key;
+    if (!map_tiles_make_key(handle, handle->current_tile_type, handle->zoom, tile_x, tile_y, &key)) {
+        ESP_LOGD(TAG, "Tile %d (%d, %d) is outside the world", index, tile_x, tile_y);
+        map_tiles_slot_status(handle, index, NULL, MAP_TILES_STATUS_MISSING);
+        map_tiles_notify(handle, MAP_TILES_EVENT_TILE_FAILED, index, handle->zoom, tile_x, tile_y);
+        return false;
+    }
+    return load_slot(handle, index, &key);
+}
+
+int map_tiles_retry_failed(map_tiles_handle_t handle)
+{
+    if (!handle || !handle->initialized) {
+        ESP_LOGE(TAG, "Handle not initialized");
+        return 0;
+    }
+    
+    int64_t now = esp_timer_get_time();
+    int loaded = 0;
+    for (int i = 0; i < handle->tile_count; i++) {
+        if (map_tiles_slot_retry_due(handle, i, now)) {
+            map_tiles_process_cancel_slot(handle, i);
+            map_tiles_key_t key = handle->slots[i].key;
+            loaded += load_slot(handle, i, &key);
+        }
+    }
+    return loaded;
+}
+
+map_tiles_tile_status_t map_tiles_get_tile_status(map_tiles_handle_t handle, int index)
+{
+    if (!handle || !handle->initialized || index < 0 || index >= handle->tile_count) {
+        return MAP_TILES_STATUS_EMPTY;
+    }
+    
+    return handle->slots[index].status;
+}
+
 void map_tiles_gps_to_tile_xy(map_tiles_handle_t handle, double lat, double lon, double* x, double* y)
 {
     if (!handle || !handle->initialized) {
@@ -282,10 +567,13 @@ void map_tiles_gps_to_tile_xy(map_tiles_handle_t handle, double lat, double lon,
         return;
     }
     
-    double lat_rad = lat * M_PI / 180.0;
-    int n = 1 << handle->zoom;
-    *x = (lon + 180.0) / 360.0 * n;
-    *y = (1.0 - log(tan(lat_rad) + 1.0 / cos(lat_rad)) / M_PI) / 2.0 * n;
+    double u, v;
+    if (!map_tiles_project(handle, handle->current_tile_type, lat, lon, &u, &v)) {
+        ESP_LOGW(TAG, "GPS position %.6f, %.6f is outside the projection", lat, lon);
+        u = v = 0.0;
+    }
+    *x = ldexp(u, handle->zoom);
+    *y = ldexp(v, handle->zoom);
 }
 
 void map_tiles_tile_xy_to_gps(map_tiles_handle_t handle, double x, double y, double* lat, double* lon)
@@ -300,10 +588,113 @@ void map_tiles_tile_xy_to_gps(map_tiles_handle_t handle, double x, double y, dou
         return;
     }
     
-    int n = 1 << handle->zoom;
-    *lon = x / n * 360.0 - 180.0;
-    double lat_rad = atan(sinh(M_PI * (1 - 2 * y / n)));
-    *lat = lat_rad * 180.0 / M_PI;
+    map_tiles_unproject(handle, handle->current_tile_type, ldexp(x, -handle->zoom), ldexp(y, -handle->zoom), lat, lon);
+}
+
+/**
+ * @brief Project to world coordinates, returning false outside the projection
+ */
+static bool gps_to_world(map_tiles_handle_t handle, double lat, double lon, map_tiles_world_point_t* world)
+{
+    double u, v;
+    if (!map_tiles_project(handle, handle->current_tile_type, lat, lon, &u, &v)) {
+        return false;
+    }
+    
+    // Mercator keeps u, v < 1, so the products stay below 2^MAP_TILES_WORLD_SHIFT;
+    // double keeps 53 bits, enough for sub-pixel precision at MAP_TILES_MAX_ZOOM.
+    // Custom grids may span many zoom 0 tiles and are clamped well inside int64_t.
+    const double limit = ldexp(1.0, 62);
+    world->x = (int64_t)fmax(-limit, fmin(limit, floor(ldexp(u, MAP_TILES_WORLD_SHIFT))));
+    world->y = (int64_t)fmax(-limit, fmin(limit, floor(ldexp(v, MAP_TILES_WORLD_SHIFT))));
+    return true;
+}
+
+/**
+ * @brief Global pixel position of a world point at the current zoom
+ */
+static void world_to_pixel(map_tiles_handle_t handle, const map_tiles_world_point_t* world, int64_t* px, int64_t* py)
+{
+    // Arithmetic shift floors, so points west or north of the world stay consistent
+    int shift = MAP_TILES_MAX_ZOOM - handle->zoom;
+    *px = world->x >> shift;
+    *py = world->y >> shift;
+}
+
+void map_tiles_gps_to_world(map_tiles_handle_t handle, double lat, double lon, map_tiles_world_point_t* world)
+{
+    if (!handle || !handle->initialized) {
+        ESP_LOGE(TAG, "Handle not initialized");
+        return;
+    }
+    
+    if (!world) {
+        ESP_LOGE(TAG, "Invalid output parameters");
+        return;
+    }
+    
+    if (!gps_to_world(handle, lat, lon, world)) {
+        ESP_LOGW(TAG, "GPS position %.6f, %.6f is outside the projection", lat, lon);
+        world->x = world->y = 0;
+    }
+}
+
+bool map_tiles_gps_to_world_batch(map_tiles_handle_t handle, const map_tiles_gps_point_t* points, int count,
+                                  map_tiles_world_point_t* world)
+{
+    if (!handle || !handle->initialized) {
+        ESP_LOGE(TAG, "Handle not initialized");
+        return false;
+    }
+    
+    if ((!points || !world) && count > 0) {
+        ESP_LOGE(TAG, "Invalid parameters");
+        return false;
+    }
+    
+    int failed = 0;
+    for (int i = 0; i < count; i++) {
+        if (!gps_to_world(handle, points[i].lat, points[i].lon, &world[i])) {
+            world[i].x = world[i].y = 0;
+            failed++;
+        }
+    }
+    
+    if (failed) {
+        ESP_LOGW(TAG, "%d of %d GPS positions are outside the projection", failed, count);
+    }
+    return failed == 0;
+}
+
+void map_tiles_world_to_gps(map_tiles_handle_t handle, const map_tiles_world_point_t* world, double* lat, double* lon)
+{
+    if (!handle || !handle->initialized) {
+        ESP_LOGE(TAG, "Handle not initialized");
+        return;
+    }
+    
+    if (!world || !lat || !lon) {
+        ESP_LOGE(TAG, "Invalid parameters");
+        return;
+    }
+    
+    map_tiles_unproject(handle, handle->current_tile_type, ldexp((double)world->x, -MAP_TILES_WORLD_SHIFT),
+                        ldexp((double)world->y, -MAP_TILES_WORLD_SHIFT), lat, lon);
+}
+
+void map_tiles_world_to_pixel(map_tiles_handle_t handle, const map_tiles_world_point_t* world, int64_t* px, int64_t* py)
+{
+    int64_t x = 0, y = 0;
+    if (!handle || !handle->initialized) {
+        ESP_LOGE(TAG, "Handle not initialized");
+    } else if (!world) {
+        ESP_LOGE(TAG, "Invalid world point");
+    } else {
+        world_to_pixel(handle, world, &x, &y);
+    }
+    
+    if (px) *px = x;
+    if (py) *py = y;
 }
 
 void map_tiles_get_center_gps(map_tiles_handle_t handle, double* lat, double* lon)
@@ -333,18 +724,36 @@ void map_tiles_set_center_from_gps(map_tiles_handle_t handle, double lat, double
         return;
     }
     
-    double x, y;
-    map_tiles_gps_to_tile_xy(handle, lat, lon, &x, &y);
+    // Exact integer pixel position at the current zoom
+    map_tiles_world_point_t world;
+    int64_t px, py;
+    if (!gps_to_world(handle, lat, lon, &world)) {
+        ESP_LOGW(TAG, "GPS position %.6f, %.6f is outside the projection", lat, lon);
+        return;
+    }
+    world_to_pixel(handle, &world, &px, &py);
     
-    handle->tile_x = (int)x - handle->grid_cols / 2;
-    handle->tile_y = (int)y - handle->grid_rows / 2;
+    // X wraps so grids across the antimeridian start at a valid column; Y may
+    // extend past the poles, where map_tiles_load_tile() fails without any I/O.
+    // Shifts floor, so positions west or north of a local grid stay consistent.
+    int64_t x = (px >> 8) - handle->grid_cols / 2;
+    int64_t y = (py >> 8) - handle->grid_rows / 2;
+    int64_t columns = map_tiles_wrap_columns(handle, handle->current_tile_type, handle->zoom);
+    int old_x = handle->tile_x;
+    int old_y = handle->tile_y;
+    handle->tile_x = (int)(columns ? map_tiles_wrap(x, columns) : x);
+    handle->tile_y = (int)y;
     
     // Calculate pixel offset within the tile
-    handle->marker_offset_x = (int)((x - (int)x) * MAP_TILES_TILE_SIZE);
-    handle->marker_offset_y = (int)((y - (int)y) * MAP_TILES_TILE_SIZE);
+    handle->marker_offset_x = (int)(px & (MAP_TILES_TILE_SIZE - 1));
+    handle->marker_offset_y = (int)(py & (MAP_TILES_TILE_SIZE - 1));
     
     ESP_LOGI(TAG, "GPS to tile: tile_x=%d, tile_y=%d, offset_x=%d, offset_y=%d", 
              handle->tile_x, handle->tile_y, handle->marker_offset_x, handle->marker_offset_y);
+    
+    if (handle->tile_x != old_x || handle->tile_y != old_y) {
+        map_tiles_notify(handle, MAP_TILES_EVENT_VIEW_CHANGED, -1, handle->zoom, handle->tile_x, handle->tile_y);
+    }
 }
 
 bool map_tiles_is_gps_within_tiles(map_tiles_handle_t handle, double lat, double lon)
@@ -353,13 +762,21 @@ bool map_tiles_is_gps_within_tiles(map_tiles_handle_t handle, double lat, double
         return false;
     }
     
-    double x, y;
-    map_tiles_gps_to_tile_xy(handle, lat, lon, &x, &y);
+    map_tiles_world_point_t world;
+    int64_t px, py;
+    if (!gps_to_world(handle, lat, lon, &world)) {
+        return false;
+    }
+    world_to_pixel(handle, &world, &px, &py);
     
-    int gps_tile_x = (int)x;
-    int gps_tile_y = (int)y;
+    int64_t gps_tile_x = px >> 8;
+    int64_t gps_tile_y = py >> 8;
     
-    bool within_x = (gps_tile_x >= handle->tile_x && gps_tile_x < handle->tile_x + handle->grid_cols);
+    // Columns are counted from the grid origin across the antimeridian
+    int64_t columns = map_tiles_wrap_columns(handle, handle->current_tile_type, handle->zoom);
+    int64_t dx = gps_tile_x - handle->tile_x;
+    if (columns) dx = map_tiles_wrap(dx, columns);
+    bool within_x = (dx >= 0 && dx < handle->grid_cols);
     bool within_y = (gps_tile_y >= handle->tile_y && gps_tile_y < handle->tile_y + handle->grid_rows);
     
     return within_x && within_y;
@@ -383,8 +800,15 @@ void map_tiles_set_position(map_tiles_handle_t handle, int tile_x, int tile_y)
         return;
     }
     
-    handle->tile_x = tile_x;
+    int64_t columns = map_tiles_wrap_columns(handle, handle->current_tile_type, handle->zoom);
+    int old_x = handle->tile_x;
+    int old_y = handle->tile_y;
+    handle->tile_x = columns ? (int)map_tiles_wrap(tile_x, columns) : tile_x;
     handle->tile_y = tile_y;
+    
+    if (handle->tile_x != old_x || handle->tile_y != old_y) {
+        map_tiles_notify(handle, MAP_TILES_EVENT_VIEW_CHANGED, -1, handle->zoom, handle->tile_x, handle->tile_y);
+    }
 }
 
 void map_tiles_get_marker_offset(map_tiles_handle_t handle, int* offset_x, int* offset_y)
@@ -424,7 +848,7 @@ uint8_t* map_tiles_get_buffer(map_tiles_handle_t handle, int index)
         return NULL;
     }
     
-    return handle->tile_bufs[index];
+    return handle->tile_entries[index] ? handle->tile_entries[index]->buf : NULL;
 }
 
 void map_tiles_set_loading_error(map_tiles_handle_t handle, bool error)
@@ -446,6 +870,17 @@ bool map_tiles_has_loading_error(map_tiles_handle_t handle)
     return handle->tile_loading_error;
 }
 
+void map_tiles_set_event_cb(map_tiles_handle_t handle, map_tiles_event_cb_t cb, void* ctx)
+{
+    if (!handle || !handle->initialized) {
+        ESP_LOGE(TAG, "Handle not initialized");
+        return;
+    }
+    
+    handle->event_cb = cb;
+    handle->event_ctx = ctx;
+}
+
 void map_tiles_cleanup(map_tiles_handle_t handle)
 {
     if (!handle) {
@@ -453,21 +888,29 @@ void map_tiles_cleanup(map_tiles_handle_t handle)
     }
     
     if (handle->initialized) {
-        // Free tile buffers
-        if (handle->tile_bufs) {
+        // Abandon a budgeted read in progress
+        map_tiles_process_cleanup(handle);
+        
+        // Release tile buffers; the cache frees them once no other handle uses it
+        if (handle->tile_entries) {
             for (int i = 0; i < handle->tile_count; i++) {
-                if (handle->tile_bufs[i]) {
-                    heap_caps_free(handle->tile_bufs[i]);
-                    handle->tile_bufs[i] = NULL;
+                if (handle->tile_entries[i]) {
+                    map_tiles_cache_unref(handle->cache, handle->tile_entries[i]);
                 }
             }
-            free(handle->tile_bufs);
-            handle->tile_bufs = NULL;
+            map_tiles_mem_free(handle->tile_entries);
+            handle->tile_entries = NULL;
         }
         
+        // Drop any pending route preload
+        map_tiles_preload_cancel(handle);
+        map_tiles_hillshade_cleanup(handle);
+        map_tiles_cache_detach(handle->cache, handle->cache_reserved);
+        handle->cache = NULL;
+        
         // Free tile image descriptors array
         if (handle->tile_imgs) {
-            free(handle->tile_imgs);
+            map_tiles_mem_free(handle->tile_imgs);
             handle->tile_imgs = NULL;
         }
         
@@ -476,15 +919,11 @@ void map_tiles_cleanup(map_tiles_handle_t handle)
     }
     
     // Free base path and folder names, then handle
-    if (handle->base_path) {
-        free(handle->base_path);
-    }
+    map_tiles_mem_free(handle->base_path);
     for (int i = 0; i < handle->tile_type_count; i++) {
-        if (handle->tile_folders[i]) {
-            free(handle->tile_folders[i]);
-        }
+        map_tiles_mem_free(handle->tile_folders[i]);
     }
-    free(handle);
+    map_tiles_mem_free(handle);
 }
 
 void map_tiles_get_grid_size(map_tiles_handle_t handle, int* cols, int* rows)
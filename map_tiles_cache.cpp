@@ -0,0 +1,502 @@
+#include "map_tiles_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "freertos/task.h"
+
+static const char* TAG = "map_tiles_cache";
+
+static bool key_equal(const map_tiles_key_t* a, const map_tiles_key_t* b)
+{
+    return a->source == b->source && a->zoom == b->zoom && a->x == b->x && a->y == b->y;
+}
+
+static void cache_free(map_tiles_cache_handle_t cache)
+{
+    for (int i = 0; i < cache->count; i++) {
+        if (cache->entries[i]->buf) {
+            map_tiles_mem_free(cache->entries[i]->buf);
+        }
+        map_tiles_mem_free(cache->entries[i]);
+    }
+    map_tiles_mem_free(cache->entries);
+    
+    for (int i = 0; i < cache->source_count; i++) {
+        map_tiles_mem_free(cache->sources[i]);
+    }
+    map_tiles_mem_free(cache->sources);
+    
+    if (cache->lock) {
+        vSemaphoreDelete(cache->lock);
+    }
+    map_tiles_mem_free(cache);
+}
+
+map_tiles_cache_handle_t map_tiles_cache_create(const map_tiles_cache_config_t* config)
+{
+    if (!config || config->capacity_tiles < 0) {
+        ESP_LOGE(TAG, "Invalid cache configuration");
+        return NULL;
+    }
+    
+    map_tiles_cache_handle_t cache = (map_tiles_cache_handle_t)map_tiles_mem_calloc(NULL, MAP_TILES_MEM_CACHE, 1,
+                                                                                   sizeof(struct map_tiles_cache_t), 0);
+    if (!cache) {
+        ESP_LOGE(TAG, "Failed to allocate cache");
+        return NULL;
+    }
+    map_tiles_mem_assign(cache, &cache->memory);
+    
+    cache->lock = xSemaphoreCreateMutex();
+    if (!cache->lock) {
+        ESP_LOGE(TAG, "Failed to create cache lock");
+        map_tiles_mem_free(cache);
+        return NULL;
+    }
+    
+    // The creator holds one reference, attached like a handle with its extra capacity
+    cache->use_spiram = config->use_spiram;
+    if (!map_tiles_cache_attach(cache, config->capacity_tiles)) {
+        cache_free(cache);
+        return NULL;
+    }
+    
+    ESP_LOGI(TAG, "Tile cache created: %d tiles", config->capacity_tiles);
+    return cache;
+}
+
+void map_tiles_cache_destroy(map_tiles_cache_handle_t cache)
+{
+    if (!cache) {
+        return;
+    }
+    
+    // Handles still attached keep the cache alive until they are cleaned up
+    map_tiles_cache_detach(cache, 0);
+}
+
+bool map_tiles_cache_attach(map_tiles_cache_handle_t cache, int tiles)
+{
+    xSemaphoreTake(cache->lock, portMAX_DELAY);
+    
+    int capacity = cache->capacity + tiles;
+    int slots = capacity > cache->count ? capacity : cache->count;
+    map_tiles_cache_entry_t** entries = (map_tiles_cache_entry_t**)map_tiles_mem_realloc(
+        &cache->memory, MAP_TILES_MEM_CACHE, cache->entries, (slots > 0 ? slots : 1) * sizeof(map_tiles_cache_entry_t*));
+    if (!entries) {
+        xSemaphoreGive(cache->lock);
+        ESP_LOGE(TAG, "Failed to grow cache index to %d tiles", capacity);
+        return false;
+    }
+    
+    cache->entries = entries;
+    cache->capacity = capacity;
+    cache->users++;
+    
+    xSemaphoreGive(cache->lock);
+    return true;
+}
+
+/**
+ * @brief Release buffers beyond the capacity, least recently used first
+ */
+static void trim_locked(map_tiles_cache_handle_t cache)
+{
+    while (cache->count > cache->capacity) {
+        int victim = -1;
+        for (int i = 0; i < cache->count; i++) {
+            map_tiles_cache_entry_t* entry = cache->entries[i];
+            if (entry->refs > 0 || entry->loading) continue;
+            if (victim < 0 || (int32_t)(entry->last_used - cache->entries[victim]->last_used) < 0) {
+                victim = i;
+            }
+        }
+        if (victim < 0) break;
+        
+        map_tiles_mem_free(cache->entries[victim]->buf);
+        map_tiles_mem_free(cache->entries[victim]);
+        cache->entries[victim] = cache->entries[--cache->count];
+    }
+}
+
+void map_tiles_cache_detach(map_tiles_cache_handle_t cache, int tiles)
+{
+    xSemaphoreTake(cache->lock, portMAX_DELAY);
+    
+    cache->capacity -= tiles;
+    bool last = (--cache->users == 0);
+    if (!last) {
+        trim_locked(cache);
+    }
+    
+    xSemaphoreGive(cache->lock);
+    
+    if (last) {
+        cache_free(cache);
+        ESP_LOGI(TAG, "Tile cache destroyed");
+    }
+}
+
+bool map_tiles_cache_resize(map_tiles_cache_handle_t cache, int tiles)
+{
+    xSemaphoreTake(cache->lock, portMAX_DELAY);
+    
+    // Entries still shown may keep count above a trimmed capacity
+    int capacity = cache->capacity + tiles;
+    int slots = capacity > cache->count ? capacity : cache->count;
+    if (tiles > 0) {
+        map_tiles_cache_entry_t** entries = (map_tiles_cache_entry_t**)map_tiles_mem_realloc(
+            &cache->memory, MAP_TILES_MEM_CACHE, cache->entries, (slots > 0 ? slots : 1) * sizeof(map_tiles_cache_entry_t*));
+        if (!entries) {
+            xSemaphoreGive(cache->lock);
+            ESP_LOGE(TAG, "Failed to grow cache index to %d tiles", capacity);
+            return false;
+        }
+        cache->entries = entries;
+    }
+    cache->capacity = capacity;
+    trim_locked(cache);
+    
+    xSemaphoreGive(cache->lock);
+    return true;
+}
+
+int32_t map_tiles_cache_register_source(map_tiles_cache_handle_t cache, const char* base_path, const char* folder)
+{
+    // Normalise a trailing slash so "/sdcard/" and "/sdcard" share tiles
+    char path[192];
+    size_t base_len = strlen(base_path);
+    while (base_len > 1 && base_path[base_len - 1] == '/') {
+        base_len--;
+    }
+    snprintf(path, sizeof(path), "%.*s/%s", (int)base_len, base_path, folder);
+    
+    xSemaphoreTake(cache->lock, portMAX_DELAY);
+    
+    int32_t free_slot = -1;
+    for (int i = 0; i < cache->source_count; i++) {
+        if (!cache->sources[i]) {
+            free_slot = free_slot < 0 ? i : free_slot;
+        } else if (strcmp(cache->sources[i], path) == 0) {
+            xSemaphoreGive(cache->lock);
+            return i;
+        }
+    }
+    
+    int32_t id = -1;
+    if (free_slot >= 0) {
+        // Reuse an unregistered id before growing the table
+        cache->sources[free_slot] = map_tiles_mem_strdup(&cache->memory, MAP_TILES_MEM_CACHE, path);
+        if (cache->sources[free_slot]) {
+            id = free_slot;
+        }
+    } else {
+        char** sources = (char**)map_tiles_mem_realloc(&cache->memory, MAP_TILES_MEM_CACHE, cache->sources,
+                                                       (cache->source_count + 1) * sizeof(char*));
+        if (sources) {
+            cache->sources = sources;
+            cache->sources[cache->source_count] = map_tiles_mem_strdup(&cache->memory, MAP_TILES_MEM_CACHE, path);
+            if (cache->sources[cache->source_count]) {
+                id = cache->source_count++;
+            }
+        }
+    }
+    
+    xSemaphoreGive(cache->lock);
+    
+    if (id < 0) {
+        ESP_LOGE(TAG, "Failed to register tile source %s", path);
+    }
+    return id;
+}
+
+static void invalidate_source_locked(map_tiles_cache_handle_t cache, int32_t source)
+{
+    // Entries still shown keep their buffer but can no longer be found; the
+    // others become free buffers
+    for (int i = 0; i < cache->count; i++) {
+        map_tiles_cache_entry_t* entry = cache->entries[i];
+        if (entry->key.source != source) continue;
+        entry->key.source = -1;
+        if (entry->refs == 0 && !entry->loading) {
+            entry->valid = false;
+        }
+    }
+}
+
+void map_tiles_cache_unregister_source(map_tiles_cache_handle_t cache, int32_t source)
+{
+    xSemaphoreTake(cache->lock, portMAX_DELAY);
+    
+    // Ids of other sources stay as they are; the slot is reused by the next registration
+    invalidate_source_locked(cache, source);
+    map_tiles_mem_free(cache->sources[source]);
+    cache->sources[source] = NULL;
+    
+    xSemaphoreGive(cache->lock);
+}
+
+int map_tiles_cache_tile_path(map_tiles_cache_handle_t cache, const map_tiles_key_t* key, char* path, size_t size)
+{
+    // Registering a source may move the table, so format while holding the lock
+    xSemaphoreTake(cache->lock, portMAX_DELAY);
+    int len = snprintf(path, size, "%s/%d/%d/%d.bin", cache->sources[key->source], key->zoom, key->x, key->y);
+    xSemaphoreGive(cache->lock);
+    return len;
+}
+
+static map_tiles_cache_entry_t* find_locked(map_tiles_cache_handle_t cache, const map_tiles_key_t* key)
+{
+    for (int i = 0; i < cache->count; i++) {
+        map_tiles_cache_entry_t* entry = cache->entries[i];
+        if ((entry->valid || entry->loading) && key_equal(&entry->key, key)) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Find a tile, waiting for another reader that is still loading it
+ */
+static map_tiles_cache_entry_t* find_ready_locked(map_tiles_cache_handle_t cache, const map_tiles_key_t* key)
+{
+    map_tiles_cache_entry_t* entry;
+    while ((entry = find_locked(cache, key)) && entry->loading) {
+        xSemaphoreGive(cache->lock);
+        vTaskDelay(1);
+        xSemaphoreTake(cache->lock, portMAX_DELAY);
+    }
+    return entry;
+}
+
+bool map_tiles_cache_contains(map_tiles_cache_handle_t cache, const map_tiles_key_t* key)
+{
+    xSemaphoreTake(cache->lock, portMAX_DELAY);
+    bool found = find_locked(cache, key) != NULL;
+    xSemaphoreGive(cache->lock);
+    return found;
+}
+
+map_tiles_cache_entry_t* map_tiles_cache_get(map_tiles_cache_handle_t cache, const map_tiles_key_t* key)
+{
+    xSemaphoreTake(cache->lock, portMAX_DELAY);
+    
+    map_tiles_cache_entry_t* entry = find_ready_locked(cache, key);
+    if (entry) {
+        entry->refs++;
+        entry->prefetched = false;
+        entry->last_used = ++cache->tick;
+    }
+    
+    xSemaphoreGive(cache->lock);
+    return entry;
+}
+
+static bool is_evictable(const map_tiles_cache_entry_t* entry, map_tiles_claim_t policy)
+{
+    if (entry->refs > 0 || entry->loading) {
+        return false;
+    }
+    return !(policy == MAP_TILES_CLAIM_PRELOAD && entry->valid && entry->prefetched);
+}
+
+bool map_tiles_cache_can_claim(map_tiles_cache_handle_t cache, map_tiles_claim_t policy)
+{
+    xSemaphoreTake(cache->lock, portMAX_DELAY);
+    
+    bool possible = cache->count < cache->capacity;
+    for (int i = 0; !possible && i < cache->count; i++) {
+        possible = is_evictable(cache->entries[i], policy);
+    }
+    
+    xSemaphoreGive(cache->lock);
+    return possible;
+}
+
+static map_tiles_cache_entry_t* cache_alloc_entry(map_tiles_cache_handle_t cache)
+{
+    map_tiles_cache_entry_t* entry = (map_tiles_cache_entry_t*)map_tiles_mem_calloc(&cache->memory, MAP_TILES_MEM_CACHE, 1,
+                                                                                    sizeof(map_tiles_cache_entry_t), 0);
+    if (!entry) {
+        return NULL;
+    }
+    
+    uint32_t caps = cache->use_spiram ? (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT) : MALLOC_CAP_DMA;
+    entry->buf = (uint8_t*)map_tiles_mem_alloc(&cache->memory, MAP_TILES_MEM_TILE_BUFFERS, MAP_TILES_TILE_BYTES, caps);
+    if (!entry->buf) {
+        map_tiles_mem_free(entry);
+        return NULL;
+    }
+    
+    cache->entries[cache->count++] = entry;
+    return entry;
+}
+
+/**
+ * @brief Return a cached tile, or take a free or evicted buffer marked loading
+ */
+static map_tiles_cache_entry_t* claim_locked(map_tiles_cache_handle_t cache, const map_tiles_key_t* key,
+                                             map_tiles_claim_t policy, bool* existing)
+{
+    // Another view may have loaded the tile since the caller last looked
+    map_tiles_cache_entry_t* entry = find_ready_locked(cache, key);
+    if (entry) {
+        if (policy == MAP_TILES_CLAIM_DEMAND) {
+            entry->refs++;
+            entry->prefetched = false;
+        }
+        entry->last_used = ++cache->tick;
+        *existing = true;
+        return entry;
+    }
+    *existing = false;
+    
+    if (cache->count < cache->capacity) {
+        entry = cache_alloc_entry(cache);
+        if (!entry) {
+            ESP_LOGW(TAG, "Tile buffer allocation failed, evicting instead");
+        }
+    }
+    
+    if (!entry) {
+        // Evict the least recently used entry that no grid slot is showing
+        for (int i = 0; i < cache->count; i++) {
+            map_tiles_cache_entry_t* candidate = cache->entries[i];
+            if (!is_evictable(candidate, policy)) {
+                continue;
+            }
+            if (!entry || !candidate->valid ||
+                (entry->valid && (int32_t)(candidate->last_used - entry->last_used) < 0)) {
+                entry = candidate;
+            }
+        }
+    }
+    
+    if (entry) {
+        if (entry->valid) {
+            cache->evictions++;
+        }
+        entry->key = *key;
+        entry->valid = false;
+        entry->loading = true;
+        entry->prefetched = (policy == MAP_TILES_CLAIM_PRELOAD);
+        entry->last_used = ++cache->tick;
+    }
+    return entry;
+}
+
+map_tiles_cache_entry_t* map_tiles_cache_claim(map_tiles_cache_handle_t cache, const map_tiles_key_t* key,
+                                               map_tiles_claim_t policy, bool* existing)
+{
+    xSemaphoreTake(cache->lock, portMAX_DELAY);
+    map_tiles_cache_entry_t* entry = claim_locked(cache, key, policy, existing);
+    xSemaphoreGive(cache->lock);
+    return entry;
+}
+
+map_tiles_cache_entry_t* map_tiles_cache_claim_unlisted(map_tiles_cache_handle_t cache, const map_tiles_key_t* key,
+                                                        map_tiles_claim_t policy, bool* existing)
+{
+    xSemaphoreTake(cache->lock, portMAX_DELAY);
+    
+    // Lookups cannot find the buffer, so none of them waits for a read that
+    // spans several calls of its owner
+    map_tiles_cache_entry_t* entry = claim_locked(cache, key, policy, existing);
+    if (entry && !*existing) {
+        entry->key.source = -1;
+    }
+    
+    xSemaphoreGive(cache->lock);
+    return entry;
+}
+
+void map_tiles_cache_publish(map_tiles_cache_handle_t cache, map_tiles_cache_entry_t* entry, bool ok, bool ref)
+{
+    xSemaphoreTake(cache->lock, portMAX_DELAY);
+    
+    entry->loading = false;
+    entry->valid = ok;
+    if (ok && ref) {
+        entry->refs++;
+        entry->prefetched = false;
+    }
+    
+    xSemaphoreGive(cache->lock);
+}
+
+map_tiles_cache_entry_t* map_tiles_cache_publish_as(map_tiles_cache_handle_t cache, map_tiles_cache_entry_t* entry,
+                                                    const map_tiles_key_t* key, bool ref)
+{
+    xSemaphoreTake(cache->lock, portMAX_DELAY);
+    
+    // A synchronous load may have cached the tile while the buffer was unlisted;
+    // keep that copy and free the buffer
+    map_tiles_cache_entry_t* found = find_ready_locked(cache, key);
+    entry->loading = false;
+    if (found) {
+        entry->valid = false;
+        entry = found;
+        entry->last_used = ++cache->tick;
+    } else {
+        entry->key = *key;
+        entry->valid = true;
+    }
+    if (ref) {
+        entry->refs++;
+        entry->prefetched = false;
+    }
+    
+    xSemaphoreGive(cache->lock);
+    return entry;
+}
+
+void map_tiles_cache_invalidate_source(map_tiles_cache_handle_t cache, int32_t source)
+{
+    xSemaphoreTake(cache->lock, portMAX_DELAY);
+    invalidate_source_locked(cache, source);
+    xSemaphoreGive(cache->lock);
+}
+
+void map_tiles_cache_forget(map_tiles_cache_handle_t cache, map_tiles_cache_entry_t* entry)
+{
+    xSemaphoreTake(cache->lock, portMAX_DELAY);
+    
+    // Same as invalidating a source, for one entry
+    entry->key.source = -1;
+    if (entry->refs == 0 && !entry->loading) {
+        entry->valid = false;
+    }
+    
+    xSemaphoreGive(cache->lock);
+}
+
+void map_tiles_cache_get_stats(map_tiles_cache_handle_t cache, map_tiles_stats_t* stats, bool reset)
+{
+    xSemaphoreTake(cache->lock, portMAX_DELAY);
+    
+    // Every entry owns one tile buffer, all from the same heap
+    size_t bytes = (size_t)cache->count * MAP_TILES_TILE_BYTES;
+    stats->cache_evictions = cache->evictions;
+    stats->memory_spiram = cache->use_spiram ? bytes : 0;
+    stats->memory_internal = cache->use_spiram ? 0 : bytes;
+    stats->cache_tiles = cache->count;
+    stats->cache_capacity = cache->capacity;
+    if (reset) {
+        cache->evictions = 0;
+    }
+    
+    xSemaphoreGive(cache->lock);
+}
+
+void map_tiles_cache_unref(map_tiles_cache_handle_t cache, map_tiles_cache_entry_t* entry)
+{
+    xSemaphoreTake(cache->lock, portMAX_DELAY);
+    
+    if (entry->refs > 0) {
+        entry->refs--;
+    }
+    
+    xSemaphoreGive(cache->lock);
+}
@@ -0,0 +1,530 @@
+#include "map_tiles_internal.h"
+#include <string.h>
+#include <sys/stat.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char* TAG = "map_tiles_fetch";
+
+#define FETCH_DEFAULT_CONCURRENT 2
+#define FETCH_DEFAULT_QUEUED 64
+#define FETCH_FOLDER_MAX 64
+#define LOCAL_MAX_FILE_BYTES (1024 * 1024)                          /**< Larger files are not tiles */
+
+typedef enum {
+    FETCH_FREE,
+    FETCH_QUEUED,
+    FETCH_RUNNING,                                                  /**< Started, until the tile is on the card */
+} fetch_state_t;
+
+/**
+ * @brief One queued or running fetch; slots never move, so folder stays valid for the backend
+ */
+typedef struct {
+    fetch_state_t state;
+    bool demand;
+    map_tiles_fetch_tile_t tile;
+    char folder[FETCH_FOLDER_MAX];
+    int64_t requested_at;
+    int64_t started_at;
+} fetch_job_t;
+
+struct map_tiles_fetch_t {
+    SemaphoreHandle_t lock;
+    map_tiles_mem_account_t memory;                                 /**< The fetcher, its queue and its backend */
+    char* base_path;
+    map_tiles_fetch_backend_t backend;
+    int max_concurrent;
+    int max_queued;
+    fetch_job_t* jobs;                                              /**< max_concurrent + max_queued slots */
+    int queued;
+    int running;
+    uint32_t next_id;
+    
+    // Statistics
+    uint32_t requests;
+    uint32_t coalesced;
+    uint32_t rejected;
+    uint32_t fetched;
+    uint32_t failed;
+    uint64_t bytes_written;
+    uint64_t latency_us;                                            /**< Sums over fetched tiles */
+    uint64_t fetch_time_us;
+    uint32_t latency_peak_us;
+    uint32_t fetch_time_peak_us;
+};
+
+map_tiles_fetch_handle_t map_tiles_fetch_create(const map_tiles_fetch_config_t* config)
+{
+    if (!config || !config->base_path || !config->backend.start || config->max_concurrent < 0 || config->max_queued < 0) {
+        ESP_LOGE(TAG, "Invalid fetch configuration");
+        return NULL;
+    }
+    
+    map_tiles_fetch_handle_t fetch = (map_tiles_fetch_handle_t)map_tiles_mem_calloc(NULL, MAP_TILES_MEM_FETCH, 1,
+                                                                                   sizeof(struct map_tiles_fetch_t), 0);
+    if (!fetch) {
+        ESP_LOGE(TAG, "Failed to allocate fetcher");
+        return NULL;
+    }
+    map_tiles_mem_assign(fetch, &fetch->memory);
+    
+    fetch->max_concurrent = config->max_concurrent > 0 ? config->max_concurrent : FETCH_DEFAULT_CONCURRENT;
+    fetch->max_queued = config->max_queued > 0 ? config->max_queued : FETCH_DEFAULT_QUEUED;
+    fetch->base_path = map_tiles_mem_strdup(&fetch->memory, MAP_TILES_MEM_FETCH, config->base_path);
+    fetch->jobs = (fetch_job_t*)map_tiles_mem_calloc(&fetch->memory, MAP_TILES_MEM_FETCH,
+                                                     fetch->max_concurrent + fetch->max_queued, sizeof(fetch_job_t), 0);
+    fetch->lock = xSemaphoreCreateMutex();
+    if (!fetch->base_path || !fetch->jobs || !fetch->lock) {
+        ESP_LOGE(TAG, "Failed to allocate fetcher");
+        if (fetch->lock) {
+            vSemaphoreDelete(fetch->lock);
+        }
+        map_tiles_mem_free(fetch->jobs);
+        map_tiles_mem_free(fetch->base_path);
+        map_tiles_mem_free(fetch);
+        return NULL;
+    }
+    fetch->backend = config->backend;
+    
+    ESP_LOGI(TAG, "Tile fetcher created: %s, %d concurrent, %d queued", fetch->base_path,
+             fetch->max_concurrent, fetch->max_queued);
+    return fetch;
+}
+
+static fetch_job_t* find_locked(map_tiles_fetch_handle_t fetch, const char* folder, int zoom, int x, int y)
+{
+    for (int i = 0; i < fetch->max_concurrent + fetch->max_queued; i++) {
+        fetch_job_t* job = &fetch->jobs[i];
+        if (job->state != FETCH_FREE && job->tile.zoom == zoom && job->tile.x == x && job->tile.y == y &&
+            strcmp(job->folder, folder) == 0) {
+            return job;
+        }
+    }
+    return NULL;
+}
+
+bool map_tiles_fetch_request(map_tiles_fetch_handle_t fetch, const char* folder, int zoom, int x, int y, bool demand)
+{
+    if (!fetch || !folder) {
+        ESP_LOGE(TAG, "Invalid fetch request");
+        return false;
+    }
+    
+    if (strlen(folder) >= FETCH_FOLDER_MAX) {
+        ESP_LOGE(TAG, "Tile folder name too long: %s", folder);
+        return false;
+    }
+    
+    xSemaphoreTake(fetch->lock, portMAX_DELAY);
+    
+    fetch_job_t* job = find_locked(fetch, folder, zoom, x, y);
+    if (job) {
+        // A tile coming on screen overtakes the preload it was queued for
+        job->demand = job->demand || demand;
+        fetch->coalesced++;
+        xSemaphoreGive(fetch->lock);
+        return true;
+    }
+    
+    if (fetch->queued >= fetch->max_queued) {
+        fetch->rejected++;
+        xSemaphoreGive(fetch->lock);
+        ESP_LOGW(TAG, "Fetch queue full, dropping zoom %d (%d, %d)", zoom, x, y);
+        return false;
+    }
+    
+    // Queued and running jobs never fill all slots, so one is free
+    for (int i = 0; !job; i++) {
+        if (fetch->jobs[i].state == FETCH_FREE) {
+            job = &fetch->jobs[i];
+        }
+    }
+    strcpy(job->folder, folder);
+    job->state = FETCH_QUEUED;
+    job->demand = demand;
+    job->tile.id = ++fetch->next_id;
+    job->tile.folder = job->folder;
+    job->tile.zoom = zoom;
+    job->tile.x = x;
+    job->tile.y = y;
+    job->requested_at = esp_timer_get_time();
+    fetch->queued++;
+    fetch->requests++;
+    
+    xSemaphoreGive(fetch->lock);
+    return true;
+}
+
+/**
+ * @brief Pick the next job to start: demand first, then the oldest
+ */
+static fetch_job_t* next_locked(map_tiles_fetch_handle_t fetch)
+{
+    fetch_job_t* next = NULL;
+    for (int i = 0; i < fetch->max_concurrent + fetch->max_queued; i++) {
+        fetch_job_t* job = &fetch->jobs[i];
+        if (job->state != FETCH_QUEUED) continue;
+        if (!next || (job->demand && !next->demand) ||
+            (job->demand == next->demand && job->requested_at < next->requested_at)) {
+            next = job;
+        }
+    }
+    return next;
+}
+
+static fetch_job_t* find_id_locked(map_tiles_fetch_handle_t fetch, uint32_t id)
+{
+    for (int i = 0; i < fetch->max_concurrent + fetch->max_queued; i++) {
+        if (fetch->jobs[i].state == FETCH_RUNNING && fetch->jobs[i].tile.id == id) {
+            return &fetch->jobs[i];
+        }
+    }
+    return NULL;
+}
+
+void map_tiles_fetch_poll(map_tiles_fetch_handle_t fetch)
+{
+    if (!fetch) {
+        return;
+    }
+    
+    for (;;) {
+        xSemaphoreTake(fetch->lock, portMAX_DELAY);
+        fetch_job_t* job = fetch->running < fetch->max_concurrent ? next_locked(fetch) : NULL;
+        if (!job) {
+            xSemaphoreGive(fetch->lock);
+            break;
+        }
+        job->state = FETCH_RUNNING;
+        job->started_at = esp_timer_get_time();
+        fetch->queued--;
+        fetch->running++;
+        map_tiles_fetch_tile_t tile = job->tile;
+        xSemaphoreGive(fetch->lock);
+        
+        // Outside the lock: a backend may complete the fetch right away
+        if (!fetch->backend.start(fetch->backend.ctx, fetch, &tile)) {
+            ESP_LOGW(TAG, "Fetch of zoom %d (%d, %d) did not start", tile.zoom, tile.x, tile.y);
+            map_tiles_fetch_complete(fetch, tile.id, NULL, 0);
+        }
+    }
+    
+    if (fetch->backend.poll) {
+        fetch->backend.poll(fetch->backend.ctx, fetch);
+    }
+}
+
+/**
+ * @brief Write a fetched tile where map_tiles_load_tile() looks for it
+ */
+static bool write_tile(map_tiles_fetch_handle_t fetch, const map_tiles_fetch_tile_t* tile, const uint8_t* data, size_t size)
+{
+    char dir[224];
+    char path[256];
+    char tmp[256];
+    
+    // Create <folder>/<z>/<x> as needed; existing directories fail harmlessly
+    snprintf(dir, sizeof(dir), "%s/%s", fetch->base_path, tile->folder);
+    mkdir(dir, 0775);
+    snprintf(dir, sizeof(dir), "%s/%s/%d", fetch->base_path, tile->folder, tile->zoom);
+    mkdir(dir, 0775);
+    snprintf(dir, sizeof(dir), "%s/%s/%d/%d", fetch->base_path, tile->folder, tile->zoom, tile->x);
+    mkdir(dir, 0775);
+    snprintf(path, sizeof(path), "%s/%d.bin", dir, tile->y);
+    snprintf(tmp, sizeof(tmp), "%s/%d.tmp", dir, tile->y);
+    
+    FILE* f = fopen(tmp, "wb");
+    if (!f) {
+        ESP_LOGE(TAG, "Failed to create %s", tmp);
+        return false;
+    }
+    bool ok = fwrite(data, 1, size, f) == size;
+    ok = (fclose(f) == 0) && ok;
+    
+    // FAT cannot rename over an existing file
+    remove(path);
+    ok = ok && rename(tmp, path) == 0;
+    if (!ok) {
+        ESP_LOGE(TAG, "Failed to write %s", path);
+        remove(tmp);
+    }
+    return ok;
+}
+
+void map_tiles_fetch_complete(map_tiles_fetch_handle_t fetch, uint32_t id, const uint8_t* data, size_t size)
+{
+    if (!fetch) {
+        return;
+    }
+    
+    xSemaphoreTake(fetch->lock, portMAX_DELAY);
+    fetch_job_t* job = find_id_locked(fetch, id);
+    if (!job) {
+        xSemaphoreGive(fetch->lock);
+        ESP_LOGW(TAG, "Completion of unknown fetch %lu", (unsigned long)id);
+        return;
+    }
+    map_tiles_fetch_tile_t tile = job->tile;
+    int64_t requested_at = job->requested_at;
+    int64_t started_at = job->started_at;
+    xSemaphoreGive(fetch->lock);
+    
+    // The job stays running while writing, so the tile is not read half written
+    int64_t fetched_at = esp_timer_get_time();
+    bool ok = data && write_tile(fetch, &tile, data, size);
+    int64_t now = esp_timer_get_time();
+    
+    xSemaphoreTake(fetch->lock, portMAX_DELAY);
+    job = find_id_locked(fetch, id);
+    if (!job) {
+        // Completed twice by the backend while writing; the first one counted
+        xSemaphoreGive(fetch->lock);
+        ESP_LOGW(TAG, "Completion of unknown fetch %lu", (unsigned long)id);
+        return;
+    }
+    job->state = FETCH_FREE;
+    fetch->running--;
+    if (ok) {
+        uint32_t latency = (uint32_t)(now - requested_at);
+        uint32_t fetch_time = (uint32_t)(fetched_at - started_at);
+        fetch->fetched++;
+        fetch->bytes_written += size;
+        fetch->latency_us += latency;
+        fetch->fetch_time_us += fetch_time;
+        fetch->latency_peak_us = latency > fetch->latency_peak_us ? latency : fetch->latency_peak_us;
+        fetch->fetch_time_peak_us = fetch_time > fetch->fetch_time_peak_us ? fetch_time : fetch->fetch_time_peak_us;
+    } else {
+        fetch->failed++;
+    }
+    xSemaphoreGive(fetch->lock);
+    
+    if (ok) {
+        ESP_LOGD(TAG, "Fetched %s zoom %d (%d, %d): %zu bytes", tile.folder, tile.zoom, tile.x, tile.y, size);
+    } else if (!data) {
+        ESP_LOGW(TAG, "Fetch of %s zoom %d (%d, %d) failed", tile.folder, tile.zoom, tile.x, tile.y);
+    }
+}
+
+bool map_tiles_fetch_get_stats(map_tiles_fetch_handle_t fetch, map_tiles_fetch_stats_t* stats)
+{
+    if (!fetch || !stats) {
+        ESP_LOGE(TAG, "Invalid fetch stats arguments");
+        return false;
+    }
+    
+    xSemaphoreTake(fetch->lock, portMAX_DELAY);
+    
+    memset(stats, 0, sizeof(*stats));
+    stats->requests = fetch->requests;
+    stats->coalesced = fetch->coalesced;
+    stats->rejected = fetch->rejected;
+    stats->fetched = fetch->fetched;
+    stats->failed = fetch->failed;
+    stats->bytes_written = fetch->bytes_written;
+    stats->latency_avg_us = fetch->fetched ? (uint32_t)(fetch->latency_us / fetch->fetched) : 0;
+    stats->latency_peak_us = fetch->latency_peak_us;
+    stats->fetch_time_avg_us = fetch->fetched ? (uint32_t)(fetch->fetch_time_us / fetch->fetched) : 0;
+    stats->fetch_time_peak_us = fetch->fetch_time_peak_us;
+    stats->queued = fetch->queued;
+    stats->in_flight = fetch->running;
+    
+    xSemaphoreGive(fetch->lock);
+    return true;
+}
+
+void map_tiles_fetch_reset_stats(map_tiles_fetch_handle_t fetch)
+{
+    if (!fetch) {
+        return;
+    }
+    
+    xSemaphoreTake(fetch->lock, portMAX_DELAY);
+    fetch->requests = 0;
+    fetch->coalesced = 0;
+    fetch->rejected = 0;
+    fetch->fetched = 0;
+    fetch->failed = 0;
+    fetch->bytes_written = 0;
+    fetch->latency_us = 0;
+    fetch->fetch_time_us = 0;
+    fetch->latency_peak_us = 0;
+    fetch->fetch_time_peak_us = 0;
+    xSemaphoreGive(fetch->lock);
+}
+
+void map_tiles_fetch_destroy(map_tiles_fetch_handle_t fetch)
+{
+    if (!fetch) {
+        return;
+    }
+    
+    if (fetch->backend.destroy) {
+        fetch->backend.destroy(fetch->backend.ctx);
+    }
+    vSemaphoreDelete(fetch->lock);
+    map_tiles_mem_free(fetch->jobs);
+    map_tiles_mem_free(fetch->base_path);
+    map_tiles_mem_free(fetch);
+}
+
+map_tiles_mem_account_t* map_tiles_fetch_memory(map_tiles_fetch_handle_t fetch)
+{
+    return &fetch->memory;
+}
+
+/**
+ * @brief Local directory backend: fetches started since the last poll
+ */
+typedef struct {
+    char* root;
+    map_tiles_fetch_tile_t* started;
+    int count;
+    int capacity;
+    map_tiles_mem_account_t* memory;                                /**< Account of the fetcher, from the first start on */
+} local_backend_t;
+
+static bool local_start(void* ctx, map_tiles_fetch_handle_t fetch, const map_tiles_fetch_tile_t* tile)
+{
+    local_backend_t* local = (local_backend_t*)ctx;
+    if (!local->memory) {
+        // Created before the fetcher, so charged to it once it uses the backend
+        local->memory = map_tiles_fetch_memory(fetch);
+        map_tiles_mem_assign(local, local->memory);
+        map_tiles_mem_assign(local->root, local->memory);
+    }
+    if (local->count == local->capacity) {
+        int capacity = local->capacity ? local->capacity * 2 : 8;
+        map_tiles_fetch_tile_t* started = (map_tiles_fetch_tile_t*)map_tiles_mem_realloc(
+            local->memory, MAP_TILES_MEM_FETCH, local->started, capacity * sizeof(map_tiles_fetch_tile_t));
+        if (!started) {
+            return false;
+        }
+        local->started = started;
+        local->capacity = capacity;
+    }
+    local->started[local->count++] = *tile;
+    return true;
+}
+
+static void local_poll(void* ctx, map_tiles_fetch_handle_t fetch)
+{
+    local_backend_t* local = (local_backend_t*)ctx;
+    for (int i = 0; i < local->count; i++) {
+        const map_tiles_fetch_tile_t* tile = &local->started[i];
+        char path[256];
+        snprintf(path, sizeof(path), "%s/%s/%d/%d/%d.bin", local->root, tile->folder, tile->zoom, tile->x, tile->y);
+        
+        uint8_t* data = NULL;
+        size_t size = 0;
+        FILE* f = fopen(path, "rb");
+        if (f) {
+            fseek(f, 0, SEEK_END);
+            long length = ftell(f);
+            fseek(f, 0, SEEK_SET);
+            data = length > 0 && length <= LOCAL_MAX_FILE_BYTES ?
+                   (uint8_t*)map_tiles_mem_alloc(local->memory, MAP_TILES_MEM_FETCH, length, 0) : NULL;
+            size = data ? fread(data, 1, length, f) : 0;
+            fclose(f);
+            if (data && size != (size_t)length) {
+                map_tiles_mem_free(data);
+                data = NULL;
+            }
+        }
+        if (!data) {
+            ESP_LOGD(TAG, "Not on the tile server: %s", path);
+        }
+        map_tiles_fetch_complete(fetch, tile->id, data, size);
+        map_tiles_mem_free(data);
+    }
+    local->count = 0;
+}
+
+static void local_destroy(void* ctx)
+{
+    local_backend_t* local = (local_backend_t*)ctx;
+    map_tiles_mem_free(local->started);
+    map_tiles_mem_free(local->root);
+    map_tiles_mem_free(local);
+}
+
+bool map_tiles_fetch_local_backend(const char* root_path, map_tiles_fetch_backend_t* backend)
+{
+    if (!root_path || !backend) {
+        ESP_LOGE(TAG, "Invalid local backend arguments");
+        return false;
+    }
+    
+    local_backend_t* local = (local_backend_t*)map_tiles_mem_calloc(NULL, MAP_TILES_MEM_FETCH, 1, sizeof(local_backend_t), 0);
+    char* root = map_tiles_mem_strdup(NULL, MAP_TILES_MEM_FETCH, root_path);
+    if (!local || !root) {
+        ESP_LOGE(TAG, "Failed to allocate local backend");
+        map_tiles_mem_free(local);
+        map_tiles_mem_free(root);
+        return false;
+    }
+    local->root = root;
+    
+    backend->start = local_start;
+    backend->poll = local_poll;
+    backend->destroy = local_destroy;
+    backend->ctx = local;
+    return true;
+}
+
+/**
+ * @brief Tile folder of a map tile source, NULL for DEM and shaded sources
+ */
+static const char* key_folder(map_tiles_handle_t handle, const map_tiles_key_t* key)
+{
+    for (int type = 0; type < handle->tile_type_count; type++) {
+        if (handle->source_ids[type] == key->source) {
+            return handle->tile_folders[type];
+        }
+    }
+    return NULL;
+}
+
+bool map_tiles_fetch_missing(map_tiles_handle_t handle, const map_tiles_key_t* key, bool demand)
+{
+    const char* folder = handle->fetch ? key_folder(handle, key) : NULL;
+    return folder && map_tiles_fetch_request(handle->fetch, folder, key->zoom, key->x, key->y, demand);
+}
+
+bool map_tiles_fetch_waiting(map_tiles_handle_t handle, const map_tiles_key_t* key)
+{
+    const char* folder = handle->fetch ? key_folder(handle, key) : NULL;
+    if (!folder) {
+        return false;
+    }
+    
+    xSemaphoreTake(handle->fetch->lock, portMAX_DELAY);
+    bool waiting = find_locked(handle->fetch, folder, key->zoom, key->x, key->y) != NULL;
+    xSemaphoreGive(handle->fetch->lock);
+    return waiting;
+}
+
+bool map_tiles_set_fetch(map_tiles_handle_t handle, map_tiles_fetch_handle_t fetch)
+{
+    if (!handle || !handle->initialized) {
+        ESP_LOGE(TAG, "Handle not initialized");
+        return false;
+    }
+    
+    if (fetch && strcmp(fetch->base_path, handle->base_path) != 0) {
+        ESP_LOGW(TAG, "Fetcher writes to %s, tiles are read from %s", fetch->base_path, handle->base_path);
+    }
+    
+    // Slots waiting for the previous fetcher are read again, and then reported missing
+    for (int i = 0; i < handle->tile_count; i++) {
+        map_tiles_slot_t* slot = &handle->slots[i];
+        if (slot->fetching) {
+            slot->fetching = false;
+            slot->fetched = !fetch;
+            handle->requests[i] = slot->key;
+            handle->requested[i] = true;
+        }
+    }
+    handle->fetch = fetch;
+    return true;
+}
@@ -0,0 +1,492 @@
+#include "map_tiles_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "esp_log.h"
+
+static const char* TAG = "map_tiles_geometry";
+
+#define GEO_INDEX_MAX_CELLS_PER_POLYGON 64                          /**< Larger polygons are tested on every query */
+
+/**
+ * @brief View rectangle with the wrap width of the projection
+ */
+typedef struct {
+    int64_t min_x;
+    int64_t min_y;
+    int64_t width;
+    int64_t height;
+    int64_t world_width;                                            /**< 0 if columns do not wrap */
+    int shift;                                                      /**< World units per current zoom pixel, as a shift */
+} view_t;
+
+/**
+ * @brief Polygon referenced by the index
+ */
+typedef struct {
+    const map_tiles_world_point_t* points;
+    int count;
+    int id;
+    map_tiles_world_rect_t bounds;                                  /**< Unwrapped bounding box */
+    uint32_t stamp;                                                 /**< Last query that reported this polygon */
+    bool large;
+} geo_entry_t;
+
+/**
+ * @brief Polygon registered in one cell
+ */
+typedef struct {
+    uint64_t cell;
+    int entry;
+} geo_cell_ref_t;
+
+struct map_tiles_geo_index_t {
+    geo_entry_t* entries;
+    int entry_count;
+    int entry_capacity;
+    geo_cell_ref_t* refs;
+    int ref_count;
+    int ref_capacity;
+    bool sorted;
+    int* large;
+    int large_count;
+    int large_capacity;
+    int cell_shift;                                                 /**< log2 of the cell size in world units */
+    int64_t world_width;
+    uint32_t stamp;
+    map_tiles_mem_account_t* memory;                                /**< Account of the handle the index was created for */
+};
+
+static void view_init(map_tiles_handle_t handle, view_t* view)
+{
+    view->shift = MAP_TILES_MAX_ZOOM - handle->zoom;
+    view->min_x = map_tiles_shl((int64_t)handle->tile_x * MAP_TILES_TILE_SIZE, view->shift);
+    view->min_y = map_tiles_shl((int64_t)handle->tile_y * MAP_TILES_TILE_SIZE, view->shift);
+    view->width = map_tiles_shl((int64_t)handle->grid_cols * MAP_TILES_TILE_SIZE, view->shift);
+    view->height = map_tiles_shl((int64_t)handle->grid_rows * MAP_TILES_TILE_SIZE, view->shift);
+    view->world_width = map_tiles_world_wrap_width(handle);
+}
+
+/**
+ * @brief X relative to the view origin, taking the short way around the world
+ */
+static int64_t view_local_x(const view_t* view, int64_t x)
+{
+    int64_t dx = x - view->min_x;
+    if (view->world_width) {
+        dx = map_tiles_wrap(dx, view->world_width);
+        if (dx > (view->width + view->world_width) / 2) {
+            dx -= view->world_width;
+        }
+    }
+    return dx;
+}
+
+static bool view_contains(const view_t* view, int64_t lx, int64_t ly)
+{
+    return lx >= 0 && lx < view->width && ly >= 0 && ly < view->height;
+}
+
+/**
+ * @brief Liang-Barsky test of segment (x0, y0)-(x1, y1) against [0, w] x [0, h]
+ */
+static bool segment_hits_rect(double x0, double y0, double x1, double y1, double w, double h)
+{
+    double t0 = 0.0;
+    double t1 = 1.0;
+    double dx = x1 - x0;
+    double dy = y1 - y0;
+    double p[4] = { -dx, dx, -dy, dy };
+    double q[4] = { x0, w - x0, y0, h - y0 };
+    
+    for (int i = 0; i < 4; i++) {
+        if (p[i] == 0.0) {
+            if (q[i] < 0.0) return false;
+            continue;
+        }
+        double t = q[i] / p[i];
+        if (p[i] < 0.0) {
+            if (t > t1) return false;
+            if (t > t0) t0 = t;
+        } else {
+            if (t < t0) return false;
+            if (t < t1) t1 = t;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Polygon versus view test on view-local coordinates
+ * 
+ * Vertices are unwrapped from the first one, so polygons crossing the
+ * antimeridian stay contiguous.
+ */
+static bool polygon_hits_view(const view_t* view, const map_tiles_world_point_t* polygon, int count)
+{
+    if (count <= 0) {
+        return false;
+    }
+    
+    double w = (double)view->width;
+    double h = (double)view->height;
+    int64_t lx = view_local_x(view, polygon[0].x);
+    int64_t ly = polygon[0].y - view->min_y;
+    double first_x = (double)lx;
+    double first_y = (double)ly;
+    double prev_x = first_x;
+    double prev_y = first_y;
+    double cx = w / 2;
+    double cy = h / 2;
+    bool center_inside = false;
+    
+    for (int i = 0; i < count; i++) {
+        if (i > 0) {
+            lx += map_tiles_wrap_delta(polygon[i].x - polygon[i - 1].x, view->world_width);
+            ly = polygon[i].y - view->min_y;
+        }
+        if (view_contains(view, lx, ly)) {
+            return true;
+        }
+        
+        double x = (double)lx;
+        double y = (double)ly;
+        if (i > 0 && segment_hits_rect(prev_x, prev_y, x, y, w, h)) {
+            return true;
+        }
+        
+        // Even-odd crossing count for the view centre
+        if (i > 0 && ((prev_y > cy) != (y > cy)) && cx < prev_x + (x - prev_x) * (cy - prev_y) / (y - prev_y)) {
+            center_inside = !center_inside;
+        }
+        prev_x = x;
+        prev_y = y;
+    }
+    
+    // Closing edge
+    if (count > 1 && segment_hits_rect(prev_x, prev_y, first_x, first_y, w, h)) {
+        return true;
+    }
+    if (count > 2 && ((prev_y > cy) != (first_y > cy)) &&
+        cx < prev_x + (first_x - prev_x) * (cy - prev_y) / (first_y - prev_y)) {
+        center_inside = !center_inside;
+    }
+    
+    // No vertex or edge inside: the polygon either surrounds the view or misses it
+    return center_inside;
+}
+
+void map_tiles_get_view_rect(map_tiles_handle_t handle, map_tiles_world_rect_t* rect)
+{
+    if (!handle || !handle->initialized || !rect) {
+        ESP_LOGE(TAG, "Handle not initialized");
+        return;
+    }
+    
+    view_t view;
+    view_init(handle, &view);
+    rect->min_x = view.min_x;
+    rect->min_y = view.min_y;
+    rect->max_x = view.min_x + view.width;
+    rect->max_y = view.min_y + view.height;
+}
+
+int map_tiles_points_in_view(map_tiles_handle_t handle, const map_tiles_world_point_t* points, int count, bool* inside)
+{
+    if (!handle || !handle->initialized || (!points && count > 0)) {
+        ESP_LOGE(TAG, "Invalid parameters");
+        return 0;
+    }
+    
+    view_t view;
+    view_init(handle, &view);
+    
+    int hits = 0;
+    for (int i = 0; i < count; i++) {
+        bool in = view_contains(&view, view_local_x(&view, points[i].x), points[i].y - view.min_y);
+        if (inside) inside[i] = in;
+        hits += in;
+    }
+    return hits;
+}
+
+bool map_tiles_polygon_intersects_view(map_tiles_handle_t handle, const map_tiles_world_point_t* polygon, int count)
+{
+    if (!handle || !handle->initialized || !polygon) {
+        ESP_LOGE(TAG, "Invalid parameters");
+        return false;
+    }
+    
+    view_t view;
+    view_init(handle, &view);
+    return polygon_hits_view(&view, polygon, count);
+}
+
+double map_tiles_distance_to_view_edge(map_tiles_handle_t handle, const map_tiles_world_point_t* point)
+{
+    if (!handle || !handle->initialized || !point) {
+        ESP_LOGE(TAG, "Invalid parameters");
+        return 0.0;
+    }
+    
+    view_t view;
+    view_init(handle, &view);
+    double lx = (double)view_local_x(&view, point->x);
+    double ly = (double)(point->y - view.min_y);
+    double w = (double)view.width;
+    double h = (double)view.height;
+    
+    double distance;
+    if (lx >= 0 && lx < w && ly >= 0 && ly < h) {
+        distance = fmin(fmin(lx, w - lx), fmin(ly, h - ly));
+    } else {
+        double dx = lx < 0 ? -lx : (lx > w ? lx - w : 0.0);
+        double dy = ly < 0 ? -ly : (ly > h ? ly - h : 0.0);
+        distance = -sqrt(dx * dx + dy * dy);
+    }
+    return ldexp(distance, -view.shift);
+}
+
+map_tiles_geo_index_handle_t map_tiles_geo_index_create(map_tiles_handle_t handle, int cell_zoom)
+{
+    if (!handle || !handle->initialized || cell_zoom < 0 || cell_zoom > MAP_TILES_MAX_ZOOM) {
+        ESP_LOGE(TAG, "Invalid geo index parameters");
+        return NULL;
+    }
+    
+    map_tiles_geo_index_handle_t index = (map_tiles_geo_index_handle_t)map_tiles_mem_calloc(
+        &handle->memory, MAP_TILES_MEM_INDICES, 1, sizeof(struct map_tiles_geo_index_t), 0);
+    if (!index) {
+        ESP_LOGE(TAG, "Failed to allocate geo index");
+        return NULL;
+    }
+    
+    index->cell_shift = MAP_TILES_WORLD_SHIFT - cell_zoom;
+    index->world_width = map_tiles_world_wrap_width(handle);
+    index->memory = &handle->memory;
+    return index;
+}
+
+static uint64_t cell_key(int64_t cx, int64_t cy)
+{
+    // Truncation only merges distant cells, which costs extra candidates, never misses
+    return ((uint64_t)(uint32_t)cx << 32) | (uint32_t)cy;
+}
+
+static int64_t cell_wrap(const map_tiles_geo_index_handle_t index, int64_t cx)
+{
+    int64_t cells = index->world_width >> index->cell_shift;
+    return cells > 0 ? map_tiles_wrap(cx, cells) : cx;
+}
+
+static bool add_ref(map_tiles_geo_index_handle_t index, uint64_t cell, int entry)
+{
+    if (index->ref_count == index->ref_capacity) {
+        int capacity = index->ref_capacity ? index->ref_capacity * 2 : 64;
+        geo_cell_ref_t* refs = (geo_cell_ref_t*)map_tiles_mem_realloc(index->memory, MAP_TILES_MEM_INDICES, index->refs,
+                                                                      capacity * sizeof(geo_cell_ref_t));
+        if (!refs) {
+            return false;
+        }
+        index->refs = refs;
+        index->ref_capacity = capacity;
+    }
+    
+    index->refs[index->ref_count].cell = cell;
+    index->refs[index->ref_count].entry = entry;
+    index->ref_count++;
+    return true;
+}
+
+bool map_tiles_geo_index_add(map_tiles_geo_index_handle_t index, int id, const map_tiles_world_point_t* polygon, int count)
+{
+    if (!index || !polygon || count <= 0) {
+        ESP_LOGE(TAG, "Invalid parameters");
+        return false;
+    }
+    
+    if (index->entry_count == index->entry_capacity) {
+        int capacity = index->entry_capacity ? index->entry_capacity * 2 : 32;
+        geo_entry_t* entries = (geo_entry_t*)map_tiles_mem_realloc(index->memory, MAP_TILES_MEM_INDICES, index->entries,
+                                                                   capacity * sizeof(geo_entry_t));
+        if (!entries) {
+            ESP_LOGE(TAG, "Failed to grow geo index");
+            return false;
+        }
+        index->entries = entries;
+        index->entry_capacity = capacity;
+    }
+    
+    // Bounding box of the polygon unwrapped from its first vertex
+    geo_entry_t* entry = &index->entries[index->entry_count];
+    memset(entry, 0, sizeof(*entry));
+    entry->points = polygon;
+    entry->count = count;
+    entry->id = id;
+    int64_t x = polygon[0].x;
+    entry->bounds.min_x = entry->bounds.max_x = x;
+    entry->bounds.min_y = entry->bounds.max_y = polygon[0].y;
+    for (int i = 1; i < count; i++) {
+        x += map_tiles_wrap_delta(polygon[i].x - polygon[i - 1].x, index->world_width);
+        if (x < entry->bounds.min_x) entry->bounds.min_x = x;
+        if (x > entry->bounds.max_x) entry->bounds.max_x = x;
+        if (polygon[i].y < entry->bounds.min_y) entry->bounds.min_y = polygon[i].y;
+        if (polygon[i].y > entry->bounds.max_y) entry->bounds.max_y = polygon[i].y;
+    }
+    
+    int64_t cx0 = entry->bounds.min_x >> index->cell_shift;
+    int64_t cx1 = entry->bounds.max_x >> index->cell_shift;
+    int64_t cy0 = entry->bounds.min_y >> index->cell_shift;
+    int64_t cy1 = entry->bounds.max_y >> index->cell_shift;
+    int entry_index = index->entry_count;
+    
+    if ((cx1 - cx0 + 1) * (cy1 - cy0 + 1) > GEO_INDEX_MAX_CELLS_PER_POLYGON) {
+        if (index->large_count == index->large_capacity) {
+            int capacity = index->large_capacity ? index->large_capacity * 2 : 8;
+            int* large = (int*)map_tiles_mem_realloc(index->memory, MAP_TILES_MEM_INDICES, index->large, capacity * sizeof(int));
+            if (!large) {
+                ESP_LOGE(TAG, "Failed to grow geo index");
+                return false;
+            }
+            index->large = large;
+            index->large_capacity = capacity;
+        }
+        entry->large = true;
+        index->large[index->large_count++] = entry_index;
+    } else {
+        int ref_count = index->ref_count;
+        for (int64_t cy = cy0; cy <= cy1; cy++) {
+            for (int64_t cx = cx0; cx <= cx1; cx++) {
+                if (!add_ref(index, cell_key(cell_wrap(index, cx), cy), entry_index)) {
+                    index->ref_count = ref_count;
+                    ESP_LOGE(TAG, "Failed to grow geo index");
+                    return false;
+                }
+            }
+        }
+        index->sorted = false;
+    }
+    
+    index->entry_count++;
+    return true;
+}
+
+static int compare_refs(const void* a, const void* b)
+{
+    const geo_cell_ref_t* ra = (const geo_cell_ref_t*)a;
+    const geo_cell_ref_t* rb = (const geo_cell_ref_t*)b;
+    if (ra->cell != rb->cell) return ra->cell < rb->cell ? -1 : 1;
+    return ra->entry - rb->entry;
+}
+
+static int lower_bound(const geo_cell_ref_t* refs, int count, uint64_t cell)
+{
+    int lo = 0;
+    int hi = count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (refs[mid].cell < cell) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/**
+ * @brief Exact test of a candidate, reporting each polygon once per query
+ */
+static void query_entry(map_tiles_geo_index_handle_t index, const view_t* view, int entry_index,
+                        int* ids, int max_ids, int* found)
+{
+    geo_entry_t* entry = &index->entries[entry_index];
+    if (entry->stamp == index->stamp) {
+        return;
+    }
+    entry->stamp = index->stamp;
+    
+    if (polygon_hits_view(view, entry->points, entry->count)) {
+        if (*found < max_ids) {
+            ids[*found] = entry->id;
+        }
+        (*found)++;
+    }
+}
+
+int map_tiles_geo_index_query_view(map_tiles_geo_index_handle_t index, map_tiles_handle_t handle, int* ids, int max_ids)
+{
+    if (!index || !handle || !handle->initialized || (!ids && max_ids > 0)) {
+        ESP_LOGE(TAG, "Invalid parameters");
+        return 0;
+    }
+    
+    if (!index->sorted) {
+        qsort(index->refs, index->ref_count, sizeof(geo_cell_ref_t), compare_refs);
+        index->sorted = true;
+    }
+    
+    // A new stamp invalidates the "already reported" marks of the previous query
+    if (++index->stamp == 0) {
+        for (int i = 0; i < index->entry_count; i++) {
+            index->entries[i].stamp = 0;
+        }
+        index->stamp = 1;
+    }
+    
+    view_t view;
+    view_init(handle, &view);
+    
+    int found = 0;
+    int64_t cx0 = view.min_x >> index->cell_shift;
+    int64_t cx1 = (view.min_x + view.width - 1) >> index->cell_shift;
+    int64_t cy0 = view.min_y >> index->cell_shift;
+    int64_t cy1 = (view.min_y + view.height - 1) >> index->cell_shift;
+    
+    if ((cx1 - cx0 + 1) * (cy1 - cy0 + 1) > index->ref_count) {
+        // The view spans more cells than there are references: scan everything
+        for (int i = 0; i < index->entry_count; i++) {
+            query_entry(index, &view, i, ids, max_ids, &found);
+        }
+        return found;
+    }
+    
+    for (int64_t cy = cy0; cy <= cy1; cy++) {
+        for (int64_t cx = cx0; cx <= cx1; cx++) {
+            uint64_t cell = cell_key(cell_wrap(index, cx), cy);
+            for (int i = lower_bound(index->refs, index->ref_count, cell);
+                 i < index->ref_count && index->refs[i].cell == cell; i++) {
+                query_entry(index, &view, index->refs[i].entry, ids, max_ids, &found);
+            }
+        }
+    }
+    
+    for (int i = 0; i < index->large_count; i++) {
+        query_entry(index, &view, index->large[i], ids, max_ids, &found);
+    }
+    return found;
+}
+
+void map_tiles_geo_index_clear(map_tiles_geo_index_handle_t index)
+{
+    if (!index) {
+        return;
+    }
+    
+    index->entry_count = 0;
+    index->ref_count = 0;
+    index->large_count = 0;
+    index->sorted = true;
+}
+
+void map_tiles_geo_index_destroy(map_tiles_geo_index_handle_t index)
+{
+    if (!index) {
+        return;
+    }
+    
+    map_tiles_mem_free(index->entries);
+    map_tiles_mem_free(index->refs);
+    map_tiles_mem_free(index->large);
+    map_tiles_mem_free(index);
+}
@@ -0,0 +1,303 @@
+#include "map_tiles_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+
+static const char* TAG = "map_tiles_hillshade";
+
+// Shade lookup over quantised slopes dz/dx, dz/dy in [-2, 2)
+#define LUT_SIZE 128
+#define LUT_STEPS_PER_UNIT 32
+#define LUT_HALF (LUT_SIZE / 2)
+
+#define DEM_SIZE MAP_TILES_TILE_SIZE
+
+bool map_tiles_hillshade_init(map_tiles_handle_t handle, const map_tiles_config_t* config)
+{
+    handle->dem_source = -1;
+    handle->dem_max_zoom = config->dem_max_zoom > 0 ? config->dem_max_zoom : MAP_TILES_MAX_ZOOM;
+    if (!config->dem_folder) {
+        return true;
+    }
+    
+    handle->dem_source = map_tiles_cache_register_source(handle->cache, handle->base_path, config->dem_folder);
+    if (handle->dem_source < 0) {
+        return false;
+    }
+    
+    // Shaded tiles depend on this handle's sun, so they get sources of their own
+    for (int i = 0; i < handle->tile_type_count; i++) {
+        char name[MAP_TILES_MAX_FOLDER_NAME + 32];
+        snprintf(name, sizeof(name), "%s#hillshade@%p", handle->tile_folders[i], (void*)handle);
+        handle->shaded_source_ids[i] = map_tiles_cache_register_source(handle->cache, handle->base_path, name);
+        if (handle->shaded_source_ids[i] < 0) {
+            while (--i >= 0) {
+                map_tiles_cache_unregister_source(handle->cache, handle->shaded_source_ids[i]);
+            }
+            handle->dem_source = -1;
+            return false;
+        }
+    }
+    return true;
+}
+
+void map_tiles_hillshade_cleanup(map_tiles_handle_t handle)
+{
+    if (handle->dem_source >= 0) {
+        // The sources are private to this handle, so a shared cache must not
+        // keep them, and a later handle at the same address must not find them
+        for (int i = 0; i < handle->tile_type_count; i++) {
+            map_tiles_cache_unregister_source(handle->cache, handle->shaded_source_ids[i]);
+        }
+    }
+    map_tiles_mem_free(handle->hillshade_lut);
+    handle->hillshade_lut = NULL;
+}
+
+bool map_tiles_hillshade_active(map_tiles_handle_t handle)
+{
+    return handle->hillshade_lut != NULL;
+}
+
+bool map_tiles_set_hillshade(map_tiles_handle_t handle, const map_tiles_hillshade_config_t* config)
+{
+    if (!handle || !handle->initialized) {
+        ESP_LOGE(TAG, "Handle not initialized");
+        return false;
+    }
+    
+    if (handle->dem_source < 0) {
+        ESP_LOGE(TAG, "Hillshading requires dem_folder in the configuration");
+        return false;
+    }
+    
+    if (config && (config->altitude_deg <= 0 || config->altitude_deg > 90 || config->z_factor <= 0)) {
+        ESP_LOGE(TAG, "Invalid hillshade parameters");
+        return false;
+    }
+    
+    // Shading done with the previous sun is no longer valid
+    for (int i = 0; i < handle->tile_type_count; i++) {
+        map_tiles_cache_invalidate_source(handle->cache, handle->shaded_source_ids[i]);
+    }
+    
+    if (!config) {
+        map_tiles_mem_free(handle->hillshade_lut);
+        handle->hillshade_lut = NULL;
+        ESP_LOGI(TAG, "Hillshading disabled");
+        return true;
+    }
+    
+    if (!handle->hillshade_lut) {
+        handle->hillshade_lut = (uint8_t*)map_tiles_mem_alloc(&handle->memory, MAP_TILES_MEM_HILLSHADE, LUT_SIZE * LUT_SIZE, 0);
+        if (!handle->hillshade_lut) {
+            ESP_LOGE(TAG, "Failed to allocate hillshade table");
+            return false;
+        }
+    }
+    
+    // Sun direction with x east, y south (down the tile) and z up
+    double azimuth = config->azimuth_deg * M_PI / 180.0;
+    double altitude = config->altitude_deg * M_PI / 180.0;
+    double lx = sin(azimuth) * cos(altitude);
+    double ly = -cos(azimuth) * cos(altitude);
+    double lz = sin(altitude);
+    double strength = config->strength / 255.0;
+    
+    // Lambert shading of the surface normal (-p, -q, 1), multiplied over the base map
+    for (int j = 0; j < LUT_SIZE; j++) {
+        double q = (double)(j - LUT_HALF) / LUT_STEPS_PER_UNIT;
+        for (int i = 0; i < LUT_SIZE; i++) {
+            double p = (double)(i - LUT_HALF) / LUT_STEPS_PER_UNIT;
+            double shade = (-p * lx - q * ly + lz) / sqrt(1.0 + p * p + q * q);
+            if (shade < 0.0) shade = 0.0;
+            double factor = 1.0 - strength * (1.0 - shade);
+            handle->hillshade_lut[j * LUT_SIZE + i] = (uint8_t)lrint(factor * 255.0);
+        }
+    }
+    handle->hillshade_z_factor = config->z_factor;
+    
+    ESP_LOGI(TAG, "Hillshading: sun %.0f/%.0f deg, z factor %.2f, strength %d",
+             config->azimuth_deg, config->altitude_deg, config->z_factor, config->strength);
+    return true;
+}
+
+/**
+ * @brief Get the DEM tile covering a map tile from the cache or storage
+ */
+static map_tiles_cache_entry_t* acquire_dem(map_tiles_handle_t handle, const map_tiles_key_t* dem_key)
+{
+    map_tiles_cache_entry_t* entry = map_tiles_cache_get(handle->cache, dem_key);
+    if (entry) {
+        return entry;
+    }
+    
+    int64_t start = esp_timer_get_time();
+    FILE* f = map_tiles_open_tile(handle, dem_key);
+    if (!f) {
+        return NULL;
+    }
+    
+    bool existing;
+    entry = map_tiles_cache_claim(handle->cache, dem_key, MAP_TILES_CLAIM_DEMAND, &existing);
+    if (!entry) {
+        fclose(f);
+        return NULL;
+    }
+    if (existing) {
+        fclose(f);
+    } else {
+        bool ok = map_tiles_read_tile(f, entry->buf);
+        map_tiles_stats_load(handle, false, MAP_TILES_TILE_HEADER_SIZE + MAP_TILES_TILE_BYTES, esp_timer_get_time() - start);
+        map_tiles_cache_publish(handle->cache, entry, ok, true);
+        if (!ok) {
+            return NULL;
+        }
+    }
+    return entry;
+}
+
+static inline uint16_t shade_pixel(uint16_t p, uint32_t factor)
+{
+    // factor is 1..256
+    uint32_t r = ((p >> 11) * factor) >> 8;
+    uint32_t g = (((p >> 5) & 0x3F) * factor) >> 8;
+    uint32_t b = ((p & 0x1F) * factor) >> 8;
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+/**
+ * @brief Shade of DEM sample (x, y) from a 3x3 Sobel kernel, clamping at the tile edge
+ */
+static inline uint8_t sobel_shade(const int16_t* dem, int x, int y, float kx, float ky, const uint8_t* lut)
+{
+    const int16_t* up = dem + (y > 0 ? y - 1 : 0) * DEM_SIZE;
+    const int16_t* row = dem + y * DEM_SIZE;
+    const int16_t* down = dem + (y < DEM_SIZE - 1 ? y + 1 : DEM_SIZE - 1) * DEM_SIZE;
+    int l = x > 0 ? x - 1 : 0;
+    int r = x < DEM_SIZE - 1 ? x + 1 : DEM_SIZE - 1;
+    
+    int32_t gx = (up[r] + 2 * row[r] + down[r]) - (up[l] + 2 * row[l] + down[l]);
+    int32_t gy = (down[l] + 2 * down[x] + down[r]) - (up[l] + 2 * up[x] + up[r]);
+    
+    int i = (int)lrintf(gx * kx) + LUT_HALF;
+    int j = (int)lrintf(gy * ky) + LUT_HALF;
+    i = i < 0 ? 0 : (i >= LUT_SIZE ? LUT_SIZE - 1 : i);
+    j = j < 0 ? 0 : (j >= LUT_SIZE ? LUT_SIZE - 1 : j);
+    return lut[j * LUT_SIZE + i];
+}
+
+/**
+ * @brief Shade a tile at DEM resolution, one Sobel evaluation per pixel
+ */
+static void shade_full(uint16_t* pixels, const int16_t* dem, float k, const uint8_t* lut)
+{
+    for (int y = 0; y < DEM_SIZE; y++) {
+        uint16_t* out = pixels + y * MAP_TILES_TILE_SIZE;
+        for (int x = 0; x < DEM_SIZE; x++) {
+            out[x] = shade_pixel(out[x], sobel_shade(dem, x, y, k, k, lut) + 1u);
+        }
+    }
+}
+
+/**
+ * @brief Shade a tile deeper than the DEM: shade the covering DEM samples and
+ *        interpolate them bilinearly, 2^dz output pixels per sample
+ */
+static bool shade_upsampled(uint16_t* pixels, const int16_t* dem, int dz, int sx0, int sy0, float k,
+                            const uint8_t* lut, map_tiles_handle_t handle)
+{
+    // Samples sx0 - 1 .. sx0 + sub, so every pixel centre has neighbours on both sides
+    int sub = DEM_SIZE >> dz;
+    int n = sub + 2;
+    uint32_t caps = handle->use_spiram ? (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT) : MALLOC_CAP_8BIT;
+    uint8_t* shade = (uint8_t*)map_tiles_mem_alloc(&handle->memory, MAP_TILES_MEM_HILLSHADE, n * n, caps);
+    if (!shade) {
+        return false;
+    }
+    
+    for (int j = 0; j < n; j++) {
+        int y = sy0 - 1 + j;
+        y = y < 0 ? 0 : (y >= DEM_SIZE ? DEM_SIZE - 1 : y);
+        for (int i = 0; i < n; i++) {
+            int x = sx0 - 1 + i;
+            x = x < 0 ? 0 : (x >= DEM_SIZE ? DEM_SIZE - 1 : x);
+            shade[j * n + i] = sobel_shade(dem, x, y, k, k, lut);
+        }
+    }
+    
+    // Pixel centre p maps to sample (p + 0.5) / 2^dz - 0.5, in 1/256 units and offset by one sample
+    for (int py = 0; py < MAP_TILES_TILE_SIZE; py++) {
+        int v = ((2 * py + 1) * 128 >> dz) + 128;
+        int j = v >> 8;
+        int fy = v & 0xFF;
+        const uint8_t* s0 = shade + j * n;
+        const uint8_t* s1 = s0 + n;
+        uint16_t* out = pixels + py * MAP_TILES_TILE_SIZE;
+        for (int px = 0; px < MAP_TILES_TILE_SIZE; px++) {
+            int u = ((2 * px + 1) * 128 >> dz) + 128;
+            int i = u >> 8;
+            int fx = u & 0xFF;
+            uint32_t top = s0[i] * (256 - fx) + s0[i + 1] * fx;
+            uint32_t bottom = s1[i] * (256 - fx) + s1[i + 1] * fx;
+            uint32_t factor = (top * (256 - fy) + bottom * fy) >> 16;
+            out[px] = shade_pixel(out[px], factor + 1u);
+        }
+    }
+    map_tiles_mem_free(shade);
+    return true;
+}
+
+void map_tiles_hillshade_apply(map_tiles_handle_t handle, const map_tiles_key_t* key, uint8_t* buf)
+{
+    const uint8_t* lut = handle->hillshade_lut;
+    if (!lut) {
+        return;
+    }
+    
+    // Deeper zoom levels share the DEM tile of their ancestor
+    int dem_zoom = key->zoom < handle->dem_max_zoom ? key->zoom : handle->dem_max_zoom;
+    int dz = key->zoom - dem_zoom;
+    if (dz > 8) {
+        // Beyond 8 levels a DEM sample covers a whole tile: no relief to shade
+        return;
+    }
+    
+    map_tiles_key_t dem_key;
+    dem_key.source = handle->dem_source;
+    dem_key.zoom = dem_zoom;
+    dem_key.x = key->x >> dz;
+    dem_key.y = key->y >> dz;
+    
+    map_tiles_cache_entry_t* dem = acquire_dem(handle, &dem_key);
+    if (!dem) {
+        ESP_LOGD(TAG, "No elevation for tile %d/%d/%d, left unshaded", key->zoom, key->x, key->y);
+        return;
+    }
+    
+    // Metres per DEM sample at the tile centre, converting Sobel sums (8x the
+    // gradient) to LUT steps
+    double lat, lon;
+    map_tiles_unproject(handle, handle->current_tile_type, ldexp(dem_key.x + 0.5, -dem_zoom),
+                        ldexp(dem_key.y + 0.5, -dem_zoom), &lat, &lon);
+    double sample_m = map_tiles_tile_meters(handle, handle->current_tile_type, dem_zoom, lat) / DEM_SIZE;
+    float k = (float)(handle->hillshade_z_factor * LUT_STEPS_PER_UNIT / (8.0 * sample_m));
+    
+    const int16_t* heights = (const int16_t*)dem->buf;
+    uint16_t* pixels = (uint16_t*)buf;
+    if (dz == 0) {
+        shade_full(pixels, heights, k, lut);
+    } else {
+        int sub = DEM_SIZE >> dz;
+        int sx0 = (key->x & ((1 << dz) - 1)) * sub;
+        int sy0 = (key->y & ((1 << dz) - 1)) * sub;
+        if (!shade_upsampled(pixels, heights, dz, sx0, sy0, k, lut, handle)) {
+            ESP_LOGW(TAG, "Out of memory, tile %d/%d/%d left unshaded", key->zoom, key->x, key->y);
+        }
+    }
+    
+    map_tiles_cache_unref(handle->cache, dem);
+}
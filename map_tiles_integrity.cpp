@@ -0,0 +1,158 @@
+#include "map_tiles_internal.h"
+#include <string.h>
+#include "esp_log.h"
+
+static const char* TAG = "map_tiles_integrity";
+
+#define CRC32C_POLY 0x82F63B78u                                     /**< Castagnoli, reflected */
+
+/**
+ * @brief Slice-by-8 lookup tables, built at compile time so they live in flash
+ */
+struct crc32c_tables_t {
+    uint32_t t[8][256];
+};
+
+static constexpr crc32c_tables_t make_crc32c_tables()
+{
+    crc32c_tables_t tables = {};
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+        }
+        tables.t[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int slice = 1; slice < 8; slice++) {
+            uint32_t prev = tables.t[slice - 1][i];
+            tables.t[slice][i] = (prev >> 8) ^ tables.t[0][prev & 0xFF];
+        }
+    }
+    return tables;
+}
+
+static constexpr crc32c_tables_t CRC32C = make_crc32c_tables();
+
+uint32_t map_tiles_crc32c(uint32_t crc, const void* data, size_t len)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    const uint32_t (*t)[256] = CRC32C.t;
+    crc = ~crc;
+    
+    // Eight bytes per round: one table lookup per byte, no dependency between them
+    while (len >= 8) {
+        uint32_t lo = crc ^ ((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+        uint32_t hi = (uint32_t)p[4] | ((uint32_t)p[5] << 8) | ((uint32_t)p[6] << 16) | ((uint32_t)p[7] << 24);
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+              t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = t[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static bool key_equal(const map_tiles_key_t* a, const map_tiles_key_t* b)
+{
+    return a->source == b->source && a->zoom == b->zoom && a->x == b->x && a->y == b->y;
+}
+
+bool map_tiles_quarantined(map_tiles_handle_t handle, const map_tiles_key_t* key)
+{
+    for (int i = 0; i < handle->quarantine_count; i++) {
+        if (key_equal(&handle->quarantine[i], key)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void map_tiles_quarantine_add(map_tiles_handle_t handle, const map_tiles_key_t* key)
+{
+    if (map_tiles_quarantined(handle, key)) {
+        return;
+    }
+    
+    // When full, the oldest entry makes room
+    handle->quarantine[handle->quarantine_next] = *key;
+    handle->quarantine_next = (handle->quarantine_next + 1) % MAP_TILES_QUARANTINE_SIZE;
+    if (handle->quarantine_count < MAP_TILES_QUARANTINE_SIZE) {
+        handle->quarantine_count++;
+    }
+    ESP_LOGW(TAG, "Quarantined tile zoom %d (%d, %d)", (int)key->zoom, (int)key->x, (int)key->y);
+}
+
+bool map_tiles_check_trailer(map_tiles_handle_t handle, FILE* f, const map_tiles_key_t* key, uint32_t crc)
+{
+    uint8_t trailer[MAP_TILES_TILE_TRAILER_SIZE];
+    if (fread(trailer, 1, sizeof(trailer), f) != sizeof(trailer)) {
+        ESP_LOGW(TAG, "Missing checksum: zoom %d (%d, %d)", (int)key->zoom, (int)key->x, (int)key->y);
+        map_tiles_quarantine_add(handle, key);
+        return false;
+    }
+    
+    uint32_t expected = (uint32_t)trailer[0] | ((uint32_t)trailer[1] << 8) |
+                        ((uint32_t)trailer[2] << 16) | ((uint32_t)trailer[3] << 24);
+    if (crc != expected) {
+        ESP_LOGW(TAG, "Checksum mismatch: zoom %d (%d, %d): 0x%08lx, expected 0x%08lx",
+                 (int)key->zoom, (int)key->x, (int)key->y, (unsigned long)crc, (unsigned long)expected);
+        map_tiles_quarantine_add(handle, key);
+        return false;
+    }
+    return true;
+}
+
+map_tiles_tile_status_t map_tiles_read_pixels(map_tiles_handle_t handle, FILE* f, const map_tiles_key_t* key,
+                                              bool verify, uint8_t* buf)
+{
+    size_t bytes_read = fread(buf, 1, MAP_TILES_TILE_BYTES, f);
+    map_tiles_tile_status_t status = MAP_TILES_STATUS_OK;
+    if (bytes_read != MAP_TILES_TILE_BYTES) {
+        ESP_LOGW(TAG, "Incomplete tile read: %zu bytes", bytes_read);
+        memset(buf + bytes_read, 0, MAP_TILES_TILE_BYTES - bytes_read);
+        status = MAP_TILES_STATUS_TRUNCATED;
+    } else if (verify && !map_tiles_check_trailer(handle, f, key, map_tiles_crc32c(0, buf, MAP_TILES_TILE_BYTES))) {
+        status = MAP_TILES_STATUS_CORRUPT;
+    }
+    fclose(f);
+    return status;
+}
+
+int map_tiles_get_quarantine(map_tiles_handle_t handle, map_tiles_tile_id_t* tiles, int max_tiles)
+{
+    if (!handle || !handle->initialized) {
+        ESP_LOGE(TAG, "Handle not initialized");
+        return 0;
+    }
+    
+    int count = 0;
+    for (int i = 0; i < handle->quarantine_count && (tiles && count < max_tiles); i++) {
+        const map_tiles_key_t* key = &handle->quarantine[i];
+        int tile_type = -1;
+        for (int type = 0; type < handle->tile_type_count; type++) {
+            if (handle->source_ids[type] == key->source) {
+                tile_type = type;
+            }
+        }
+        tiles[count].tile_type = tile_type;
+        tiles[count].zoom = key->zoom;
+        tiles[count].tile_x = key->x;
+        tiles[count].tile_y = key->y;
+        count++;
+    }
+    return tiles ? count : handle->quarantine_count;
+}
+
+void map_tiles_clear_quarantine(map_tiles_handle_t handle)
+{
+    if (!handle || !handle->initialized) {
+        ESP_LOGE(TAG, "Handle not initialized");
+        return;
+    }
+    
+    handle->quarantine_count = 0;
+    handle->quarantine_next = 0;
+}
@@ -0,0 +1,491 @@
+#include "map_tiles_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "esp_log.h"
+
+static const char* TAG = "map_tiles_labels";
+
+#define LABELS_DEFAULT_MAX 32
+#define LABELS_MAX_FILE_BYTES (32 * 1024)                           /**< Larger label tiles are truncated */
+#define LABELS_CELL_SHIFT 6                                         /**< 64 pixel collision cells */
+#define LABELS_MAX_CELLS 1024
+
+/**
+ * @brief One label of a label tile, measured when the tile is read
+ */
+typedef struct {
+    int16_t x;                                                      /**< Centre in tile pixels */
+    int16_t y;
+    int16_t w;                                                      /**< Text size in the layer font */
+    int16_t h;
+    uint8_t priority;
+    const char* text;                                               /**< In the text pool of the tile */
+} label_t;
+
+typedef struct {
+    int32_t zoom;
+    int32_t x;
+    int32_t y;
+    bool loaded;                                                    /**< A read was attempted for zoom/x/y */
+    label_t* labels;
+    int count;
+    char* text;                                                     /**< File contents, lines split in place */
+} label_tile_t;
+
+/**
+ * @brief Label competing for a place on screen
+ */
+typedef struct {
+    int32_t x0;                                                     /**< Box including spacing, screen pixels */
+    int32_t y0;
+    int32_t x1;
+    int32_t y1;
+    uint32_t order;                                                 /**< Tie break, keeps placement stable between updates */
+    const label_t* label;
+} candidate_t;
+
+typedef struct {
+    int placed;                                                     /**< Index into the placed candidates */
+    int next;                                                       /**< Next link of the cell, -1 at the end */
+} cell_link_t;
+
+struct map_tiles_labels_t {
+    map_tiles_handle_t handle;
+    char* path;                                                     /**< "<base_path>/<folder>" */
+    const lv_font_t* font;
+    int spacing;
+    int32_t view_width;
+    int32_t view_height;
+    int tile_count;
+    label_tile_t** tiles;                                           /**< One per grid slot */
+    label_tile_t** scratch;
+    
+    // LVGL objects and the text each one currently shows
+    lv_obj_t** objs;
+    const char** shown;
+    int max_labels;
+    
+    // Placement buffers, grown as needed and kept between updates
+    candidate_t* candidates;
+    int candidate_capacity;
+    int* cells;
+    int cell_capacity;
+    cell_link_t* links;
+    int link_capacity;
+};
+
+static bool grow(map_tiles_labels_handle_t labels, void** buf, int* capacity, int needed, size_t elem)
+{
+    if (needed <= *capacity) {
+        return true;
+    }
+    int capacity_new = *capacity ? *capacity : 64;
+    while (capacity_new < needed) {
+        capacity_new *= 2;
+    }
+    void* grown = map_tiles_mem_realloc(&labels->handle->memory, MAP_TILES_MEM_LABELS, *buf, capacity_new * elem);
+    if (!grown) {
+        return false;
+    }
+    *buf = grown;
+    *capacity = capacity_new;
+    return true;
+}
+
+static void tile_clear(label_tile_t* tile)
+{
+    map_tiles_mem_free(tile->labels);
+    map_tiles_mem_free(tile->text);
+    tile->labels = NULL;
+    tile->text = NULL;
+    tile->count = 0;
+}
+
+map_tiles_labels_handle_t map_tiles_labels_create(map_tiles_handle_t handle, lv_obj_t* parent,
+                                                  const map_tiles_labels_config_t* config)
+{
+    if (!handle || !handle->initialized || !parent || !config || !config->folder) {
+        ESP_LOGE(TAG, "Invalid parameters");
+        return NULL;
+    }
+    
+    if (config->max_labels < 0 || config->spacing < 0 || config->view_width < 0 || config->view_height < 0) {
+        ESP_LOGE(TAG, "Invalid label layer configuration");
+        return NULL;
+    }
+    
+    map_tiles_mem_account_t* memory = &handle->memory;
+    map_tiles_labels_handle_t labels = (map_tiles_labels_handle_t)map_tiles_mem_calloc(memory, MAP_TILES_MEM_LABELS, 1,
+                                                                                       sizeof(struct map_tiles_labels_t), 0);
+    if (!labels) {
+        ESP_LOGE(TAG, "Failed to allocate label layer");
+        return NULL;
+    }
+    labels->handle = handle;
+    labels->font = config->font ? config->font : LV_FONT_DEFAULT;
+    labels->spacing = config->spacing;
+    labels->view_width = config->view_width;
+    labels->view_height = config->view_height;
+    labels->tile_count = handle->tile_count;
+    labels->max_labels = config->max_labels > 0 ? config->max_labels : LABELS_DEFAULT_MAX;
+    
+    size_t path_len = strlen(handle->base_path) + strlen(config->folder) + 2;
+    labels->path = (char*)map_tiles_mem_alloc(memory, MAP_TILES_MEM_LABELS, path_len, 0);
+    labels->tiles = (label_tile_t**)map_tiles_mem_calloc(memory, MAP_TILES_MEM_LABELS, labels->tile_count, sizeof(label_tile_t*), 0);
+    labels->scratch = (label_tile_t**)map_tiles_mem_calloc(memory, MAP_TILES_MEM_LABELS, labels->tile_count, sizeof(label_tile_t*), 0);
+    labels->objs = (lv_obj_t**)map_tiles_mem_calloc(memory, MAP_TILES_MEM_LABELS, labels->max_labels, sizeof(lv_obj_t*), 0);
+    labels->shown = (const char**)map_tiles_mem_calloc(memory, MAP_TILES_MEM_LABELS, labels->max_labels, sizeof(const char*), 0);
+    bool ok = labels->path && labels->tiles && labels->scratch && labels->objs && labels->shown;
+    
+    for (int i = 0; ok && i < labels->tile_count; i++) {
+        labels->tiles[i] = (label_tile_t*)map_tiles_mem_calloc(memory, MAP_TILES_MEM_LABELS, 1, sizeof(label_tile_t), 0);
+        ok = labels->tiles[i] != NULL;
+    }
+    
+    for (int i = 0; ok && i < labels->max_labels; i++) {
+        labels->objs[i] = lv_label_create(parent);
+        ok = labels->objs[i] != NULL;
+        if (ok) {
+            lv_obj_set_style_text_font(labels->objs[i], labels->font, LV_PART_MAIN);
+            lv_obj_add_flag(labels->objs[i], LV_OBJ_FLAG_HIDDEN);
+        }
+    }
+    
+    if (!ok) {
+        ESP_LOGE(TAG, "Failed to allocate label layer");
+        map_tiles_labels_destroy(labels);
+        return NULL;
+    }
+    
+    snprintf(labels->path, path_len, "%s/%s", handle->base_path, config->folder);
+    
+    ESP_LOGI(TAG, "Label layer created: %s, up to %d labels", labels->path, labels->max_labels);
+    return labels;
+}
+
+/**
+ * @brief Read and measure the labels of one label tile
+ * 
+ * A missing file is an empty tile; false means out of memory.
+ */
+static bool labels_read_tile(map_tiles_labels_handle_t labels, label_tile_t* tile)
+{
+    tile_clear(tile);
+    tile->loaded = true;
+    
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%" PRId32 "/%" PRId32 "/%" PRId32 ".txt", labels->path, tile->zoom, tile->x, tile->y);
+    map_tiles_stats_io(labels->handle);
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        ESP_LOGD(TAG, "No labels: %s", path);
+        return true;
+    }
+    
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size > LABELS_MAX_FILE_BYTES) {
+        ESP_LOGW(TAG, "Label tile truncated: %s", path);
+        size = LABELS_MAX_FILE_BYTES;
+    }
+    
+    tile->text = (char*)map_tiles_mem_alloc(&labels->handle->memory, MAP_TILES_MEM_LABELS, size > 0 ? size + 1 : 1, 0);
+    if (!tile->text) {
+        fclose(f);
+        tile->loaded = false;
+        return false;
+    }
+    size_t len = size > 0 ? fread(tile->text, 1, size, f) : 0;
+    fclose(f);
+    tile->text[len] = '\0';
+    
+    int capacity = 0;
+    char* line = tile->text;
+    while (line && *line) {
+        char* end = strchr(line, '\n');
+        if (end) {
+            *end = '\0';
+        }
+        size_t line_len = strlen(line);
+        if (line_len > 0 && line[line_len - 1] == '\r') {
+            line[--line_len] = '\0';
+        }
+        
+        int x, y, priority, text_at = 0;
+        if (line[0] != '#' && sscanf(line, "%d %d %d %n", &x, &y, &priority, &text_at) == 3 && line[text_at] &&
+            x >= 0 && x < MAP_TILES_TILE_SIZE && y >= 0 && y < MAP_TILES_TILE_SIZE && priority >= 0 && priority <= 255) {
+            if (!grow(labels, (void**)&tile->labels, &capacity, tile->count + 1, sizeof(label_t))) {
+                tile_clear(tile);
+                tile->loaded = false;
+                return false;
+            }
+            
+            // Measured once here; placement only needs the cached size
+            label_t* label = &tile->labels[tile->count++];
+            lv_point_t text_size;
+            lv_text_get_size(&text_size, line + text_at, labels->font, 0, 0, LV_COORD_MAX, LV_TEXT_FLAG_NONE);
+            label->x = (int16_t)x;
+            label->y = (int16_t)y;
+            label->w = (int16_t)text_size.x;
+            label->h = (int16_t)text_size.y;
+            label->priority = (uint8_t)priority;
+            label->text = line + text_at;
+        } else if (line[0] && line[0] != '#') {
+            ESP_LOGW(TAG, "Invalid label line in %s: %s", path, line);
+        }
+        line = end ? end + 1 : NULL;
+    }
+    
+    ESP_LOGD(TAG, "Read %d labels from %s", tile->count, path);
+    return true;
+}
+
+static bool label_tile_is(const label_tile_t* tile, const map_tiles_key_t* key)
+{
+    return tile->loaded && tile->zoom == key->zoom && tile->x == key->x && tile->y == key->y;
+}
+
+/**
+ * @brief Bring the label tiles in line with the grid, reading only new ones
+ * 
+ * @return Number of tiles recycled for other grid positions
+ */
+static int labels_sync_tiles(map_tiles_labels_handle_t labels, bool* failed)
+{
+    map_tiles_handle_t handle = labels->handle;
+    label_tile_t** pool = labels->scratch;
+    memcpy(pool, labels->tiles, labels->tile_count * sizeof(label_tile_t*));
+    memset(labels->tiles, 0, labels->tile_count * sizeof(label_tile_t*));
+    
+    map_tiles_key_t keys[MAP_TILES_MAX_TILES];
+    bool in_grid[MAP_TILES_MAX_TILES];
+    for (int i = 0; i < labels->tile_count; i++) {
+        in_grid[i] = map_tiles_make_key(handle, handle->current_tile_type, handle->zoom,
+                                        handle->tile_x + i % handle->grid_cols, handle->tile_y + i / handle->grid_cols, &keys[i]);
+        for (int j = 0; in_grid[i] && j < labels->tile_count; j++) {
+            if (pool[j] && label_tile_is(pool[j], &keys[i])) {
+                labels->tiles[i] = pool[j];
+                pool[j] = NULL;
+                break;
+            }
+        }
+    }
+    
+    int recycled = 0;
+    int next = 0;
+    for (int i = 0; i < labels->tile_count; i++) {
+        if (labels->tiles[i]) {
+            continue;
+        }
+        while (!pool[next]) {
+            next++;
+        }
+        label_tile_t* tile = pool[next++];
+        labels->tiles[i] = tile;
+        recycled++;
+        
+        if (!in_grid[i]) {
+            tile_clear(tile);
+            tile->loaded = false;
+            continue;
+        }
+        tile->zoom = keys[i].zoom;
+        tile->x = keys[i].x;
+        tile->y = keys[i].y;
+        if (!labels_read_tile(labels, tile)) {
+            *failed = true;
+        }
+    }
+    return recycled;
+}
+
+static int compare_candidates(const void* a, const void* b)
+{
+    const candidate_t* ca = (const candidate_t*)a;
+    const candidate_t* cb = (const candidate_t*)b;
+    if (ca->label->priority != cb->label->priority) {
+        return ca->label->priority > cb->label->priority ? -1 : 1;
+    }
+    return ca->order < cb->order ? -1 : (ca->order > cb->order ? 1 : 0);
+}
+
+static bool boxes_overlap(const candidate_t* a, const candidate_t* b)
+{
+    return a->x0 < b->x1 && b->x0 < a->x1 && a->y0 < b->y1 && b->y0 < a->y1;
+}
+
+int map_tiles_labels_update(map_tiles_labels_handle_t labels, const map_tiles_transform_t* transform)
+{
+    if (!labels || !transform || transform->handle != labels->handle) {
+        ESP_LOGE(TAG, "Invalid parameters");
+        return -1;
+    }
+    
+    bool failed = false;
+    int recycled = labels_sync_tiles(labels, &failed);
+    if (recycled > 0) {
+        // Texts of recycled tiles are gone; never compare against their pointers
+        memset(labels->shown, 0, labels->max_labels * sizeof(const char*));
+    }
+    
+    // Collect the labels anchored in the view, with their boxes on screen
+    int count = 0;
+    int32_t min_x = INT32_MAX, min_y = INT32_MAX, max_x = INT32_MIN, max_y = INT32_MIN;
+    int half_gap = (labels->spacing + 1) / 2;
+    for (int i = 0; i < labels->tile_count; i++) {
+        const label_tile_t* tile = labels->tiles[i];
+        if (!tile->count) {
+            continue;
+        }
+        if (!grow(labels, (void**)&labels->candidates, &labels->candidate_capacity, count + tile->count, sizeof(candidate_t))) {
+            return -1;
+        }
+        
+        int shift = MAP_TILES_MAX_ZOOM - tile->zoom;
+        for (int k = 0; k < tile->count; k++) {
+            const label_t* label = &tile->labels[k];
+            map_tiles_world_point_t world;
+            lv_point_t screen;
+            world.x = map_tiles_shl((int64_t)tile->x * MAP_TILES_TILE_SIZE + label->x, shift);
+            world.y = map_tiles_shl((int64_t)tile->y * MAP_TILES_TILE_SIZE + label->y, shift);
+            map_tiles_transform_world_to_screen(transform, &world, 1, &screen);
+            if ((labels->view_width && (screen.x < 0 || screen.x >= labels->view_width)) ||
+                (labels->view_height && (screen.y < 0 || screen.y >= labels->view_height))) {
+                continue;
+            }
+            
+            candidate_t* c = &labels->candidates[count];
+            c->x0 = screen.x - label->w / 2 - half_gap;
+            c->y0 = screen.y - label->h / 2 - half_gap;
+            c->x1 = c->x0 + label->w + 2 * half_gap;
+            c->y1 = c->y0 + label->h + 2 * half_gap;
+            c->order = (uint32_t)count;
+            c->label = label;
+            min_x = c->x0 < min_x ? c->x0 : min_x;
+            min_y = c->y0 < min_y ? c->y0 : min_y;
+            max_x = c->x1 > max_x ? c->x1 : max_x;
+            max_y = c->y1 > max_y ? c->y1 : max_y;
+            count++;
+        }
+    }
+    
+    int placed = 0;
+    if (count > 0) {
+        qsort(labels->candidates, count, sizeof(candidate_t), compare_candidates);
+        
+        // Collision cells over the candidates' extent, coarser for very spread out labels
+        int shift = LABELS_CELL_SHIFT;
+        int cols, rows;
+        for (;;) {
+            cols = (int)(((int64_t)max_x - min_x) >> shift) + 1;
+            rows = (int)(((int64_t)max_y - min_y) >> shift) + 1;
+            if ((int64_t)cols * rows <= LABELS_MAX_CELLS) {
+                break;
+            }
+            shift++;
+        }
+        if (!grow(labels, (void**)&labels->cells, &labels->cell_capacity, cols * rows, sizeof(int))) {
+            return -1;
+        }
+        for (int i = 0; i < cols * rows; i++) {
+            labels->cells[i] = -1;
+        }
+        
+        int link_count = 0;
+        for (int i = 0; i < count && placed < labels->max_labels; i++) {
+            candidate_t* c = &labels->candidates[i];
+            int cx0 = (int)(((int64_t)c->x0 - min_x) >> shift);
+            int cy0 = (int)(((int64_t)c->y0 - min_y) >> shift);
+            int cx1 = (int)(((int64_t)c->x1 - 1 - min_x) >> shift);
+            int cy1 = (int)(((int64_t)c->y1 - 1 - min_y) >> shift);
+            
+            bool hit = false;
+            for (int cy = cy0; !hit && cy <= cy1; cy++) {
+                for (int cx = cx0; !hit && cx <= cx1; cx++) {
+                    for (int l = labels->cells[cy * cols + cx]; l >= 0; l = labels->links[l].next) {
+                        if (boxes_overlap(c, &labels->candidates[labels->links[l].placed])) {
+                            hit = true;
+                            break;
+                        }
+                    }
+                }
+            }
+            if (hit) {
+                continue;
+            }
+            
+            // Placed candidates are compacted to the front of the array
+            int cells = (cx1 - cx0 + 1) * (cy1 - cy0 + 1);
+            if (!grow(labels, (void**)&labels->links, &labels->link_capacity, link_count + cells, sizeof(cell_link_t))) {
+                return -1;
+            }
+            labels->candidates[placed] = *c;
+            for (int cy = cy0; cy <= cy1; cy++) {
+                for (int cx = cx0; cx <= cx1; cx++) {
+                    labels->links[link_count].placed = placed;
+                    labels->links[link_count].next = labels->cells[cy * cols + cx];
+                    labels->cells[cy * cols + cx] = link_count++;
+                }
+            }
+            placed++;
+        }
+    }
+    
+    // Show the placed labels, touching LVGL only where something changed
+    for (int i = 0; i < labels->max_labels; i++) {
+        lv_obj_t* obj = labels->objs[i];
+        if (i >= placed) {
+            if (labels->shown[i]) {
+                lv_label_set_text_static(obj, "");
+                labels->shown[i] = NULL;
+            }
+            lv_obj_add_flag(obj, LV_OBJ_FLAG_HIDDEN);
+            continue;
+        }
+        
+        const candidate_t* c = &labels->candidates[i];
+        if (labels->shown[i] != c->label->text) {
+            lv_label_set_text_static(obj, c->label->text);
+            labels->shown[i] = c->label->text;
+        }
+        lv_obj_set_pos(obj, c->x0 + half_gap, c->y0 + half_gap);
+        lv_obj_remove_flag(obj, LV_OBJ_FLAG_HIDDEN);
+    }
+    
+    ESP_LOGD(TAG, "Labels: %d tiles recycled, %d of %d placed", recycled, placed, count);
+    return failed ? -1 : placed;
+}
+
+void map_tiles_labels_destroy(map_tiles_labels_handle_t labels)
+{
+    if (!labels) {
+        return;
+    }
+    
+    if (labels->objs) {
+        for (int i = 0; i < labels->max_labels; i++) {
+            if (labels->objs[i]) {
+                lv_obj_delete(labels->objs[i]);
+            }
+        }
+        map_tiles_mem_free(labels->objs);
+    }
+    if (labels->tiles) {
+        for (int i = 0; i < labels->tile_count; i++) {
+            if (labels->tiles[i]) {
+                tile_clear(labels->tiles[i]);
+                map_tiles_mem_free(labels->tiles[i]);
+            }
+        }
+        map_tiles_mem_free(labels->tiles);
+    }
+    map_tiles_mem_free(labels->scratch);
+    map_tiles_mem_free(labels->shown);
+    map_tiles_mem_free(labels->candidates);
+    map_tiles_mem_free(labels->cells);
+    map_tiles_mem_free(labels->links);
+    map_tiles_mem_free(labels->path);
+    map_tiles_mem_free(labels);
+}
@@ -0,0 +1,168 @@
+#include "map_tiles_internal.h"
+#include <stddef.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+static const char* TAG = "map_tiles_memory";
+
+/**
+ * @brief Prefix of every accounted block, padded so the data stays maximally aligned
+ */
+typedef union {
+    struct {
+        map_tiles_mem_account_t* account;                           /**< NULL for untracked blocks */
+        size_t size;                                                /**< Bytes requested by the caller */
+        uint32_t caps;
+        uint8_t category;
+    } info;
+    max_align_t align;
+} mem_header_t;
+
+static void raise_peak(size_t* peak, size_t value)
+{
+    size_t seen = __atomic_load_n(peak, __ATOMIC_RELAXED);
+    while (value > seen && !__atomic_compare_exchange_n(peak, &seen, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+static void charge(map_tiles_mem_account_t* account, int category, size_t size)
+{
+    if (!account) {
+        return;
+    }
+    raise_peak(&account->peak[category], __atomic_add_fetch(&account->current[category], size, __ATOMIC_RELAXED));
+    raise_peak(&account->total_peak, __atomic_add_fetch(&account->total, size, __ATOMIC_RELAXED));
+}
+
+static void discharge(map_tiles_mem_account_t* account, int category, size_t size)
+{
+    if (!account) {
+        return;
+    }
+    __atomic_sub_fetch(&account->current[category], size, __ATOMIC_RELAXED);
+    __atomic_sub_fetch(&account->total, size, __ATOMIC_RELAXED);
+}
+
+static mem_header_t* header_of(void* ptr)
+{
+    return (mem_header_t*)ptr - 1;
+}
+
+void* map_tiles_mem_alloc(map_tiles_mem_account_t* account, map_tiles_mem_category_t category, size_t size, uint32_t caps)
+{
+    if (size > SIZE_MAX - sizeof(mem_header_t)) {
+        return NULL;
+    }
+    caps = caps ? caps : MALLOC_CAP_DEFAULT;
+    mem_header_t* header = (mem_header_t*)heap_caps_malloc(sizeof(mem_header_t) + size, caps);
+    if (!header) {
+        return NULL;
+    }
+    header->info.account = account;
+    header->info.size = size;
+    header->info.caps = caps;
+    header->info.category = (uint8_t)category;
+    charge(account, category, size);
+    return header + 1;
+}
+
+void* map_tiles_mem_calloc(map_tiles_mem_account_t* account, map_tiles_mem_category_t category, size_t n, size_t size,
+                           uint32_t caps)
+{
+    if (size && n > SIZE_MAX / size) {
+        return NULL;
+    }
+    void* ptr = map_tiles_mem_alloc(account, category, n * size, caps);
+    if (ptr) {
+        memset(ptr, 0, n * size);
+    }
+    return ptr;
+}
+
+void* map_tiles_mem_realloc(map_tiles_mem_account_t* account, map_tiles_mem_category_t category, void* ptr, size_t size)
+{
+    if (!ptr) {
+        return map_tiles_mem_alloc(account, category, size, 0);
+    }
+    if (size > SIZE_MAX - sizeof(mem_header_t)) {
+        return NULL;
+    }
+    
+    // The block keeps its account, category and heap
+    mem_header_t* header = header_of(ptr);
+    map_tiles_mem_account_t* owner = header->info.account;
+    int owner_category = header->info.category;
+    size_t old_size = header->info.size;
+    mem_header_t* grown = (mem_header_t*)heap_caps_realloc(header, sizeof(mem_header_t) + size, header->info.caps);
+    if (!grown) {
+        return NULL;
+    }
+    grown->info.size = size;
+    discharge(owner, owner_category, old_size);
+    charge(owner, owner_category, size);
+    return grown + 1;
+}
+
+char* map_tiles_mem_strdup(map_tiles_mem_account_t* account, map_tiles_mem_category_t category, const char* s)
+{
+    size_t len = strlen(s) + 1;
+    char* copy = (char*)map_tiles_mem_alloc(account, category, len, 0);
+    if (copy) {
+        memcpy(copy, s, len);
+    }
+    return copy;
+}
+
+void map_tiles_mem_free(void* ptr)
+{
+    if (!ptr) {
+        return;
+    }
+    
+    // The account may live in the block being freed (the handle, the cache)
+    mem_header_t* header = header_of(ptr);
+    discharge(header->info.account, header->info.category, header->info.size);
+    heap_caps_free(header);
+}
+
+void map_tiles_mem_assign(void* ptr, map_tiles_mem_account_t* account)
+{
+    mem_header_t* header = header_of(ptr);
+    discharge(header->info.account, header->info.category, header->info.size);
+    header->info.account = account;
+    charge(account, header->info.category, header->info.size);
+}
+
+void map_tiles_mem_reset_peaks(map_tiles_mem_account_t* account)
+{
+    for (int i = 0; i < MAP_TILES_MEM_CATEGORY_COUNT; i++) {
+        __atomic_store_n(&account->peak[i], __atomic_load_n(&account->current[i], __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&account->total_peak, __atomic_load_n(&account->total, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+}
+
+bool map_tiles_get_memory(map_tiles_handle_t handle, map_tiles_memory_t* memory)
+{
+    if (!handle || !handle->initialized || !memory) {
+        ESP_LOGE(TAG, "Handle not initialized");
+        return false;
+    }
+    
+    // The accounts peak at different times, so summed peaks are an upper bound
+    const map_tiles_mem_account_t* accounts[3] = { &handle->memory, &handle->cache->memory };
+    int account_count = 2;
+    if (handle->fetch) {
+        accounts[account_count++] = map_tiles_fetch_memory(handle->fetch);
+    }
+    memset(memory, 0, sizeof(*memory));
+    for (int a = 0; a < account_count; a++) {
+        for (int i = 0; i < MAP_TILES_MEM_CATEGORY_COUNT; i++) {
+            memory->categories[i].current += __atomic_load_n(&accounts[a]->current[i], __ATOMIC_RELAXED);
+            memory->categories[i].peak += __atomic_load_n(&accounts[a]->peak[i], __ATOMIC_RELAXED);
+        }
+        memory->total.current += __atomic_load_n(&accounts[a]->total, __ATOMIC_RELAXED);
+        memory->total.peak += __atomic_load_n(&accounts[a]->total_peak, __ATOMIC_RELAXED);
+    }
+    return true;
+}
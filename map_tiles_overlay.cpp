@@ -0,0 +1,341 @@
+#include "map_tiles_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+static const char* TAG = "map_tiles_overlay";
+
+#define OVERLAY_PALETTE_BYTES (256 * 4)
+#define OVERLAY_PIXELS (MAP_TILES_TILE_SIZE * MAP_TILES_TILE_SIZE)
+
+/**
+ * @brief One overlay tile of one frame
+ */
+typedef struct {
+    int32_t zoom;
+    int32_t x;
+    int32_t y;
+    bool loaded;                                                    /**< A read was attempted for zoom/x/y at the frame's time */
+    bool present;                                                   /**< The read succeeded and buf holds the tile */
+    uint8_t* buf;                                                   /**< Allocated on the first successful read, then reused */
+    lv_image_dsc_t img;
+} overlay_tile_t;
+
+typedef struct {
+    int64_t time;
+    overlay_tile_t** tiles;                                         /**< One per grid slot */
+} overlay_frame_t;
+
+struct map_tiles_overlay_t {
+    map_tiles_handle_t handle;
+    char* path;                                                     /**< "<base_path>/<folder>" */
+    map_tiles_overlay_format_t format;
+    int tile_count;
+    overlay_frame_t* frames;                                        /**< frame_capacity frames, the first frame_count in use */
+    int frame_capacity;
+    int frame_count;
+    overlay_tile_t** scratch;                                       /**< tile_count pointers for reshuffling a frame */
+};
+
+static size_t overlay_bytes(map_tiles_overlay_format_t format)
+{
+    return format == MAP_TILES_OVERLAY_I8 ? OVERLAY_PALETTE_BYTES + OVERLAY_PIXELS : OVERLAY_PIXELS;
+}
+
+static lv_color_format_t overlay_color_format(map_tiles_overlay_format_t format)
+{
+    return format == MAP_TILES_OVERLAY_I8 ? LV_COLOR_FORMAT_I8 : LV_COLOR_FORMAT_A8;
+}
+
+map_tiles_overlay_handle_t map_tiles_overlay_create(map_tiles_handle_t handle, const map_tiles_overlay_config_t* config)
+{
+    if (!handle || !handle->initialized || !config || !config->folder) {
+        ESP_LOGE(TAG, "Invalid parameters");
+        return NULL;
+    }
+    
+    if (config->frame_count < 1 || config->frame_count > MAP_TILES_MAX_OVERLAY_FRAMES) {
+        ESP_LOGE(TAG, "Invalid frame count: %d (valid range: 1-%d)", config->frame_count, MAP_TILES_MAX_OVERLAY_FRAMES);
+        return NULL;
+    }
+    
+    if (config->format != MAP_TILES_OVERLAY_I8 && config->format != MAP_TILES_OVERLAY_A8) {
+        ESP_LOGE(TAG, "Invalid overlay format: %d", config->format);
+        return NULL;
+    }
+    
+    map_tiles_mem_account_t* memory = &handle->memory;
+    map_tiles_overlay_handle_t overlay = (map_tiles_overlay_handle_t)map_tiles_mem_calloc(memory, MAP_TILES_MEM_OVERLAYS, 1,
+                                                                                         sizeof(struct map_tiles_overlay_t), 0);
+    if (!overlay) {
+        ESP_LOGE(TAG, "Failed to allocate overlay");
+        return NULL;
+    }
+    overlay->handle = handle;
+    overlay->format = config->format;
+    overlay->tile_count = handle->tile_count;
+    overlay->frame_capacity = config->frame_count;
+    
+    size_t path_len = strlen(handle->base_path) + strlen(config->folder) + 2;
+    overlay->path = (char*)map_tiles_mem_alloc(memory, MAP_TILES_MEM_OVERLAYS, path_len, 0);
+    overlay->frames = (overlay_frame_t*)map_tiles_mem_calloc(memory, MAP_TILES_MEM_OVERLAYS, overlay->frame_capacity,
+                                                             sizeof(overlay_frame_t), 0);
+    overlay->scratch = (overlay_tile_t**)map_tiles_mem_calloc(memory, MAP_TILES_MEM_OVERLAYS, overlay->tile_count,
+                                                              sizeof(overlay_tile_t*), 0);
+    bool ok = overlay->path && overlay->frames && overlay->scratch;
+    
+    for (int f = 0; ok && f < overlay->frame_capacity; f++) {
+        overlay->frames[f].tiles = (overlay_tile_t**)map_tiles_mem_calloc(memory, MAP_TILES_MEM_OVERLAYS, overlay->tile_count,
+                                                                          sizeof(overlay_tile_t*), 0);
+        ok = overlay->frames[f].tiles != NULL;
+        for (int i = 0; ok && i < overlay->tile_count; i++) {
+            overlay->frames[f].tiles[i] = (overlay_tile_t*)map_tiles_mem_calloc(memory, MAP_TILES_MEM_OVERLAYS, 1,
+                                                                                sizeof(overlay_tile_t), 0);
+            ok = overlay->frames[f].tiles[i] != NULL;
+        }
+    }
+    
+    if (!ok) {
+        ESP_LOGE(TAG, "Failed to allocate overlay frames");
+        map_tiles_overlay_destroy(overlay);
+        return NULL;
+    }
+    
+    snprintf(overlay->path, path_len, "%s/%s", handle->base_path, config->folder);
+    
+    ESP_LOGI(TAG, "Overlay created: %s, %s, %d frames of %d tiles", overlay->path,
+             config->format == MAP_TILES_OVERLAY_I8 ? "I8" : "A8", overlay->frame_capacity, overlay->tile_count);
+    return overlay;
+}
+
+bool map_tiles_overlay_set_times(map_tiles_overlay_handle_t overlay, const int64_t* times, int count)
+{
+    if (!overlay || (!times && count > 0)) {
+        ESP_LOGE(TAG, "Invalid parameters");
+        return false;
+    }
+    
+    if (count < 0 || count > overlay->frame_capacity) {
+        ESP_LOGE(TAG, "Invalid time step count: %d (overlay keeps %d)", count, overlay->frame_capacity);
+        return false;
+    }
+    
+    // Keep the frames of time steps still in the window, recycle the others
+    overlay_frame_t old[MAP_TILES_MAX_OVERLAY_FRAMES];
+    bool used[MAP_TILES_MAX_OVERLAY_FRAMES] = {};
+    bool matched[MAP_TILES_MAX_OVERLAY_FRAMES] = {};
+    memcpy(old, overlay->frames, overlay->frame_capacity * sizeof(overlay_frame_t));
+    
+    for (int k = 0; k < count; k++) {
+        for (int f = 0; f < overlay->frame_count; f++) {
+            if (!used[f] && old[f].time == times[k]) {
+                overlay->frames[k] = old[f];
+                used[f] = true;
+                matched[k] = true;
+                break;
+            }
+        }
+    }
+    
+    int spare = 0;
+    for (int k = 0; k < overlay->frame_capacity; k++) {
+        if (matched[k]) {
+            continue;
+        }
+        while (used[spare]) {
+            spare++;
+        }
+        overlay->frames[k] = old[spare];
+        used[spare] = true;
+        
+        overlay->frames[k].time = k < count ? times[k] : 0;
+        for (int i = 0; i < overlay->tile_count; i++) {
+            overlay->frames[k].tiles[i]->loaded = false;
+            overlay->frames[k].tiles[i]->present = false;
+        }
+    }
+    
+    overlay->frame_count = count;
+    return true;
+}
+
+/**
+ * @brief Read one overlay tile file into a tile of a frame
+ */
+static bool overlay_read_tile(map_tiles_overlay_handle_t overlay, overlay_tile_t* tile, int64_t time)
+{
+    tile->loaded = true;
+    tile->present = false;
+    
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%" PRId32 "/%" PRId32 "/%" PRId32 "/%" PRId64 ".bin",
+             overlay->path, tile->zoom, tile->x, tile->y, time);
+    map_tiles_stats_io(overlay->handle);
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        // Overlay sets commonly omit empty tiles
+        ESP_LOGD(TAG, "Overlay tile not found: %s", path);
+        return true;
+    }
+    
+    size_t bytes = overlay_bytes(overlay->format);
+    if (!tile->buf) {
+        uint32_t caps = overlay->handle->use_spiram ? (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT) : MALLOC_CAP_DMA;
+        tile->buf = (uint8_t*)map_tiles_mem_alloc(&overlay->handle->memory, MAP_TILES_MEM_OVERLAYS, bytes, caps);
+        if (!tile->buf) {
+            ESP_LOGE(TAG, "Failed to allocate overlay tile");
+            fclose(f);
+            tile->loaded = false;
+            return false;
+        }
+    }
+    
+    uint8_t header[MAP_TILES_TILE_HEADER_SIZE];
+    bool ok = fread(header, 1, sizeof(header), f) == sizeof(header);
+    int w = header[4] | (header[5] << 8);
+    int h = header[6] | (header[7] << 8);
+    if (ok && (header[1] != overlay_color_format(overlay->format) || w != MAP_TILES_TILE_SIZE || h != MAP_TILES_TILE_SIZE)) {
+        ESP_LOGW(TAG, "Unexpected overlay tile format: %s (cf 0x%02x, %dx%d)", path, header[1], w, h);
+        fclose(f);
+        return true;
+    }
+    
+    size_t bytes_read = ok ? fread(tile->buf, 1, bytes, f) : 0;
+    fclose(f);
+    if (bytes_read != bytes) {
+        ESP_LOGW(TAG, "Incomplete overlay tile read: %s, %zu bytes", path, bytes_read);
+        return true;
+    }
+    
+    tile->img.header.w = MAP_TILES_TILE_SIZE;
+    tile->img.header.h = MAP_TILES_TILE_SIZE;
+    tile->img.header.cf = overlay_color_format(overlay->format);
+    tile->img.header.stride = MAP_TILES_TILE_SIZE;
+    tile->img.data = tile->buf;
+    tile->img.data_size = bytes;
+    tile->img.reserved = NULL;
+    tile->img.reserved_2 = NULL;
+    tile->present = true;
+    return true;
+}
+
+static bool overlay_tile_is(const overlay_tile_t* tile, const map_tiles_key_t* key)
+{
+    return tile->loaded && tile->zoom == key->zoom && tile->x == key->x && tile->y == key->y;
+}
+
+int map_tiles_overlay_update(map_tiles_overlay_handle_t overlay)
+{
+    if (!overlay) {
+        ESP_LOGE(TAG, "Invalid parameters");
+        return -1;
+    }
+    
+    map_tiles_handle_t handle = overlay->handle;
+    int reads = 0;
+    bool failed = false;
+    for (int f = 0; f < overlay->frame_count; f++) {
+        overlay_frame_t* frame = &overlay->frames[f];
+        overlay_tile_t** pool = overlay->scratch;
+        memcpy(pool, frame->tiles, overlay->tile_count * sizeof(overlay_tile_t*));
+        memset(frame->tiles, 0, overlay->tile_count * sizeof(overlay_tile_t*));
+        
+        // Tiles still on the grid move to their new slot
+        for (int i = 0; i < overlay->tile_count; i++) {
+            map_tiles_key_t key;
+            int col = i % handle->grid_cols;
+            int row = i / handle->grid_cols;
+            if (!map_tiles_make_key(handle, handle->current_tile_type, handle->zoom,
+                                    handle->tile_x + col, handle->tile_y + row, &key)) {
+                continue;
+            }
+            for (int j = 0; j < overlay->tile_count; j++) {
+                if (pool[j] && overlay_tile_is(pool[j], &key)) {
+                    frame->tiles[i] = pool[j];
+                    pool[j] = NULL;
+                    break;
+                }
+            }
+        }
+        
+        // The rest are recycled for the tiles that came into view
+        int next = 0;
+        for (int i = 0; i < overlay->tile_count; i++) {
+            if (frame->tiles[i]) {
+                continue;
+            }
+            while (!pool[next]) {
+                next++;
+            }
+            overlay_tile_t* tile = pool[next++];
+            frame->tiles[i] = tile;
+            
+            map_tiles_key_t key;
+            int col = i % handle->grid_cols;
+            int row = i / handle->grid_cols;
+            if (!map_tiles_make_key(handle, handle->current_tile_type, handle->zoom,
+                                    handle->tile_x + col, handle->tile_y + row, &key)) {
+                // Beyond the poles or the grid: nothing to show
+                tile->loaded = false;
+                tile->present = false;
+                continue;
+            }
+            
+            tile->zoom = key.zoom;
+            tile->x = key.x;
+            tile->y = key.y;
+            if (overlay_read_tile(overlay, tile, frame->time)) {
+                reads++;
+            } else {
+                // Retried on the next update
+                failed = true;
+            }
+        }
+    }
+    
+    ESP_LOGD(TAG, "Overlay update: %d tiles read", reads);
+    return failed ? -1 : reads;
+}
+
+lv_image_dsc_t* map_tiles_overlay_get_image(map_tiles_overlay_handle_t overlay, int frame, int index)
+{
+    if (!overlay || frame < 0 || frame >= overlay->frame_count || index < 0 || index >= overlay->tile_count) {
+        return NULL;
+    }
+    
+    overlay_tile_t* tile = overlay->frames[frame].tiles[index];
+    return tile->present ? &tile->img : NULL;
+}
+
+int map_tiles_overlay_get_frame_count(map_tiles_overlay_handle_t overlay)
+{
+    return overlay ? overlay->frame_count : 0;
+}
+
+void map_tiles_overlay_destroy(map_tiles_overlay_handle_t overlay)
+{
+    if (!overlay) {
+        return;
+    }
+    
+    if (overlay->frames) {
+        for (int f = 0; f < overlay->frame_capacity; f++) {
+            if (!overlay->frames[f].tiles) {
+                continue;
+            }
+            for (int i = 0; i < overlay->tile_count; i++) {
+                if (overlay->frames[f].tiles[i]) {
+                    map_tiles_mem_free(overlay->frames[f].tiles[i]->buf);
+                    map_tiles_mem_free(overlay->frames[f].tiles[i]);
+                }
+            }
+            map_tiles_mem_free(overlay->frames[f].tiles);
+        }
+        map_tiles_mem_free(overlay->frames);
+    }
+    map_tiles_mem_free(overlay->scratch);
+    map_tiles_mem_free(overlay->path);
+    map_tiles_mem_free(overlay);
+}
@@ -0,0 +1,77 @@
+#include "map_tiles_internal.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char* TAG = "map_tiles_power";
+
+static const char* mode_name(map_tiles_power_mode_t mode)
+{
+    switch (mode) {
+        case MAP_TILES_POWER_PERFORMANCE: return "performance";
+        case MAP_TILES_POWER_BALANCED: return "balanced";
+        case MAP_TILES_POWER_LOW: return "low power";
+    }
+    return "?";
+}
+
+bool map_tiles_set_power_mode(map_tiles_handle_t handle, map_tiles_power_mode_t mode)
+{
+    if (!handle || !handle->initialized) {
+        ESP_LOGE(TAG, "Handle not initialized");
+        return false;
+    }
+    
+    if (mode != MAP_TILES_POWER_PERFORMANCE && mode != MAP_TILES_POWER_BALANCED && mode != MAP_TILES_POWER_LOW) {
+        ESP_LOGE(TAG, "Invalid power mode: %d", (int)mode);
+        return false;
+    }
+    
+    // Low power keeps the smaller half of the extra tiles
+    int trimmed = mode == MAP_TILES_POWER_LOW ? handle->cache_tiles - handle->cache_tiles / 2 : 0;
+    int delta = handle->cache_trimmed - trimmed;
+    if (delta != 0) {
+        if (!map_tiles_cache_resize(handle->cache, delta)) {
+            return false;
+        }
+        handle->cache_reserved += delta;
+        handle->cache_trimmed = trimmed;
+    }
+    
+    handle->power_mode = mode;
+    ESP_LOGI(TAG, "Power mode: %s, cache: +%d tiles", mode_name(mode), handle->cache_tiles - trimmed);
+    return true;
+}
+
+map_tiles_power_mode_t map_tiles_get_power_mode(map_tiles_handle_t handle)
+{
+    if (!handle || !handle->initialized) {
+        return MAP_TILES_POWER_PERFORMANCE;
+    }
+    
+    return handle->power_mode;
+}
+
+bool map_tiles_io_awake(map_tiles_handle_t handle)
+{
+    return handle->io_last_us != 0 && esp_timer_get_time() - handle->io_last_us < MAP_TILES_IO_BURST_GAP_US;
+}
+
+bool map_tiles_power_allows_preload(map_tiles_handle_t handle)
+{
+    switch (handle->power_mode) {
+        case MAP_TILES_POWER_PERFORMANCE:
+            return !handle->io_burst_us || map_tiles_io_awake(handle);
+        case MAP_TILES_POWER_BALANCED:
+            // Ride along with reads that woke the card anyway
+            return map_tiles_io_awake(handle);
+        case MAP_TILES_POWER_LOW:
+            return false;
+    }
+    return false;
+}
+
+bool map_tiles_power_skips_preload(map_tiles_handle_t handle, const map_tiles_key_t* key)
+{
+    // Low power only pauses, so the whole route is still there afterwards
+    return handle->power_mode == MAP_TILES_POWER_BALANCED && key->zoom != handle->zoom;
+}
@@ -0,0 +1,295 @@
+#include "map_tiles_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char* TAG = "map_tiles_preload";
+
+#define ROUTE_SAMPLE_STEP_TILES 0.25
+
+/**
+ * @brief Growable preload plan in route order
+ * 
+ * An open-addressing set of plan indices (+1, so 0 marks an empty slot)
+ * deduplicates the keys.
+ */
+typedef struct {
+    map_tiles_key_t* keys;
+    int count;
+    int capacity;
+    int* slots;
+    int slot_capacity;
+    map_tiles_mem_account_t* memory;                                /**< Account of the handle planning */
+} plan_t;
+
+static uint32_t key_hash(const map_tiles_key_t* key, int slot_capacity)
+{
+    uint64_t v = ((uint64_t)(uint32_t)key->x << 32) | (uint32_t)key->y;
+    v ^= (uint64_t)key->zoom * 0xC2B2AE3D27D4EB4FULL;
+    return (uint32_t)((v * 0x9E3779B97F4A7C15ULL) >> 32) & (slot_capacity - 1);
+}
+
+static bool key_equal(const map_tiles_key_t* a, const map_tiles_key_t* b)
+{
+    return a->zoom == b->zoom && a->x == b->x && a->y == b->y;
+}
+
+/**
+ * @brief Look up a key, returning its slot (free if the key is new)
+ */
+static uint32_t plan_find_slot(const plan_t* plan, const map_tiles_key_t* key)
+{
+    uint32_t h = key_hash(key, plan->slot_capacity);
+    while (plan->slots[h] && !key_equal(&plan->keys[plan->slots[h] - 1], key)) {
+        h = (h + 1) & (plan->slot_capacity - 1);
+    }
+    return h;
+}
+
+static bool plan_grow_slots(plan_t* plan)
+{
+    int new_capacity = plan->slot_capacity ? plan->slot_capacity * 2 : 256;
+    int* slots = (int*)map_tiles_mem_calloc(plan->memory, MAP_TILES_MEM_INDICES, new_capacity, sizeof(int), 0);
+    if (!slots) {
+        return false;
+    }
+    
+    map_tiles_mem_free(plan->slots);
+    plan->slots = slots;
+    plan->slot_capacity = new_capacity;
+    for (int i = 0; i < plan->count; i++) {
+        plan->slots[plan_find_slot(plan, &plan->keys[i])] = i + 1;
+    }
+    return true;
+}
+
+static bool plan_add(plan_t* plan, const map_tiles_key_t* key)
+{
+    if ((plan->count + 1) * 2 > plan->slot_capacity && !plan_grow_slots(plan)) {
+        return false;
+    }
+    
+    uint32_t slot = plan_find_slot(plan, key);
+    if (plan->slots[slot]) {
+        return true;
+    }
+    
+    if (plan->count == plan->capacity) {
+        int new_capacity = plan->capacity ? plan->capacity * 2 : 64;
+        map_tiles_key_t* keys = (map_tiles_key_t*)map_tiles_mem_realloc(plan->memory, MAP_TILES_MEM_INDICES, plan->keys,
+                                                                        new_capacity * sizeof(map_tiles_key_t));
+        if (!keys) {
+            return false;
+        }
+        plan->keys = keys;
+        plan->capacity = new_capacity;
+    }
+    
+    plan->keys[plan->count] = *key;
+    plan->slots[slot] = ++plan->count;
+    return true;
+}
+
+/**
+ * @brief Add every tile whose square lies within radius (in tiles) of point (x, y)
+ */
+static bool plan_add_disk(map_tiles_handle_t handle, plan_t* plan, int zoom, double x, double y, double radius)
+{
+    int min_x = (int)floor(x - radius);
+    int max_x = (int)floor(x + radius);
+    int min_y = (int)floor(y - radius);
+    int max_y = (int)floor(y + radius);
+    
+    for (int ty = min_y; ty <= max_y; ty++) {
+        for (int tx = min_x; tx <= max_x; tx++) {
+            // Distance from the point to the nearest point of the tile square
+            double dx = x < tx ? tx - x : (x > tx + 1 ? x - (tx + 1) : 0.0);
+            double dy = y < ty ? ty - y : (y > ty + 1 ? y - (ty + 1) : 0.0);
+            if (dx * dx + dy * dy > radius * radius) continue;
+            
+            // Tiles outside the grid of the projection are skipped
+            map_tiles_key_t key;
+            if (!map_tiles_make_key(handle, handle->current_tile_type, zoom, tx, ty, &key)) continue;
+            if (!plan_add(plan, &key)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool map_tiles_preload_route(map_tiles_handle_t handle, const map_tiles_gps_point_t* route, int point_count,
+                             const map_tiles_preload_config_t* config)
+{
+    if (!handle || !handle->initialized) {
+        ESP_LOGE(TAG, "Handle not initialized");
+        return false;
+    }
+    
+    if (!route || point_count <= 0 || !config || config->buffer_m < 0) {
+        ESP_LOGE(TAG, "Invalid preload parameters");
+        return false;
+    }
+    
+    int levels_around = config->zoom_levels_around > 0 ? config->zoom_levels_around : 0;
+    plan_t plan;
+    memset(&plan, 0, sizeof(plan));
+    plan.memory = &handle->memory;
+    
+    // Walk the polyline at the current zoom; each sample queues its corridor at the
+    // current zoom first and then at the surrounding levels, so the queue stays in route order
+    double step = ROUTE_SAMPLE_STEP_TILES;
+    bool ok = true;
+    for (int i = 0; ok && i < point_count; i++) {
+        double x0, y0, x1, y1;
+        map_tiles_gps_to_tile_xy(handle, route[i].lat, route[i].lon, &x0, &y0);
+        int samples = 1;
+        if (i + 1 < point_count) {
+            map_tiles_gps_to_tile_xy(handle, route[i + 1].lat, route[i + 1].lon, &x1, &y1);
+            
+            // Take the short way across the antimeridian
+            double n = (double)map_tiles_wrap_columns(handle, handle->current_tile_type, handle->zoom);
+            if (n > 0 && x1 - x0 > n / 2) x1 -= n;
+            if (n > 0 && x0 - x1 > n / 2) x1 += n;
+            double len = sqrt((x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0));
+            samples = (int)ceil(len / step);
+            if (samples < 1) samples = 1;
+        } else {
+            x1 = x0;
+            y1 = y0;
+        }
+        
+        for (int s = 0; ok && s < samples; s++) {
+            double t = (double)s / samples;
+            double lat = route[i].lat + (i + 1 < point_count ? (route[i + 1].lat - route[i].lat) * t : 0.0);
+            double x = x0 + (x1 - x0) * t;
+            double y = y0 + (y1 - y0) * t;
+            
+            for (int d = 0; ok && d <= 2 * levels_around; d++) {
+                // Order: zoom, zoom-1, zoom+1, zoom-2, zoom+2, ...
+                int dz = (d + 1) / 2 * ((d & 1) ? -1 : 1);
+                int zoom = handle->zoom + dz;
+                if (zoom < 0 || zoom > MAP_TILES_MAX_ZOOM) continue;
+                
+                double scale = ldexp(1.0, dz);
+                double tile_m = map_tiles_tile_meters(handle, handle->current_tile_type, zoom, lat);
+                double radius = tile_m > 0 ? config->buffer_m / tile_m : 0.0;
+                ok = plan_add_disk(handle, &plan, zoom, x * scale, y * scale, radius);
+            }
+        }
+    }
+    
+    map_tiles_mem_free(plan.slots);
+    if (!ok) {
+        ESP_LOGE(TAG, "Failed to allocate preload plan");
+        map_tiles_mem_free(plan.keys);
+        return false;
+    }
+    
+    // Replace any previous route
+    map_tiles_mem_free(handle->preload_queue);
+    handle->preload_queue = plan.keys;
+    handle->preload_count = plan.count;
+    handle->preload_next = 0;
+    
+    ESP_LOGI(TAG, "Route preload planned: %d points, %d tiles, buffer %.0f m, zoom %d +/-%d",
+             point_count, plan.count, config->buffer_m, handle->zoom, levels_around);
+    return true;
+}
+
+bool map_tiles_preload_next(map_tiles_handle_t handle, map_tiles_key_t* key)
+{
+    while (handle->preload_next < handle->preload_count) {
+        const map_tiles_key_t* next = &handle->preload_queue[handle->preload_next];
+        
+        if (map_tiles_power_skips_preload(handle, next) || map_tiles_cache_contains(handle->cache, next) ||
+            map_tiles_quarantined(handle, next)) {
+            handle->preload_next++;
+            continue;
+        }
+        if (!map_tiles_power_allows_preload(handle)) {
+            return false;
+        }
+        
+        // Stop rather than evict tiles that were preloaded for the road ahead
+        if (!map_tiles_cache_can_claim(handle->cache, MAP_TILES_CLAIM_PRELOAD)) {
+            ESP_LOGD(TAG, "Cache full of preloaded tiles, pausing at %d/%d",
+                     handle->preload_next, handle->preload_count);
+            return false;
+        }
+        
+        *key = *next;
+        handle->preload_next++;
+        return true;
+    }
+    return false;
+}
+
+int map_tiles_preload_step(map_tiles_handle_t handle, int max_tiles)
+{
+    if (!handle || !handle->initialized) {
+        ESP_LOGE(TAG, "Handle not initialized");
+        return 0;
+    }
+    
+    int loaded = 0;
+    map_tiles_key_t next;
+    while (loaded < max_tiles && map_tiles_preload_next(handle, &next)) {
+        const map_tiles_key_t* key = &next;
+        int64_t start = esp_timer_get_time();
+        FILE* f = map_tiles_open_file(handle, key);
+        if (!f) {
+            // Fetched onto the card for the next time the route is driven
+            map_tiles_fetch_missing(handle, key, false);
+            continue;
+        }
+        bool has_crc;
+        if (!map_tiles_check_header(f, key, &has_crc)) {
+            map_tiles_quarantine_add(handle, key);
+            fclose(f);
+            continue;
+        }
+        
+        bool existing;
+        map_tiles_cache_entry_t* entry = map_tiles_cache_claim(handle->cache, key, MAP_TILES_CLAIM_PRELOAD, &existing);
+        if (!entry) {
+            ESP_LOGE(TAG, "Preload allocation failed");
+            fclose(f);
+            break;
+        }
+        if (existing) {
+            fclose(f);
+            continue;
+        }
+        // Only complete, intact tiles are kept for later
+        map_tiles_tile_status_t status = map_tiles_read_pixels(handle, f, key, has_crc && handle->verify_checksums, entry->buf);
+        map_tiles_stats_load(handle, false, MAP_TILES_TILE_HEADER_SIZE + MAP_TILES_TILE_BYTES, esp_timer_get_time() - start);
+        map_tiles_cache_publish(handle->cache, entry, status == MAP_TILES_STATUS_OK, false);
+        loaded += status == MAP_TILES_STATUS_OK;
+    }
+    
+    return loaded;
+}
+
+int map_tiles_preload_pending(map_tiles_handle_t handle)
+{
+    if (!handle || !handle->initialized) {
+        return 0;
+    }
+    
+    return handle->preload_count - handle->preload_next;
+}
+
+void map_tiles_preload_cancel(map_tiles_handle_t handle)
+{
+    if (!handle || !handle->initialized) {
+        return;
+    }
+    
+    map_tiles_mem_free(handle->preload_queue);
+    handle->preload_queue = NULL;
+    handle->preload_count = 0;
+    handle->preload_next = 0;
+}
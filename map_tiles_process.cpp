@@ -0,0 +1,587 @@
+#include "map_tiles_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char* TAG = "map_tiles_process";
+
+#define READ_CHUNK_BYTES (8 * 1024)                                 /**< Pixel bytes read per step, 1/16 of a tile */
+
+static bool key_equal(const map_tiles_key_t* a, const map_tiles_key_t* b)
+{
+    return a->source == b->source && a->zoom == b->zoom && a->x == b->x && a->y == b->y;
+}
+
+bool map_tiles_process_init(map_tiles_handle_t handle)
+{
+    int count = handle->tile_count;
+    map_tiles_mem_account_t* memory = &handle->memory;
+    handle->requests = (map_tiles_key_t*)map_tiles_mem_calloc(memory, MAP_TILES_MEM_INDICES, count, sizeof(map_tiles_key_t), 0);
+    handle->requested = (bool*)map_tiles_mem_calloc(memory, MAP_TILES_MEM_INDICES, count, sizeof(bool), 0);
+    handle->request_order = (int*)map_tiles_mem_alloc(memory, MAP_TILES_MEM_INDICES, count * sizeof(int), 0);
+    handle->slots = (map_tiles_slot_t*)map_tiles_mem_calloc(memory, MAP_TILES_MEM_INDICES, count, sizeof(map_tiles_slot_t), 0);
+    if (!handle->requests || !handle->requested || !handle->request_order || !handle->slots) {
+        return false;
+    }
+    
+    // Centre first: the tiles around the marker matter most. Distances are
+    // doubled to stay integral for even grid sizes.
+    for (int i = 0; i < count; i++) {
+        int dx = 2 * (i % handle->grid_cols) - (handle->grid_cols - 1);
+        int dy = 2 * (i / handle->grid_cols) - (handle->grid_rows - 1);
+        int d = dx * dx + dy * dy;
+        int j = i;
+        while (j > 0) {
+            int prev = handle->request_order[j - 1];
+            int pdx = 2 * (prev % handle->grid_cols) - (handle->grid_cols - 1);
+            int pdy = 2 * (prev / handle->grid_cols) - (handle->grid_rows - 1);
+            if (pdx * pdx + pdy * pdy <= d) {
+                break;
+            }
+            handle->request_order[j] = prev;
+            j--;
+        }
+        handle->request_order[j] = i;
+    }
+    return true;
+}
+
+/**
+ * @brief Drop the read in progress, returning its cache entry unfilled
+ */
+static void job_abort(map_tiles_handle_t handle)
+{
+    map_tiles_job_t* job = &handle->job;
+    if (job->entry) {
+        map_tiles_cache_publish(handle->cache, job->entry, false, false);
+    }
+    if (job->f) {
+        fclose(job->f);
+    }
+    job->f = NULL;
+    job->entry = NULL;
+    job->state = MAP_TILES_JOB_IDLE;
+}
+
+void map_tiles_process_cleanup(map_tiles_handle_t handle)
+{
+    job_abort(handle);
+    map_tiles_mem_free(handle->requests);
+    map_tiles_mem_free(handle->requested);
+    map_tiles_mem_free(handle->request_order);
+    map_tiles_mem_free(handle->slots);
+    handle->requests = NULL;
+    handle->requested = NULL;
+    handle->request_order = NULL;
+    handle->slots = NULL;
+}
+
+void map_tiles_slot_status(map_tiles_handle_t handle, int index, const map_tiles_key_t* key, map_tiles_tile_status_t status)
+{
+    map_tiles_slot_t* slot = &handle->slots[index];
+    if (!key) {
+        // Outside the world: nothing to retry
+        slot->status = status;
+        slot->attempts = 0;
+        slot->fetching = false;
+        return;
+    }
+    if (!key_equal(&slot->key, key)) {
+        slot->key = *key;
+        slot->attempts = 0;
+        slot->fetched = false;
+    }
+    slot->status = status;
+    slot->fetching = false;
+    
+    if (status != MAP_TILES_STATUS_OK && status != MAP_TILES_STATUS_PENDING) {
+        map_tiles_stats_failure(handle);
+    }
+    
+    if (status == MAP_TILES_STATUS_OK) {
+        slot->attempts = 0;
+    } else if (status == MAP_TILES_STATUS_TRUNCATED || status == MAP_TILES_STATUS_NO_MEMORY) {
+        // Exponential backoff, capped so the shift cannot overflow
+        int shift = slot->attempts < 10 ? slot->attempts : 10;
+        slot->attempts++;
+        slot->retry_at = esp_timer_get_time() + ((int64_t)handle->retry_delay_ms << shift) * 1000;
+    }
+}
+
+bool map_tiles_slot_retry_due(map_tiles_handle_t handle, int index, int64_t now)
+{
+    const map_tiles_slot_t* slot = &handle->slots[index];
+    if (slot->status != MAP_TILES_STATUS_TRUNCATED && slot->status != MAP_TILES_STATUS_NO_MEMORY) {
+        return false;
+    }
+    
+    // Only while the view still shows the tile's zoom and type
+    return slot->attempts <= handle->retry_limit && now >= slot->retry_at &&
+           slot->key.zoom == handle->zoom && slot->key.source == handle->source_ids[handle->current_tile_type];
+}
+
+void map_tiles_process_cancel_slot(map_tiles_handle_t handle, int index)
+{
+    handle->requested[index] = false;
+    if (handle->job.state != MAP_TILES_JOB_IDLE && handle->job.index == index) {
+        job_abort(handle);
+    }
+}
+
+/**
+ * @brief Show a cache entry, already referenced for the slot, in a grid slot
+ */
+static void finish_slot(map_tiles_handle_t handle, int index, const map_tiles_key_t* key,
+                        map_tiles_cache_entry_t* entry, map_tiles_tile_status_t status)
+{
+    if (handle->tile_entries[index]) {
+        map_tiles_cache_unref(handle->cache, handle->tile_entries[index]);
+    }
+    map_tiles_slot_status(handle, index, key, status);
+    map_tiles_set_slot_entry(handle, index, entry);
+}
+
+bool map_tiles_request_tile(map_tiles_handle_t handle, int index, int tile_x, int tile_y)
+{
+    if (!handle || !handle->initialized) {
+        ESP_LOGE(TAG, "Handle not initialized");
+        return false;
+    }
+    
+    if (index < 0 || index >= handle->tile_count) {
+        ESP_LOGE(TAG, "Invalid tile index: %d", index);
+        return false;
+    }
+    
+    map_tiles_key_t key;
+    if (!map_tiles_make_key(handle, handle->current_tile_type, handle->zoom, tile_x, tile_y, &key)) {
+        map_tiles_process_cancel_slot(handle, index);
+        ESP_LOGD(TAG, "Tile %d (%d, %d) is outside the world", index, tile_x, tile_y);
+        map_tiles_slot_status(handle, index, NULL, MAP_TILES_STATUS_MISSING);
+        map_tiles_notify(handle, MAP_TILES_EVENT_TILE_FAILED, index, handle->zoom, tile_x, tile_y);
+        return false;
+    }
+    
+    map_tiles_key_t show_key;
+    map_tiles_shown_key(handle, &key, &show_key);
+    bool waiting = handle->requested[index];
+    
+    // Nothing to do if the slot shows the tile or is reading it
+    map_tiles_cache_entry_t* current = handle->tile_entries[index];
+    if (current && current->valid && key_equal(&current->key, &show_key)) {
+        map_tiles_process_cancel_slot(handle, index);
+        map_tiles_slot_status(handle, index, &key, MAP_TILES_STATUS_OK);
+        return true;
+    }
+    if (handle->job.state != MAP_TILES_JOB_IDLE && handle->job.index == index && key_equal(&handle->job.show_key, &show_key)) {
+        handle->requested[index] = false;
+        return true;
+    }
+    map_tiles_process_cancel_slot(handle, index);
+    
+    // Cached tiles cost no I/O and are shown right away
+    map_tiles_cache_entry_t* entry = map_tiles_cache_get(handle->cache, &show_key);
+    if (entry) {
+        map_tiles_stats_hit(handle);
+        finish_slot(handle, index, &key, entry, MAP_TILES_STATUS_OK);
+        return true;
+    }
+    
+    // A slot re-requested while panning keeps its place in the burst wait
+    if (!waiting) {
+        handle->slots[index].requested_at = esp_timer_get_time();
+    }
+    handle->requests[index] = key;
+    handle->requested[index] = true;
+    map_tiles_slot_status(handle, index, &key, MAP_TILES_STATUS_PENDING);
+    return true;
+}
+
+/**
+ * @brief Start the read of a grid slot tile (index >= 0) or a preload tile
+ * 
+ * Slot tiles that turn out to be cached, or can be shaded from a cached plain
+ * tile, complete here; others leave the job at the OPEN stage.
+ * 
+ * @return true if a grid slot was updated
+ */
+static bool job_start(map_tiles_handle_t handle, int index, const map_tiles_key_t* key)
+{
+    map_tiles_key_t show_key = *key;
+    if (index >= 0) {
+        bool shaded = map_tiles_shown_key(handle, key, &show_key);
+        map_tiles_cache_entry_t* entry = map_tiles_cache_get(handle->cache, &show_key);
+        if (entry) {
+            map_tiles_stats_hit(handle);
+            finish_slot(handle, index, key, entry, MAP_TILES_STATUS_OK);
+            return true;
+        }
+        
+        map_tiles_cache_entry_t* base = shaded ? map_tiles_cache_get(handle->cache, key) : NULL;
+        if (base) {
+            bool existing;
+            entry = map_tiles_cache_claim(handle->cache, &show_key, MAP_TILES_CLAIM_DEMAND, &existing);
+            if (entry && !existing) {
+                memcpy(entry->buf, base->buf, MAP_TILES_TILE_BYTES);
+                map_tiles_hillshade_apply(handle, key, entry->buf);
+                map_tiles_cache_publish(handle->cache, entry, true, true);
+            }
+            map_tiles_cache_unref(handle->cache, base);
+            if (!entry) {
+                ESP_LOGE(TAG, "Tile %d: allocation failed", index);
+                map_tiles_slot_status(handle, index, key, MAP_TILES_STATUS_NO_MEMORY);
+                map_tiles_notify(handle, MAP_TILES_EVENT_TILE_FAILED, index, key->zoom, key->x, key->y);
+                return false;
+            }
+            map_tiles_stats_hit(handle);
+            finish_slot(handle, index, key, entry, MAP_TILES_STATUS_OK);
+            return true;
+        }
+    }
+    
+    if (map_tiles_quarantined(handle, key)) {
+        if (index >= 0) {
+            map_tiles_slot_status(handle, index, key, MAP_TILES_STATUS_CORRUPT);
+            map_tiles_notify(handle, MAP_TILES_EVENT_TILE_FAILED, index, key->zoom, key->x, key->y);
+        }
+        return false;
+    }
+    
+    map_tiles_job_t* job = &handle->job;
+    job->state = MAP_TILES_JOB_OPEN;
+    job->index = index;
+    job->key = *key;
+    job->show_key = show_key;
+    job->f = NULL;
+    job->entry = NULL;
+    job->offset = 0;
+    job->truncated = false;
+    job->verify = false;
+    job->crc = 0;
+    job->busy_us = 0;
+    return false;
+}
+
+/**
+ * @brief Drop the read in progress and report a grid slot tile as failed
+ */
+static void job_fail(map_tiles_handle_t handle, map_tiles_tile_status_t status)
+{
+    map_tiles_job_t* job = &handle->job;
+    int index = job->index;
+    map_tiles_key_t key = job->key;
+    job_abort(handle);
+    if (index >= 0) {
+        map_tiles_slot_status(handle, index, &key, status);
+        map_tiles_notify(handle, MAP_TILES_EVENT_TILE_FAILED, index, key.zoom, key.x, key.y);
+    }
+}
+
+/**
+ * @brief Let a grid slot wait for the fetcher to bring its missing tile onto the card
+ * 
+ * @return false if there is no fetcher, or the tile was fetched already
+ */
+static bool fetch_slot(map_tiles_handle_t handle, int index, const map_tiles_key_t* key)
+{
+    map_tiles_slot_t* slot = &handle->slots[index];
+    if (slot->fetched || !map_tiles_fetch_missing(handle, key, true)) {
+        return false;
+    }
+    slot->fetching = true;
+    return true;
+}
+
+/**
+ * @brief Open the tile file of the job
+ */
+static void job_open(map_tiles_handle_t handle)
+{
+    map_tiles_job_t* job = &handle->job;
+    job->f = map_tiles_open_file(handle, &job->key);
+    if (!job->f) {
+        // Missing route tiles are fetched for the next time the route is driven
+        bool fetching = job->index >= 0 ? fetch_slot(handle, job->index, &job->key) :
+                                          map_tiles_fetch_missing(handle, &job->key, false);
+        if (fetching) {
+            job_abort(handle);
+        } else {
+            job_fail(handle, MAP_TILES_STATUS_MISSING);
+        }
+        return;
+    }
+    job->state = MAP_TILES_JOB_HEADER;
+}
+
+/**
+ * @brief Read the tile header, dropping the job if it is not a map tile
+ */
+static void job_header(map_tiles_handle_t handle)
+{
+    map_tiles_job_t* job = &handle->job;
+    bool has_crc;
+    if (!map_tiles_check_header(job->f, &job->key, &has_crc)) {
+        map_tiles_quarantine_add(handle, &job->key);
+        job_fail(handle, MAP_TILES_STATUS_CORRUPT);
+        return;
+    }
+    job->verify = has_crc && handle->verify_checksums;
+    job->state = MAP_TILES_JOB_READ;
+}
+
+/**
+ * @brief Read the next chunk of the tile in progress
+ * 
+ * @return true if a grid slot was updated
+ */
+static bool job_read(map_tiles_handle_t handle)
+{
+    map_tiles_job_t* job = &handle->job;
+    if (!job->entry) {
+        bool existing;
+        map_tiles_claim_t policy = job->index >= 0 ? MAP_TILES_CLAIM_DEMAND : MAP_TILES_CLAIM_PRELOAD;
+        map_tiles_cache_entry_t* entry = map_tiles_cache_claim_unlisted(handle->cache, &job->show_key, policy, &existing);
+        if (!entry || existing) {
+            // Out of buffers, or another view read the tile meanwhile
+            if (!entry) {
+                ESP_LOGE(TAG, "Tile allocation failed");
+                job_fail(handle, MAP_TILES_STATUS_NO_MEMORY);
+                return false;
+            }
+            int index = job->index;
+            map_tiles_key_t key = job->key;
+            job_abort(handle);
+            if (index >= 0) {
+                map_tiles_stats_hit(handle);
+                finish_slot(handle, index, &key, entry, MAP_TILES_STATUS_OK);
+                return true;
+            }
+            return false;
+        }
+        job->entry = entry;
+    }
+    
+    size_t want = MAP_TILES_TILE_BYTES - job->offset;
+    if (want > READ_CHUNK_BYTES) {
+        want = READ_CHUNK_BYTES;
+    }
+    size_t got = fread(job->entry->buf + job->offset, 1, want, job->f);
+    if (job->verify) {
+        // Checked while streaming: the chunk is still hot in the cache
+        job->crc = map_tiles_crc32c(job->crc, job->entry->buf + job->offset, got);
+    }
+    job->offset += got;
+    if (got == want && job->offset < MAP_TILES_TILE_BYTES) {
+        return false;
+    }
+    
+    if (job->offset < MAP_TILES_TILE_BYTES) {
+        // Same as a synchronous load: show what was read
+        ESP_LOGW(TAG, "Incomplete tile read: %zu bytes", job->offset);
+        memset(job->entry->buf + job->offset, 0, MAP_TILES_TILE_BYTES - job->offset);
+        job->truncated = true;
+    } else if (job->verify && !map_tiles_check_trailer(handle, job->f, &job->key, job->crc)) {
+        job_fail(handle, MAP_TILES_STATUS_CORRUPT);
+        return false;
+    }
+    fclose(job->f);
+    job->f = NULL;
+    job->state = MAP_TILES_JOB_PUBLISH;
+    return false;
+}
+
+/**
+ * @brief Shade the tile read if needed, publish it and show it in its slot
+ * 
+ * @return true if a grid slot was updated
+ */
+static bool job_publish(map_tiles_handle_t handle)
+{
+    map_tiles_job_t* job = &handle->job;
+    map_tiles_cache_entry_t* entry = job->entry;
+    job->entry = NULL;
+    job->state = MAP_TILES_JOB_IDLE;
+    map_tiles_stats_load(handle, job->index >= 0, MAP_TILES_TILE_HEADER_SIZE + job->offset, job->busy_us);
+    if (job->show_key.source != job->key.source) {
+        map_tiles_hillshade_apply(handle, &job->key, entry->buf);
+    }
+    if (job->truncated) {
+        // Shown zero-filled, but left unlisted so a retry reads it again
+        map_tiles_cache_publish(handle->cache, entry, true, job->index >= 0);
+    } else {
+        entry = map_tiles_cache_publish_as(handle->cache, entry, &job->show_key, job->index >= 0);
+    }
+    if (job->index >= 0) {
+        finish_slot(handle, job->index, &job->key, entry,
+                    job->truncated ? MAP_TILES_STATUS_TRUNCATED : MAP_TILES_STATUS_OK);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Request slots again whose tile the fetcher has written to the card
+ */
+static void fetch_arrivals(map_tiles_handle_t handle, int64_t now)
+{
+    for (int i = 0; i < handle->tile_count; i++) {
+        map_tiles_slot_t* slot = &handle->slots[i];
+        if (slot->fetching && !map_tiles_fetch_waiting(handle, &slot->key)) {
+            slot->fetching = false;
+            slot->fetched = true;
+            slot->requested_at = now;
+            handle->requests[i] = slot->key;
+            handle->requested[i] = true;
+        }
+    }
+}
+
+/**
+ * @brief Check whether grid reads may start now, or should wait for a burst
+ */
+static bool burst_due(map_tiles_handle_t handle, int64_t now)
+{
+    if (!handle->io_burst_us || map_tiles_io_awake(handle)) {
+        return true;
+    }
+    
+    // Storage is idle: wake it once the oldest request has waited long enough
+    for (int i = 0; i < handle->tile_count; i++) {
+        if (handle->requested[i] && now - handle->slots[i].requested_at >= handle->io_burst_us) {
+            return true;
+        }
+        if (map_tiles_slot_retry_due(handle, i, now - handle->io_burst_us)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Start the next read: requested slots from the centre out, then due
+ * retries, then the route preload
+ * 
+ * @return false if there is nothing left to do, or requests wait for a burst
+ */
+static bool job_start_next(map_tiles_handle_t handle, bool* updated)
+{
+    int64_t now = esp_timer_get_time();
+    if (handle->fetch) {
+        map_tiles_fetch_poll(handle->fetch);
+        fetch_arrivals(handle, now);
+    }
+    if (!burst_due(handle, now)) {
+        return false;
+    }
+    
+    for (int i = 0; i < handle->tile_count; i++) {
+        int index = handle->request_order[i];
+        if (handle->requested[index]) {
+            handle->requested[index] = false;
+            *updated = job_start(handle, index, &handle->requests[index]);
+            return true;
+        }
+    }
+    
+    for (int i = 0; i < handle->tile_count; i++) {
+        int index = handle->request_order[i];
+        if (map_tiles_slot_retry_due(handle, index, now)) {
+            map_tiles_key_t key = handle->slots[index].key;
+            map_tiles_slot_status(handle, index, &key, MAP_TILES_STATUS_PENDING);
+            *updated = job_start(handle, index, &key);
+            return true;
+        }
+    }
+    
+    map_tiles_key_t key;
+    if (map_tiles_preload_next(handle, &key)) {
+        job_start(handle, -1, &key);
+        return true;
+    }
+    return false;
+}
+
+map_tiles_step_t map_tiles_process_step(map_tiles_handle_t handle)
+{
+    if (!handle || !handle->initialized) {
+        ESP_LOGE(TAG, "Handle not initialized");
+        return MAP_TILES_STEP_IDLE;
+    }
+    
+    bool updated = false;
+    int64_t start = esp_timer_get_time();
+    switch (handle->job.state) {
+        case MAP_TILES_JOB_IDLE:
+            if (!job_start_next(handle, &updated)) {
+                return MAP_TILES_STEP_IDLE;
+            }
+            break;
+        case MAP_TILES_JOB_OPEN:
+            job_open(handle);
+            break;
+        case MAP_TILES_JOB_HEADER:
+            job_header(handle);
+            break;
+        case MAP_TILES_JOB_READ:
+            updated = job_read(handle);
+            break;
+        case MAP_TILES_JOB_PUBLISH:
+            updated = job_publish(handle);
+            break;
+    }
+    
+    // Time between steps is not part of the read
+    handle->job.busy_us += esp_timer_get_time() - start;
+    return updated ? MAP_TILES_STEP_UPDATED : MAP_TILES_STEP_BUSY;
+}
+
+int map_tiles_process(map_tiles_handle_t handle, uint32_t budget_us)
+{
+    if (!handle || !handle->initialized) {
+        ESP_LOGE(TAG, "Handle not initialized");
+        return 0;
+    }
+    
+    // At least one step per call, so a small budget still makes progress
+    int64_t start = esp_timer_get_time();
+    int updated = 0;
+    do {
+        map_tiles_step_t step = map_tiles_process_step(handle);
+        if (step == MAP_TILES_STEP_IDLE) {
+            break;
+        }
+        updated += step == MAP_TILES_STEP_UPDATED;
+    } while (esp_timer_get_time() - start < (int64_t)budget_us);
+    
+    return updated;
+}
+
+bool map_tiles_set_io_burst(map_tiles_handle_t handle, int max_latency_ms)
+{
+    if (!handle || !handle->initialized) {
+        ESP_LOGE(TAG, "Handle not initialized");
+        return false;
+    }
+    
+    if (max_latency_ms < 0) {
+        ESP_LOGE(TAG, "Invalid burst latency: %d ms", max_latency_ms);
+        return false;
+    }
+    
+    handle->io_burst_us = (int64_t)max_latency_ms * 1000;
+    return true;
+}
+
+int map_tiles_requests_pending(map_tiles_handle_t handle)
+{
+    if (!handle || !handle->initialized) {
+        return 0;
+    }
+    
+    int pending = handle->job.state != MAP_TILES_JOB_IDLE && handle->job.index >= 0 ? 1 : 0;
+    for (int i = 0; i < handle->tile_count; i++) {
+        pending += handle->requested[i] || handle->slots[i].fetching;
+    }
+    return pending;
+}
@@ -0,0 +1,250 @@
+#include "map_tiles_internal.h"
+#include <math.h>
+#include <stdint.h>
+#include "esp_log.h"
+
+static const char* TAG = "map_tiles_projection";
+
+#define EARTH_CIRCUMFERENCE_M 40075016.686
+
+// WGS84 ellipsoid and UTM scale factor
+#define WGS84_A 6378137.0
+#define WGS84_F (1.0 / 298.257223563)
+#define UTM_K0 0.9996
+#define UTM_FALSE_EASTING 500000.0
+#define UTM_FALSE_NORTHING_SOUTH 10000000.0
+
+/**
+ * @brief Web Mercator forward projection to normalized coordinates in [0, 1)
+ */
+static void mercator_forward(double lat, double lon, double* u, double* v)
+{
+    // Clamp to the Mercator limit so positions near the poles stay on the map
+    if (lat > MAP_TILES_MAX_LATITUDE) lat = MAP_TILES_MAX_LATITUDE;
+    if (lat < -MAP_TILES_MAX_LATITUDE) lat = -MAP_TILES_MAX_LATITUDE;
+    
+    double lat_rad = lat * M_PI / 180.0;
+    *u = (lon + 180.0) / 360.0;
+    *v = (1.0 - log(tan(lat_rad) + 1.0 / cos(lat_rad)) / M_PI) / 2.0;
+    
+    // Wrap longitudes beyond +/-180
+    *u -= floor(*u);
+    if (*u >= 1.0) *u = 0.0;
+    if (*v < 0.0) *v = 0.0;
+    if (*v >= 1.0) *v = nextafter(1.0, 0.0);
+}
+
+static void mercator_inverse(double u, double v, double* lat, double* lon)
+{
+    u -= floor(u);
+    *lon = u * 360.0 - 180.0;
+    double lat_rad = atan(sinh(M_PI * (1 - 2 * v)));
+    *lat = lat_rad * 180.0 / M_PI;
+}
+
+bool map_tiles_projection_valid(const map_tiles_projection_t* projection)
+{
+    return projection->forward && projection->inverse && projection->resolution > 0 &&
+           projection->matrix_width >= 0 && projection->matrix_height >= 0 &&
+           (!projection->wrap_x || projection->matrix_width > 0);
+}
+
+bool map_tiles_project(map_tiles_handle_t handle, int tile_type, double lat, double lon, double* u, double* v)
+{
+    const map_tiles_projection_t* p = &handle->projections[tile_type];
+    if (!p->forward) {
+        // Web Mercator fast path: one tile at zoom 0
+        mercator_forward(lat, lon, u, v);
+        return true;
+    }
+    
+    double x, y;
+    if (!p->forward(p->ctx, lat, lon, &x, &y)) {
+        return false;
+    }
+    
+    double tile_units = p->resolution * MAP_TILES_TILE_SIZE;
+    *u = (x - p->origin_x) / tile_units;
+    *v = (p->origin_y - y) / tile_units;
+    if (p->wrap_x) {
+        *u -= floor(*u / p->matrix_width) * p->matrix_width;
+    }
+    return true;
+}
+
+void map_tiles_unproject(map_tiles_handle_t handle, int tile_type, double u, double v, double* lat, double* lon)
+{
+    const map_tiles_projection_t* p = &handle->projections[tile_type];
+    if (!p->forward) {
+        mercator_inverse(u, v, lat, lon);
+        return;
+    }
+    
+    if (p->wrap_x) {
+        u -= floor(u / p->matrix_width) * p->matrix_width;
+    }
+    
+    double tile_units = p->resolution * MAP_TILES_TILE_SIZE;
+    if (!p->inverse(p->ctx, p->origin_x + u * tile_units, p->origin_y - v * tile_units, lat, lon)) {
+        ESP_LOGW(TAG, "Inverse projection failed for tile coordinates %.3f, %.3f", u, v);
+        *lat = 0.0;
+        *lon = 0.0;
+    }
+}
+
+int64_t map_tiles_wrap_columns(map_tiles_handle_t handle, int tile_type, int zoom)
+{
+    const map_tiles_projection_t* p = &handle->projections[tile_type];
+    if (!p->forward) {
+        return map_tiles_world_tiles(zoom);
+    }
+    return p->wrap_x ? (int64_t)p->matrix_width << zoom : 0;
+}
+
+int64_t map_tiles_world_wrap_width(map_tiles_handle_t handle)
+{
+    return map_tiles_wrap_columns(handle, handle->current_tile_type, 0) << MAP_TILES_WORLD_SHIFT;
+}
+
+bool map_tiles_tile_in_grid(map_tiles_handle_t handle, int tile_type, int zoom, int64_t tile_x, int64_t tile_y)
+{
+    const map_tiles_projection_t* p = &handle->projections[tile_type];
+    if (!p->forward) {
+        // Columns wrap, rows beyond the poles do not exist
+        return tile_y >= 0 && tile_y < map_tiles_world_tiles(zoom);
+    }
+    
+    if (tile_y < 0 || (p->matrix_height > 0 && tile_y >= ((int64_t)p->matrix_height << zoom))) {
+        return false;
+    }
+    if (p->wrap_x) {
+        return true;
+    }
+    return tile_x >= 0 && (p->matrix_width == 0 || tile_x < ((int64_t)p->matrix_width << zoom));
+}
+
+double map_tiles_tile_meters(map_tiles_handle_t handle, int tile_type, int zoom, double lat)
+{
+    const map_tiles_projection_t* p = &handle->projections[tile_type];
+    if (!p->forward) {
+        return EARTH_CIRCUMFERENCE_M * cos(lat * M_PI / 180.0) / ldexp(1.0, zoom);
+    }
+    
+    // Custom grids are assumed to use metric projected units
+    return ldexp(p->resolution * MAP_TILES_TILE_SIZE, -zoom);
+}
+
+/**
+ * @brief Transverse Mercator on the WGS84 ellipsoid (Snyder, USGS PP 1395)
+ * 
+ * The zone and hemisphere are packed into ctx so the projection needs no storage.
+ */
+static void utm_unpack(void* ctx, int* zone, bool* north)
+{
+    intptr_t packed = (intptr_t)ctx;
+    *zone = (int)(packed >> 1);
+    *north = (packed & 1) != 0;
+}
+
+static double utm_central_meridian(int zone)
+{
+    return ((zone - 1) * 6 - 180 + 3) * M_PI / 180.0;
+}
+
+static bool utm_forward(void* ctx, double lat, double lon, double* x, double* y)
+{
+    int zone;
+    bool north;
+    utm_unpack(ctx, &zone, &north);
+    
+    const double e2 = WGS84_F * (2 - WGS84_F);
+    const double e4 = e2 * e2;
+    const double e6 = e4 * e2;
+    const double ep2 = e2 / (1 - e2);
+    
+    double phi = lat * M_PI / 180.0;
+    double dlon = lon * M_PI / 180.0 - utm_central_meridian(zone);
+    dlon = remainder(dlon, 2 * M_PI);
+    
+    double sin_phi = sin(phi);
+    double cos_phi = cos(phi);
+    double n = WGS84_A / sqrt(1 - e2 * sin_phi * sin_phi);
+    double t = tan(phi) * tan(phi);
+    double c = ep2 * cos_phi * cos_phi;
+    double a = cos_phi * dlon;
+    double m = WGS84_A * ((1 - e2 / 4 - 3 * e4 / 64 - 5 * e6 / 256) * phi -
+                          (3 * e2 / 8 + 3 * e4 / 32 + 45 * e6 / 1024) * sin(2 * phi) +
+                          (15 * e4 / 256 + 45 * e6 / 1024) * sin(4 * phi) -
+                          (35 * e6 / 3072) * sin(6 * phi));
+    
+    double a2 = a * a;
+    *x = UTM_FALSE_EASTING + UTM_K0 * n *
+         (a + (1 - t + c) * a2 * a / 6 + (5 - 18 * t + t * t + 72 * c - 58 * ep2) * a2 * a2 * a / 120);
+    *y = UTM_K0 * (m + n * tan(phi) *
+         (a2 / 2 + (5 - t + 9 * c + 4 * c * c) * a2 * a2 / 24 +
+          (61 - 58 * t + t * t + 600 * c - 330 * ep2) * a2 * a2 * a2 / 720));
+    if (!north) {
+        *y += UTM_FALSE_NORTHING_SOUTH;
+    }
+    return true;
+}
+
+static bool utm_inverse(void* ctx, double x, double y, double* lat, double* lon)
+{
+    int zone;
+    bool north;
+    utm_unpack(ctx, &zone, &north);
+    
+    const double e2 = WGS84_F * (2 - WGS84_F);
+    const double e4 = e2 * e2;
+    const double e6 = e4 * e2;
+    const double ep2 = e2 / (1 - e2);
+    const double e1 = (1 - sqrt(1 - e2)) / (1 + sqrt(1 - e2));
+    
+    x -= UTM_FALSE_EASTING;
+    if (!north) {
+        y -= UTM_FALSE_NORTHING_SOUTH;
+    }
+    
+    double mu = y / UTM_K0 / (WGS84_A * (1 - e2 / 4 - 3 * e4 / 64 - 5 * e6 / 256));
+    double phi1 = mu + (3 * e1 / 2 - 27 * e1 * e1 * e1 / 32) * sin(2 * mu) +
+                  (21 * e1 * e1 / 16 - 55 * e1 * e1 * e1 * e1 / 32) * sin(4 * mu) +
+                  (151 * e1 * e1 * e1 / 96) * sin(6 * mu) +
+                  (1097 * e1 * e1 * e1 * e1 / 512) * sin(8 * mu);
+    
+    double sin_phi1 = sin(phi1);
+    double cos_phi1 = cos(phi1);
+    if (fabs(cos_phi1) < 1e-12) {
+        return false;
+    }
+    double w = 1 - e2 * sin_phi1 * sin_phi1;
+    double n1 = WGS84_A / sqrt(w);
+    double t1 = tan(phi1) * tan(phi1);
+    double c1 = ep2 * cos_phi1 * cos_phi1;
+    double r1 = WGS84_A * (1 - e2) / (w * sqrt(w));
+    double d = x / (n1 * UTM_K0);
+    double d2 = d * d;
+    
+    double phi = phi1 - (n1 * tan(phi1) / r1) *
+                 (d2 / 2 - (5 + 3 * t1 + 10 * c1 - 4 * c1 * c1 - 9 * ep2) * d2 * d2 / 24 +
+                  (61 + 90 * t1 + 298 * c1 + 45 * t1 * t1 - 252 * ep2 - 3 * c1 * c1) * d2 * d2 * d2 / 720);
+    double dlon = (d - (1 + 2 * t1 + c1) * d2 * d / 6 +
+                   (5 - 2 * c1 + 28 * t1 - 3 * c1 * c1 + 8 * ep2 + 24 * t1 * t1) * d2 * d2 * d / 120) / cos_phi1;
+    
+    *lat = phi * 180.0 / M_PI;
+    *lon = (utm_central_meridian(zone) + dlon) * 180.0 / M_PI;
+    return true;
+}
+
+bool map_tiles_projection_utm(int zone, bool north, map_tiles_projection_t* projection)
+{
+    if (!projection || zone < 1 || zone > 60) {
+        ESP_LOGE(TAG, "Invalid UTM zone: %d", zone);
+        return false;
+    }
+    
+    projection->forward = utm_forward;
+    projection->inverse = utm_inverse;
+    projection->ctx = (void*)(((intptr_t)zone << 1) | (north ? 1 : 0));
+    return true;
+}
@@ -0,0 +1,484 @@
+#include "map_tiles_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "esp_log.h"
+
+static const char* TAG = "map_tiles_render";
+
+#define TILE_STRIDE_PX MAP_TILES_TILE_SIZE
+
+// RGB565 spread over 32 bits as 00000GGGGGG00000RRRRR000000BBBBB, leaving
+// four guard bits above every channel so up to 16 pixels can be summed at once
+#define RGB565_SPREAD_MASK 0x07E0F81Fu
+
+static inline uint32_t rgb565_spread(uint16_t p)
+{
+    return ((uint32_t)p | ((uint32_t)p << 16)) & RGB565_SPREAD_MASK;
+}
+
+static inline uint16_t rgb565_pack(uint32_t v)
+{
+    v &= RGB565_SPREAD_MASK;
+    return (uint16_t)(v | (v >> 16));
+}
+
+/**
+ * @brief Box-filter `count` output pixels from a block of `div` source rows
+ * 
+ * Packed kernel for div <= 4: all three channels of a pixel are summed with a
+ * single 32-bit add.
+ */
+static void box_downscale_packed(const uint16_t* src, int src_stride, int div, int shift,
+                                 uint16_t* dst, int count)
+{
+    const uint32_t round = ((1u << (shift - 1)) << 21) | ((1u << (shift - 1)) << 11) | (1u << (shift - 1));
+    
+    for (int i = 0; i < count; i++) {
+        const uint16_t* block = src + i * div;
+        uint32_t sum = round;
+        for (int r = 0; r < div; r++) {
+            const uint16_t* row = block + r * src_stride;
+            for (int c = 0; c < div; c++) {
+                sum += rgb565_spread(row[c]);
+            }
+        }
+        dst[i] = rgb565_pack(sum >> shift);
+    }
+}
+
+/**
+ * @brief Per-channel box filter for blocks too large for the packed kernel
+ */
+static void box_downscale_generic(const uint16_t* src, int src_stride, int div, int shift,
+                                  uint16_t* dst, int count)
+{
+    const uint32_t round = 1u << (shift - 1);
+    
+    for (int i = 0; i < count; i++) {
+        const uint16_t* block = src + i * div;
+        uint32_t r_sum = round, g_sum = round, b_sum = round;
+        for (int r = 0; r < div; r++) {
+            const uint16_t* row = block + r * src_stride;
+            for (int c = 0; c < div; c++) {
+                uint16_t p = row[c];
+                r_sum += p >> 11;
+                g_sum += (p >> 5) & 0x3F;
+                b_sum += p & 0x1F;
+            }
+        }
+        dst[i] = (uint16_t)(((r_sum >> shift) << 11) | ((g_sum >> shift) << 5) | (b_sum >> shift));
+    }
+}
+
+static void box_downscale(const uint16_t* src, int src_stride, int div, int shift, uint16_t* dst, int count)
+{
+    if (div == 1) {
+        memcpy(dst, src, count * sizeof(uint16_t));
+    } else if (div <= 4) {
+        box_downscale_packed(src, src_stride, div, shift, dst, count);
+    } else {
+        box_downscale_generic(src, src_stride, div, shift, dst, count);
+    }
+}
+
+static int64_t floor_div(int64_t a, int64_t b)
+{
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+/**
+ * @brief Blend two RGB565 pixels, weight w/32 on b
+ * 
+ * Both pixels are spread so the three channels are interpolated with two
+ * 32-bit multiplies; the guard bits hold the 5 extra bits of the products.
+ */
+static inline uint16_t rgb565_lerp(uint16_t a, uint16_t b, uint32_t w)
+{
+    uint32_t sa = rgb565_spread(a);
+    uint32_t sb = rgb565_spread(b);
+    return rgb565_pack((sa * (32 - w) + sb * w) >> 5);
+}
+
+static void fill_rect(uint16_t* dst, int dst_stride, int w, int h, uint16_t color)
+{
+    for (int y = 0; y < h; y++) {
+        uint16_t* row = dst + y * dst_stride;
+        for (int x = 0; x < w; x++) {
+            row[x] = color;
+        }
+    }
+}
+
+/**
+ * @brief Get a cached tile as the grid shows it: shaded when hillshading, else plain
+ */
+static map_tiles_cache_entry_t* acquire_shown(map_tiles_handle_t handle, const map_tiles_key_t* key)
+{
+    map_tiles_key_t show_key;
+    if (map_tiles_shown_key(handle, key, &show_key)) {
+        map_tiles_cache_entry_t* entry = map_tiles_cache_get(handle->cache, &show_key);
+        if (entry) {
+            return entry;
+        }
+    }
+    
+    // Not shaded yet, e.g. preloaded: the plain tile beats a black gap
+    return map_tiles_cache_get(handle->cache, key);
+}
+
+bool map_tiles_render_overview(map_tiles_handle_t handle, double lat, double lon, int scale_div,
+                               uint8_t* dst, int dst_w, int dst_h, int dst_stride)
+{
+    if (!handle || !handle->initialized) {
+        ESP_LOGE(TAG, "Handle not initialized");
+        return false;
+    }
+    
+    if (!dst || dst_w <= 0 || dst_h <= 0 || dst_stride < dst_w * MAP_TILES_BYTES_PER_PIXEL ||
+        dst_stride % MAP_TILES_BYTES_PER_PIXEL != 0) {
+        ESP_LOGE(TAG, "Invalid output buffer");
+        return false;
+    }
+    
+    // Power of two up to 16, so every output pixel lies inside a single tile
+    if (scale_div < 1 || scale_div > 16 || (scale_div & (scale_div - 1)) != 0) {
+        ESP_LOGE(TAG, "Invalid scale divisor: %d", scale_div);
+        return false;
+    }
+    
+    int shift = 0;
+    while ((1 << shift) < scale_div * scale_div) shift++;
+    
+    // Top-left source pixel of the overview, aligned to the filter block
+    double x, y;
+    map_tiles_gps_to_tile_xy(handle, lat, lon, &x, &y);
+    int64_t origin_x = (int64_t)floor(x * MAP_TILES_TILE_SIZE) - (int64_t)dst_w * scale_div / 2;
+    int64_t origin_y = (int64_t)floor(y * MAP_TILES_TILE_SIZE) - (int64_t)dst_h * scale_div / 2;
+    origin_x -= ((origin_x % scale_div) + scale_div) % scale_div;
+    origin_y -= ((origin_y % scale_div) + scale_div) % scale_div;
+    
+    // Stripe of filter rows for tiles that have to be streamed from storage
+    uint16_t* stripe = NULL;
+    
+    uint16_t* out = (uint16_t*)dst;
+    int out_stride = dst_stride / MAP_TILES_BYTES_PER_PIXEL;
+    int per_tile = MAP_TILES_TILE_SIZE / scale_div;
+    
+    int64_t first_tx = origin_x >= 0 ? origin_x / MAP_TILES_TILE_SIZE : -((-origin_x + MAP_TILES_TILE_SIZE - 1) / MAP_TILES_TILE_SIZE);
+    int64_t first_ty = origin_y >= 0 ? origin_y / MAP_TILES_TILE_SIZE : -((-origin_y + MAP_TILES_TILE_SIZE - 1) / MAP_TILES_TILE_SIZE);
+    int rendered = 0;
+    
+    for (int64_t ty = first_ty; (ty * MAP_TILES_TILE_SIZE - origin_y) / scale_div < dst_h; ty++) {
+        // Output rows covered by this tile row
+        int oy0 = (int)((ty * MAP_TILES_TILE_SIZE - origin_y) / scale_div);
+        int oy1 = oy0 + per_tile;
+        int src_row0 = oy0 < 0 ? -oy0 : 0;
+        if (oy0 < 0) oy0 = 0;
+        if (oy1 > dst_h) oy1 = dst_h;
+        
+        for (int64_t tx = first_tx; (tx * MAP_TILES_TILE_SIZE - origin_x) / scale_div < dst_w; tx++) {
+            int ox0 = (int)((tx * MAP_TILES_TILE_SIZE - origin_x) / scale_div);
+            int ox1 = ox0 + per_tile;
+            int src_col0 = ox0 < 0 ? -ox0 : 0;
+            if (ox0 < 0) ox0 = 0;
+            if (ox1 > dst_w) ox1 = dst_w;
+            
+            uint16_t* out_block = out + oy0 * out_stride + ox0;
+            int w = ox1 - ox0;
+            int h = oy1 - oy0;
+            
+            map_tiles_key_t key;
+            bool in_world = map_tiles_make_key(handle, handle->current_tile_type, handle->zoom, (int)tx, (int)ty, &key);
+            map_tiles_cache_entry_t* entry = in_world ? acquire_shown(handle, &key) : NULL;
+            if (entry) {
+                const uint16_t* pixels = (const uint16_t*)entry->buf;
+                for (int r = 0; r < h; r++) {
+                    const uint16_t* src = pixels + (src_row0 + r) * scale_div * TILE_STRIDE_PX + src_col0 * scale_div;
+                    box_downscale(src, TILE_STRIDE_PX, scale_div, shift, out_block + r * out_stride, w);
+                }
+                map_tiles_cache_unref(handle->cache, entry);
+                rendered++;
+                continue;
+            }
+            
+            // Not cached: stream the needed rows one filter block at a time
+            FILE* f = in_world ? map_tiles_open_tile(handle, &key) : NULL;
+            if (f && !stripe) {
+                stripe = (uint16_t*)map_tiles_mem_alloc(&handle->memory, MAP_TILES_MEM_SCRATCH,
+                                                        scale_div * TILE_STRIDE_PX * sizeof(uint16_t), 0);
+            }
+            if (!f || !stripe ||
+                fseek(f, MAP_TILES_TILE_HEADER_SIZE + (long)src_row0 * scale_div * TILE_STRIDE_PX * sizeof(uint16_t), SEEK_SET) != 0) {
+                if (f) fclose(f);
+                fill_rect(out_block, out_stride, w, h, 0);
+                continue;
+            }
+            
+            for (int r = 0; r < h; r++) {
+                size_t want = scale_div * TILE_STRIDE_PX * sizeof(uint16_t);
+                size_t got = fread(stripe, 1, want, f);
+                if (got < want) {
+                    memset((uint8_t*)stripe + got, 0, want - got);
+                }
+                box_downscale(stripe + src_col0 * scale_div, TILE_STRIDE_PX, scale_div, shift, out_block + r * out_stride, w);
+            }
+            fclose(f);
+            rendered++;
+        }
+    }
+    
+    map_tiles_mem_free(stripe);
+    ESP_LOGD(TAG, "Overview 1/%d: %dx%d from %d tiles", scale_div, dst_w, dst_h, rendered);
+    return true;
+}
+
+
+bool map_tiles_render_viewport(map_tiles_handle_t handle, int src_x, int src_y,
+                               uint8_t* dst, int dst_w, int dst_h, int dst_stride)
+{
+    if (!handle || !handle->initialized) {
+        ESP_LOGE(TAG, "Handle not initialized");
+        return false;
+    }
+    
+    if (!dst || dst_w <= 0 || dst_h <= 0 || dst_stride < dst_w * MAP_TILES_BYTES_PER_PIXEL ||
+        dst_stride % MAP_TILES_BYTES_PER_PIXEL != 0) {
+        ESP_LOGE(TAG, "Invalid output buffer");
+        return false;
+    }
+    
+    // Map pixel at the top-left corner of the output
+    int64_t origin_x = (int64_t)handle->tile_x * MAP_TILES_TILE_SIZE + src_x;
+    int64_t origin_y = (int64_t)handle->tile_y * MAP_TILES_TILE_SIZE + src_y;
+    
+    uint16_t* out = (uint16_t*)dst;
+    int out_stride = dst_stride / MAP_TILES_BYTES_PER_PIXEL;
+    int64_t first_tx = floor_div(origin_x, MAP_TILES_TILE_SIZE);
+    int64_t first_ty = floor_div(origin_y, MAP_TILES_TILE_SIZE);
+    
+    // One band of output rows per tile row; inside a band every tile contributes
+    // a run of whole-row copies, split only at the tile seams
+    int oy0 = 0;
+    for (int64_t ty = first_ty; oy0 < dst_h; ty++) {
+        int sy = (int)(origin_y + oy0 - ty * MAP_TILES_TILE_SIZE);
+        int h = MAP_TILES_TILE_SIZE - sy;
+        if (h > dst_h - oy0) h = dst_h - oy0;
+        
+        int ox0 = 0;
+        for (int64_t tx = first_tx; ox0 < dst_w; tx++) {
+            int sx = (int)(origin_x + ox0 - tx * MAP_TILES_TILE_SIZE);
+            int w = MAP_TILES_TILE_SIZE - sx;
+            if (w > dst_w - ox0) w = dst_w - ox0;
+            
+            uint16_t* out_block = out + oy0 * out_stride + ox0;
+            map_tiles_key_t key;
+            map_tiles_cache_entry_t* entry = NULL;
+            if (map_tiles_make_key(handle, handle->current_tile_type, handle->zoom, (int)tx, (int)ty, &key)) {
+                entry = acquire_shown(handle, &key);
+            }
+            if (entry) {
+                const uint16_t* src = (const uint16_t*)entry->buf + sy * TILE_STRIDE_PX + sx;
+                for (int r = 0; r < h; r++) {
+                    memcpy(out_block + r * out_stride, src + r * TILE_STRIDE_PX, w * sizeof(uint16_t));
+                }
+                map_tiles_cache_unref(handle->cache, entry);
+            } else {
+                fill_rect(out_block, out_stride, w, h, 0);
+            }
+            ox0 += w;
+        }
+        oy0 += h;
+    }
+    
+    return true;
+}
+
+#define SCALE_MIN_Q16 (MAP_TILES_SCALE_ONE / 4)
+#define SCALE_MAX_Q16 (MAP_TILES_SCALE_ONE * 4)
+
+/**
+ * @brief Tiles under a scaled viewport, acquired from the cache for one frame
+ */
+typedef struct {
+    map_tiles_cache_entry_t** entries;                              /**< rows x cols, NULL where no tile is loaded */
+    int64_t first_tx;
+    int64_t first_ty;
+    int cols;
+    int rows;
+} tile_window_t;
+
+static bool tile_window_acquire(map_tiles_handle_t handle, tile_window_t* window,
+                                int64_t min_px, int64_t min_py, int64_t max_px, int64_t max_py)
+{
+    window->first_tx = floor_div(min_px, MAP_TILES_TILE_SIZE);
+    window->first_ty = floor_div(min_py, MAP_TILES_TILE_SIZE);
+    window->cols = (int)(floor_div(max_px, MAP_TILES_TILE_SIZE) - window->first_tx + 1);
+    window->rows = (int)(floor_div(max_py, MAP_TILES_TILE_SIZE) - window->first_ty + 1);
+    window->entries = (map_tiles_cache_entry_t**)map_tiles_mem_calloc(&handle->memory, MAP_TILES_MEM_SCRATCH, window->cols * window->rows,
+                                                                       sizeof(map_tiles_cache_entry_t*), 0);
+    if (!window->entries) {
+        return false;
+    }
+    
+    for (int r = 0; r < window->rows; r++) {
+        for (int c = 0; c < window->cols; c++) {
+            map_tiles_key_t key;
+            if (map_tiles_make_key(handle, handle->current_tile_type, handle->zoom,
+                                   (int)(window->first_tx + c), (int)(window->first_ty + r), &key)) {
+                window->entries[r * window->cols + c] = acquire_shown(handle, &key);
+            }
+        }
+    }
+    return true;
+}
+
+static void tile_window_release(map_tiles_handle_t handle, tile_window_t* window)
+{
+    for (int i = 0; i < window->cols * window->rows; i++) {
+        if (window->entries[i]) {
+            map_tiles_cache_unref(handle->cache, window->entries[i]);
+        }
+    }
+    map_tiles_mem_free(window->entries);
+}
+
+/**
+ * @brief Row pointers of every tile column at map row py, NULL where no tile is loaded
+ */
+static void tile_window_rows(const tile_window_t* window, int64_t py, const uint16_t** rows)
+{
+    int r = (int)(floor_div(py, MAP_TILES_TILE_SIZE) - window->first_ty);
+    int y = (int)(py - floor_div(py, MAP_TILES_TILE_SIZE) * MAP_TILES_TILE_SIZE);
+    
+    for (int c = 0; c < window->cols; c++) {
+        map_tiles_cache_entry_t* entry = (r >= 0 && r < window->rows) ? window->entries[r * window->cols + c] : NULL;
+        rows[c] = entry ? (const uint16_t*)entry->buf + y * TILE_STRIDE_PX : NULL;
+    }
+}
+
+static inline uint16_t row_pixel(const uint16_t* const* rows, int col, int x)
+{
+    return rows[col] ? rows[col][x] : 0;
+}
+
+static void scale_row_nearest(const uint16_t* const* rows, int64_t u, int64_t step, int64_t first_px,
+                              uint16_t* out, int count)
+{
+    for (int i = 0; i < count; i++, u += step) {
+        int64_t px = (u >> 16) - first_px;
+        out[i] = row_pixel(rows, (int)(px >> 8), (int)(px & 0xFF));
+    }
+}
+
+static void scale_row_bilinear(const uint16_t* const* rows0, const uint16_t* const* rows1, uint32_t wy,
+                               int64_t u, int64_t step, int64_t first_px, uint16_t* out, int count)
+{
+    for (int i = 0; i < count; i++, u += step) {
+        int64_t px = (u >> 16) - first_px;
+        uint32_t wx = (uint32_t)(u >> 11) & 0x1F;
+        int col = (int)(px >> 8);
+        int x = (int)(px & 0xFF);
+        
+        uint16_t p00, p01, p10, p11;
+        if (x < MAP_TILES_TILE_SIZE - 1 && rows0[col] && rows1[col]) {
+            p00 = rows0[col][x];
+            p01 = rows0[col][x + 1];
+            p10 = rows1[col][x];
+            p11 = rows1[col][x + 1];
+        } else {
+            // Footprint crosses a tile seam or touches a missing tile
+            int col1 = x < MAP_TILES_TILE_SIZE - 1 ? col : col + 1;
+            int x1 = (x + 1) & 0xFF;
+            p00 = row_pixel(rows0, col, x);
+            p01 = row_pixel(rows0, col1, x1);
+            p10 = row_pixel(rows1, col, x);
+            p11 = row_pixel(rows1, col1, x1);
+        }
+        
+        out[i] = rgb565_lerp(rgb565_lerp(p00, p01, wx), rgb565_lerp(p10, p11, wx), wy);
+    }
+}
+
+bool map_tiles_render_viewport_scaled(map_tiles_handle_t handle, int src_x, int src_y,
+                                      uint32_t scale_q16, map_tiles_filter_t filter,
+                                      uint8_t* dst, int dst_w, int dst_h, int dst_stride)
+{
+    if (!handle || !handle->initialized) {
+        ESP_LOGE(TAG, "Handle not initialized");
+        return false;
+    }
+    
+    if (!dst || dst_w <= 0 || dst_h <= 0 || dst_stride < dst_w * MAP_TILES_BYTES_PER_PIXEL ||
+        dst_stride % MAP_TILES_BYTES_PER_PIXEL != 0) {
+        ESP_LOGE(TAG, "Invalid output buffer");
+        return false;
+    }
+    
+    if (scale_q16 < SCALE_MIN_Q16 || scale_q16 > SCALE_MAX_Q16) {
+        ESP_LOGE(TAG, "Invalid scale: 0x%08x", (unsigned)scale_q16);
+        return false;
+    }
+    
+    if (scale_q16 == MAP_TILES_SCALE_ONE && filter == MAP_TILES_FILTER_NEAREST) {
+        return map_tiles_render_viewport(handle, src_x, src_y, dst, dst_w, dst_h, dst_stride);
+    }
+    
+    // Map pixels per output pixel in 16.16 fixed point. Output pixel centers are
+    // mapped back to the map; bilinear sampling is offset by half a map pixel
+    int64_t step = ((int64_t)MAP_TILES_SCALE_ONE << 16) / scale_q16;
+    int64_t origin_u = ((int64_t)handle->tile_x * MAP_TILES_TILE_SIZE + src_x) << 16;
+    int64_t origin_v = ((int64_t)handle->tile_y * MAP_TILES_TILE_SIZE + src_y) << 16;
+    origin_u += step / 2;
+    origin_v += step / 2;
+    if (filter == MAP_TILES_FILTER_BILINEAR) {
+        origin_u -= 0x8000;
+        origin_v -= 0x8000;
+    }
+    
+    int64_t last_u = origin_u + step * (dst_w - 1);
+    int64_t last_v = origin_v + step * (dst_h - 1);
+    tile_window_t window;
+    if (!tile_window_acquire(handle, &window, origin_u >> 16, origin_v >> 16, (last_u >> 16) + 1, (last_v >> 16) + 1)) {
+        ESP_LOGE(TAG, "Failed to allocate tile window");
+        return false;
+    }
+    
+    // Room for a sentinel column so bilinear seams on the right edge stay in bounds
+    const uint16_t** rows0 = (const uint16_t**)map_tiles_mem_calloc(&handle->memory, MAP_TILES_MEM_SCRATCH, 2 * (window.cols + 1),
+                                                                    sizeof(uint16_t*), 0);
+    if (!rows0) {
+        tile_window_release(handle, &window);
+        ESP_LOGE(TAG, "Failed to allocate row table");
+        return false;
+    }
+    const uint16_t** rows1 = rows0 + window.cols + 1;
+    
+    int64_t first_px = window.first_tx * MAP_TILES_TILE_SIZE;
+    uint16_t* out = (uint16_t*)dst;
+    int out_stride = dst_stride / MAP_TILES_BYTES_PER_PIXEL;
+    int64_t v = origin_v;
+    int64_t cached_py = INT64_MIN;
+    
+    for (int j = 0; j < dst_h; j++, v += step) {
+        int64_t py = v >> 16;
+        if (py != cached_py) {
+            tile_window_rows(&window, py, rows0);
+            if (filter == MAP_TILES_FILTER_BILINEAR) {
+                tile_window_rows(&window, py + 1, rows1);
+            }
+            cached_py = py;
+        }
+        
+        uint16_t* out_row = out + j * out_stride;
+        if (filter == MAP_TILES_FILTER_BILINEAR) {
+            scale_row_bilinear(rows0, rows1, (uint32_t)(v >> 11) & 0x1F, origin_u, step, first_px, out_row, dst_w);
+        } else {
+            scale_row_nearest(rows0, origin_u, step, first_px, out_row, dst_w);
+        }
+    }
+    
+    map_tiles_mem_free(rows0);
+    tile_window_release(handle, &window);
+    return true;
+}
@@ -0,0 +1,156 @@
+#include "map_tiles_internal.h"
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char* TAG = "map_tiles_stats";
+
+#define OVERLAY_DEFAULT_PERIOD_MS 500
+
+void map_tiles_stats_hit(map_tiles_handle_t handle)
+{
+    handle->counters.cache_hits++;
+}
+
+void map_tiles_stats_load(map_tiles_handle_t handle, bool demand, size_t bytes, int64_t elapsed_us)
+{
+    map_tiles_counters_t* counters = &handle->counters;
+    counters->loads++;
+    counters->bytes_read += bytes;
+    counters->load_time_us += (uint64_t)elapsed_us;
+    if (elapsed_us > (int64_t)counters->load_time_peak_us) {
+        counters->load_time_peak_us = (uint32_t)elapsed_us;
+    }
+    if (demand) {
+        counters->cache_misses++;
+    }
+    handle->io_last_us = esp_timer_get_time();
+}
+
+void map_tiles_stats_failure(map_tiles_handle_t handle)
+{
+    handle->counters.load_failures++;
+}
+
+void map_tiles_stats_io(map_tiles_handle_t handle)
+{
+    if (!map_tiles_io_awake(handle)) {
+        handle->counters.io_bursts++;
+    }
+    handle->io_last_us = esp_timer_get_time();
+}
+
+bool map_tiles_get_stats(map_tiles_handle_t handle, map_tiles_stats_t* stats)
+{
+    if (!handle || !handle->initialized || !stats) {
+        ESP_LOGE(TAG, "Handle not initialized");
+        return false;
+    }
+    
+    const map_tiles_counters_t* counters = &handle->counters;
+    memset(stats, 0, sizeof(*stats));
+    stats->loads = counters->loads;
+    stats->load_failures = counters->load_failures;
+    stats->bytes_read = counters->bytes_read;
+    stats->load_time_avg_us = counters->loads ? (uint32_t)(counters->load_time_us / counters->loads) : 0;
+    stats->load_time_peak_us = counters->load_time_peak_us;
+    stats->cache_hits = counters->cache_hits;
+    stats->cache_misses = counters->cache_misses;
+    map_tiles_cache_get_stats(handle->cache, stats, false);
+    stats->requests_pending = map_tiles_requests_pending(handle);
+    stats->preload_pending = map_tiles_preload_pending(handle);
+    
+    // A rate over less than a minute would be mostly noise
+    int64_t elapsed_us = esp_timer_get_time() - counters->since_us;
+    stats->io_bursts = counters->io_bursts;
+    stats->io_bursts_per_min = elapsed_us > 60 * 1000000LL ?
+                               (uint32_t)((uint64_t)counters->io_bursts * 60 * 1000000 / (uint64_t)elapsed_us) :
+                               counters->io_bursts;
+    return true;
+}
+
+void map_tiles_reset_stats(map_tiles_handle_t handle)
+{
+    if (!handle || !handle->initialized) {
+        ESP_LOGE(TAG, "Handle not initialized");
+        return;
+    }
+    
+    map_tiles_stats_t cache_stats;
+    memset(&handle->counters, 0, sizeof(handle->counters));
+    handle->counters.since_us = esp_timer_get_time();
+    map_tiles_cache_get_stats(handle->cache, &cache_stats, true);
+    map_tiles_mem_reset_peaks(&handle->memory);
+    map_tiles_mem_reset_peaks(&handle->cache->memory);
+    if (handle->fetch) {
+        map_tiles_mem_reset_peaks(map_tiles_fetch_memory(handle->fetch));
+    }
+}
+
+static void overlay_refresh(lv_timer_t* timer)
+{
+    lv_obj_t* label = (lv_obj_t*)lv_timer_get_user_data(timer);
+    map_tiles_handle_t handle = (map_tiles_handle_t)lv_obj_get_user_data(label);
+    map_tiles_stats_t stats;
+    map_tiles_memory_t memory;
+    if (!map_tiles_get_stats(handle, &stats) || !map_tiles_get_memory(handle, &memory)) {
+        return;
+    }
+    
+    uint32_t lookups = stats.cache_hits + stats.cache_misses;
+    lv_label_set_text_fmt(label,
+                          "loads %lu (%lu KB), failed %lu\n"
+                          "load %lu.%lu ms avg, %lu.%lu ms peak\n"
+                          "cache %lu%% hits, %lu evicted\n"
+                          "tiles %d/%d, %lu KB PSRAM, %lu KB int\n"
+                          "heap %lu KB, %lu KB peak\n"
+                          "queued %d, preload %d\n"
+                          "I/O bursts %lu, %lu/min",
+                          (unsigned long)stats.loads, (unsigned long)(stats.bytes_read / 1024),
+                          (unsigned long)stats.load_failures,
+                          (unsigned long)(stats.load_time_avg_us / 1000), (unsigned long)(stats.load_time_avg_us % 1000 / 100),
+                          (unsigned long)(stats.load_time_peak_us / 1000), (unsigned long)(stats.load_time_peak_us % 1000 / 100),
+                          (unsigned long)(lookups ? (uint64_t)stats.cache_hits * 100 / lookups : 0),
+                          (unsigned long)stats.cache_evictions,
+                          stats.cache_tiles, stats.cache_capacity,
+                          (unsigned long)(stats.memory_spiram / 1024), (unsigned long)(stats.memory_internal / 1024),
+                          (unsigned long)(memory.total.current / 1024), (unsigned long)(memory.total.peak / 1024),
+                          stats.requests_pending, stats.preload_pending,
+                          (unsigned long)stats.io_bursts, (unsigned long)stats.io_bursts_per_min);
+}
+
+static void overlay_deleted(lv_event_t* e)
+{
+    lv_timer_delete((lv_timer_t*)lv_event_get_user_data(e));
+}
+
+lv_obj_t* map_tiles_stats_overlay_create(map_tiles_handle_t handle, lv_obj_t* parent, uint32_t period_ms)
+{
+    if (!handle || !handle->initialized || !parent) {
+        ESP_LOGE(TAG, "Invalid stats overlay arguments");
+        return NULL;
+    }
+    
+    lv_obj_t* label = lv_label_create(parent);
+    if (!label) {
+        ESP_LOGE(TAG, "Failed to create stats overlay");
+        return NULL;
+    }
+    lv_obj_set_user_data(label, handle);
+    lv_obj_set_style_bg_color(label, lv_color_black(), 0);
+    lv_obj_set_style_bg_opa(label, LV_OPA_50, 0);
+    lv_obj_set_style_text_color(label, lv_color_white(), 0);
+    lv_obj_set_style_pad_all(label, 4, 0);
+    lv_obj_align(label, LV_ALIGN_TOP_LEFT, 0, 0);
+    lv_obj_remove_flag(label, LV_OBJ_FLAG_CLICKABLE);
+    
+    lv_timer_t* timer = lv_timer_create(overlay_refresh, period_ms ? period_ms : OVERLAY_DEFAULT_PERIOD_MS, label);
+    if (!timer) {
+        ESP_LOGE(TAG, "Failed to create stats overlay timer");
+        lv_obj_delete(label);
+        return NULL;
+    }
+    lv_obj_add_event_cb(label, overlay_deleted, LV_EVENT_DELETE, timer);
+    overlay_refresh(timer);
+    return label;
+}
@@ -0,0 +1,172 @@
+#include "map_tiles_internal.h"
+#include <math.h>
+#include "esp_log.h"
+
+static const char* TAG = "map_tiles_transform";
+
+#define FAST_PATH_MIN_ZOOM 8                                        /**< Below this the series error can reach a pixel */
+
+static inline int32_t clamp_i32(int64_t v)
+{
+    return v < INT32_MIN ? INT32_MIN : (v > INT32_MAX ? INT32_MAX : (int32_t)v);
+}
+
+bool map_tiles_get_transform(map_tiles_handle_t handle, int32_t grid_screen_x, int32_t grid_screen_y,
+                             map_tiles_transform_t* transform)
+{
+    if (!handle || !handle->initialized || !transform) {
+        ESP_LOGE(TAG, "Invalid parameters");
+        return false;
+    }
+    
+    int shift = MAP_TILES_MAX_ZOOM - handle->zoom;
+    transform->handle = handle;
+    transform->shift = shift;
+    transform->origin_x = map_tiles_shl((int64_t)handle->tile_x * MAP_TILES_TILE_SIZE - grid_screen_x, shift);
+    transform->origin_y = map_tiles_shl((int64_t)handle->tile_y * MAP_TILES_TILE_SIZE - grid_screen_y, shift);
+    transform->world_width = map_tiles_world_wrap_width(handle);
+    
+    // Anchor the fast path at the grid centre
+    transform->anchor_x = (float)grid_screen_x + handle->grid_cols * (MAP_TILES_TILE_SIZE / 2);
+    transform->anchor_y = (float)grid_screen_y + handle->grid_rows * (MAP_TILES_TILE_SIZE / 2);
+    map_tiles_world_point_t anchor;
+    anchor.x = transform->origin_x + map_tiles_shl((int64_t)transform->anchor_x, shift);
+    anchor.y = transform->origin_y + map_tiles_shl((int64_t)transform->anchor_y, shift);
+    map_tiles_world_to_gps(handle, &anchor, &transform->anchor_lat, &transform->anchor_lon);
+    
+    transform->fast = !handle->projections[handle->current_tile_type].forward && handle->zoom >= FAST_PATH_MIN_ZOOM;
+    if (transform->fast) {
+        // Web Mercator: x is linear in longitude; y and latitude are expanded to
+        // third order around the anchor, with s radians per screen pixel
+        double world_px = ldexp((double)MAP_TILES_TILE_SIZE, handle->zoom);
+        double s = 2.0 * M_PI / world_px;
+        double phi = transform->anchor_lat * M_PI / 180.0;
+        double sec = 1.0 / cos(phi);
+        double tn = tan(phi);
+        
+        transform->x_per_deg = (float)(world_px / 360.0);
+        transform->y_coef[0] = (float)(-sec / s);
+        transform->y_coef[1] = (float)(-sec * tn / s / 2.0);
+        transform->y_coef[2] = (float)(-(sec * tn * tn + sec * sec * sec) / s / 6.0);
+        transform->lat_coef[0] = (float)(-s * cos(phi));
+        transform->lat_coef[1] = (float)(-s * s * sin(phi) * cos(phi) / 2.0);
+        transform->lat_coef[2] = (float)(s * s * s * cos(phi) * cos(2.0 * phi) / 6.0);
+    }
+    return true;
+}
+
+void map_tiles_transform_screen_to_world(const map_tiles_transform_t* transform, const lv_point_t* screen, int count,
+                                         map_tiles_world_point_t* world)
+{
+    if (!transform || !transform->handle || ((!screen || !world) && count > 0)) {
+        ESP_LOGE(TAG, "Invalid parameters");
+        return;
+    }
+    
+    // Pixel centres, so GPS positions derived from a touch round-trip to the same pixel
+    int64_t half = map_tiles_shl(1, transform->shift) / 2;
+    for (int i = 0; i < count; i++) {
+        world[i].x = transform->origin_x + map_tiles_shl(screen[i].x, transform->shift) + half;
+        world[i].y = transform->origin_y + map_tiles_shl(screen[i].y, transform->shift) + half;
+    }
+}
+
+void map_tiles_transform_world_to_screen(const map_tiles_transform_t* transform, const map_tiles_world_point_t* world,
+                                         int count, lv_point_t* screen)
+{
+    if (!transform || !transform->handle || ((!world || !screen) && count > 0)) {
+        ESP_LOGE(TAG, "Invalid parameters");
+        return;
+    }
+    
+    // Offsets are taken from the anchor so points across the antimeridian land next to the view
+    int64_t anchor_dx = map_tiles_shl((int64_t)transform->anchor_x, transform->shift);
+    int64_t anchor_x = transform->origin_x + anchor_dx;
+    for (int i = 0; i < count; i++) {
+        int64_t dx = anchor_dx + map_tiles_wrap_delta(world[i].x - anchor_x, transform->world_width);
+        screen[i].x = clamp_i32(dx >> transform->shift);
+        screen[i].y = clamp_i32((world[i].y - transform->origin_y) >> transform->shift);
+    }
+}
+
+void map_tiles_transform_screen_to_gps(const map_tiles_transform_t* transform, const lv_point_t* screen, int count,
+                                       map_tiles_gps_point_t* gps)
+{
+    if (!transform || !transform->handle || ((!screen || !gps) && count > 0)) {
+        ESP_LOGE(TAG, "Invalid parameters");
+        return;
+    }
+    
+    for (int i = 0; i < count; i++) {
+        map_tiles_world_point_t world;
+        map_tiles_transform_screen_to_world(transform, &screen[i], 1, &world);
+        map_tiles_world_to_gps(transform->handle, &world, &gps[i].lat, &gps[i].lon);
+    }
+}
+
+bool map_tiles_transform_gps_to_screen(const map_tiles_transform_t* transform, const map_tiles_gps_point_t* gps,
+                                       int count, lv_point_t* screen)
+{
+    if (!transform || !transform->handle || ((!gps || !screen) && count > 0)) {
+        ESP_LOGE(TAG, "Invalid parameters");
+        return false;
+    }
+    
+    bool ok = true;
+    for (int i = 0; i < count; i++) {
+        map_tiles_world_point_t world;
+        ok &= map_tiles_gps_to_world_batch(transform->handle, &gps[i], 1, &world);
+        map_tiles_transform_world_to_screen(transform, &world, 1, &screen[i]);
+    }
+    return ok;
+}
+
+void map_tiles_transform_screen_to_gps_fast(const map_tiles_transform_t* transform, const lv_point_t* screen, int count,
+                                            map_tiles_gps_point_t* gps)
+{
+    if (!transform || !transform->fast) {
+        map_tiles_transform_screen_to_gps(transform, screen, count, gps);
+        return;
+    }
+    
+    if ((!screen || !gps) && count > 0) {
+        ESP_LOGE(TAG, "Invalid parameters");
+        return;
+    }
+    
+    const float deg_per_rad = (float)(180.0 / M_PI);
+    for (int i = 0; i < count; i++) {
+        float dx = (float)screen[i].x + 0.5f - transform->anchor_x;
+        float dy = (float)screen[i].y + 0.5f - transform->anchor_y;
+        float dphi = dy * (transform->lat_coef[0] + dy * (transform->lat_coef[1] + dy * transform->lat_coef[2]));
+        
+        double lon = transform->anchor_lon + dx / transform->x_per_deg;
+        gps[i].lon = lon >= 180.0 ? lon - 360.0 : (lon < -180.0 ? lon + 360.0 : lon);
+        gps[i].lat = transform->anchor_lat + dphi * deg_per_rad;
+    }
+}
+
+void map_tiles_transform_gps_to_screen_fast(const map_tiles_transform_t* transform, const map_tiles_gps_point_t* gps,
+                                            int count, lv_point_t* screen)
+{
+    if (!transform || !transform->fast) {
+        map_tiles_transform_gps_to_screen(transform, gps, count, screen);
+        return;
+    }
+    
+    if ((!gps || !screen) && count > 0) {
+        ESP_LOGE(TAG, "Invalid parameters");
+        return;
+    }
+    
+    const float rad_per_deg = (float)(M_PI / 180.0);
+    for (int i = 0; i < count; i++) {
+        // Differences are taken in double, where the absolute coordinates live
+        float dlon = (float)remainder(gps[i].lon - transform->anchor_lon, 360.0);
+        float dphi = (float)(gps[i].lat - transform->anchor_lat) * rad_per_deg;
+        float x = transform->anchor_x + dlon * transform->x_per_deg;
+        float y = transform->anchor_y + dphi * (transform->y_coef[0] + dphi * (transform->y_coef[1] + dphi * transform->y_coef[2]));
+        screen[i].x = (int32_t)floorf(x);
+        screen[i].y = (int32_t)floorf(y);
+    }
+}
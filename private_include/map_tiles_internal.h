@@ -0,0 +1,344 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "map_tiles.h"
+
+/**
+ * @brief Internal declarations shared between the map tiles translation units
+ * 
+ * Nothing in this header is part of the public API.
+ */
+
+#define MAP_TILES_TILE_BYTES (MAP_TILES_TILE_SIZE * MAP_TILES_TILE_SIZE * MAP_TILES_BYTES_PER_PIXEL)
+#define MAP_TILES_TILE_HEADER_SIZE 12
+#define MAP_TILES_TILE_FLAG_CRC 0x0100                              /**< Header flag (LV_IMAGE_FLAGS_USER1): CRC32C trailer follows the pixels */
+#define MAP_TILES_TILE_TRAILER_SIZE 4
+#define MAP_TILES_MAX_LATITUDE 85.0511287798                        /**< Web Mercator latitude limit in degrees */
+#define MAP_TILES_IO_BURST_GAP_US (100 * 1000)                      /**< Tile I/O closer than this to the last belongs to one burst */
+
+/**
+ * @brief Number of tiles along one axis of the world at a zoom level
+ */
+static inline int64_t map_tiles_world_tiles(int zoom)
+{
+    return (int64_t)1 << zoom;
+}
+
+/**
+ * @brief Wrap a tile X coordinate into [0, n)
+ */
+static inline int64_t map_tiles_wrap(int64_t v, int64_t n)
+{
+    v %= n;
+    return v < 0 ? v + n : v;
+}
+
+/**
+ * @brief v * 2^shift, defined for negative v unlike a left shift
+ */
+static inline int64_t map_tiles_shl(int64_t v, int shift)
+{
+    return v * ((int64_t)1 << shift);
+}
+
+/**
+ * @brief Shortest signed step dx around a world of the given width (0: no wrap)
+ */
+static inline int64_t map_tiles_wrap_delta(int64_t dx, int64_t width)
+{
+    return width ? map_tiles_wrap(dx + width / 2, width) - width / 2 : dx;
+}
+
+/**
+ * @brief Current and peak bytes allocated per category, for map_tiles_get_memory()
+ * 
+ * Updated atomically: the loader, the LVGL task and the application may
+ * allocate for the same handle concurrently.
+ */
+typedef struct {
+    size_t current[MAP_TILES_MEM_CATEGORY_COUNT];
+    size_t peak[MAP_TILES_MEM_CATEGORY_COUNT];
+    size_t total;
+    size_t total_peak;
+} map_tiles_mem_account_t;
+
+/**
+ * @brief Identifies one tile of one tile source at one zoom level
+ */
+typedef struct {
+    int32_t source;                                                 /**< Source id registered in the cache */
+    int32_t zoom;
+    int32_t x;
+    int32_t y;
+} map_tiles_key_t;
+
+/**
+ * @brief Cached tile buffer
+ * 
+ * Entries referenced by a grid slot (refs > 0) or being read (loading) are
+ * never evicted, so the image descriptor of a slot can point straight at the buffer.
+ */
+typedef struct {
+    map_tiles_key_t key;
+    uint8_t* buf;
+    uint32_t last_used;                                             /**< Cache tick of the last access, for LRU */
+    uint16_t refs;                                                  /**< Number of grid slots showing this tile */
+    bool valid;                                                     /**< Buffer holds the tile identified by key */
+    bool loading;                                                   /**< Claimed by a reader that has not published yet */
+    bool prefetched;                                                /**< Loaded by preloading and not shown yet */
+} map_tiles_cache_entry_t;
+
+/**
+ * @brief LRU tile cache, private to one handle or shared between several
+ */
+struct map_tiles_cache_t {
+    SemaphoreHandle_t lock;
+    map_tiles_cache_entry_t** entries;
+    int capacity;                                                   /**< Maximum number of tile buffers */
+    int count;                                                      /**< Number of allocated entries */
+    uint32_t tick;
+    bool use_spiram;
+    
+    // Tile sources ("<base_path>/<folder>") known to the cache; the index is the source id
+    char** sources;
+    int source_count;
+    
+    int users;                                                      /**< Attached handles plus the creator's reference */
+    map_tiles_mem_account_t memory;                                 /**< Tile buffers and bookkeeping of the cache */
+    uint32_t evictions;                                             /**< Valid tiles replaced by a claim, for map_tiles_get_stats() */
+};
+
+/**
+ * @brief Eviction policy used when claiming a cache entry
+ */
+typedef enum {
+    MAP_TILES_CLAIM_DEMAND,                                         /**< Visible tile: may evict any unreferenced entry */
+    MAP_TILES_CLAIM_PRELOAD,                                        /**< Preload: never evicts tiles preloaded but not shown yet */
+} map_tiles_claim_t;
+
+/**
+ * @brief Load state of a grid slot
+ */
+typedef struct {
+    map_tiles_tile_status_t status;
+    map_tiles_key_t key;                                            /**< Plain tile last requested for the slot */
+    int attempts;                                                   /**< Failed attempts at key, for the retry backoff */
+    int64_t retry_at;                                               /**< esp_timer time of the next retry of a transient error */
+    int64_t requested_at;                                           /**< esp_timer time the waiting request was first made */
+    bool fetching;                                                  /**< Missing on the card, waiting for the fetcher */
+    bool fetched;                                                   /**< Fetch of key finished, so a further miss is final */
+} map_tiles_slot_t;
+
+/**
+ * @brief Stage of the tile read in progress; each step advances it by at most one stage
+ */
+typedef enum {
+    MAP_TILES_JOB_IDLE,
+    MAP_TILES_JOB_OPEN,                                             /**< Open the tile file */
+    MAP_TILES_JOB_HEADER,                                           /**< Read and check the 12-byte header */
+    MAP_TILES_JOB_READ,                                             /**< Read the pixels, one chunk per step */
+    MAP_TILES_JOB_PUBLISH,                                          /**< Shade if needed, publish and show */
+} map_tiles_job_state_t;
+
+/**
+ * @brief Tile read in progress for map_tiles_process()
+ */
+typedef struct {
+    map_tiles_job_state_t state;
+    int index;                                                      /**< Grid slot, -1 for a preload tile */
+    map_tiles_key_t key;                                            /**< Tile read from storage */
+    map_tiles_key_t show_key;                                       /**< Tile claimed in the cache: the shaded one when hillshading */
+    FILE* f;                                                        /**< Open from the HEADER stage on */
+    map_tiles_cache_entry_t* entry;                                 /**< Claimed unlisted before the first chunk is read */
+    size_t offset;                                                  /**< Pixel bytes read so far */
+    bool truncated;                                                 /**< The file ended early; zero-filled */
+    bool verify;                                                    /**< Check the CRC32C trailer once the pixels are read */
+    uint32_t crc;                                                   /**< CRC32C of the pixels read so far */
+    int64_t busy_us;                                                /**< Time spent in the steps of this read */
+} map_tiles_job_t;
+
+/**
+ * @brief Counters behind map_tiles_get_stats()
+ */
+typedef struct {
+    uint32_t loads;
+    uint32_t load_failures;
+    uint64_t bytes_read;
+    uint64_t load_time_us;                                          /**< Sum over all loads */
+    uint32_t load_time_peak_us;
+    uint32_t cache_hits;
+    uint32_t cache_misses;
+    uint32_t io_bursts;                                             /**< Runs of tile I/O separated by idle storage */
+    int64_t since_us;                                               /**< esp_timer time of map_tiles_init() or the last reset */
+} map_tiles_counters_t;
+
+// Internal structure for map tiles instance
+struct map_tiles_t {
+    // Configuration
+    char* base_path;
+    char* tile_folders[MAP_TILES_MAX_TYPES];
+    int tile_type_count;
+    int current_tile_type;
+    int grid_cols;
+    int grid_rows;
+    int tile_count;
+    int zoom;
+    bool use_spiram;
+    bool initialized;
+    
+    // Tile management
+    int tile_x;
+    int tile_y;
+    int marker_offset_x;
+    int marker_offset_y;
+    bool tile_loading_error;
+    map_tiles_event_cb_t event_cb;                                  /**< NULL when no callback is set */
+    void* event_ctx;
+    
+    // Tile data - arrays will be allocated dynamically based on actual grid size
+    map_tiles_cache_entry_t** tile_entries;
+    lv_image_dsc_t* tile_imgs;
+    map_tiles_cache_handle_t cache;
+    int cache_reserved;                                             /**< Capacity this handle added to the cache */
+    int cache_tiles;                                                /**< Extra tiles of the configuration, part of cache_reserved */
+    int32_t source_ids[MAP_TILES_MAX_TYPES];                        /**< Cache source id of each tile type */
+    map_tiles_projection_t projections[MAP_TILES_MAX_TYPES];        /**< forward == NULL selects Web Mercator */
+    
+    // Hillshading (map_tiles_hillshade.cpp)
+    int32_t dem_source;                                             /**< Cache source id of the DEM folder, -1 without DEM */
+    int dem_max_zoom;
+    int32_t shaded_source_ids[MAP_TILES_MAX_TYPES];                 /**< Cache source ids of shaded tiles, private to the handle */
+    uint8_t* hillshade_lut;                                         /**< Shade per quantised slope, NULL while disabled */
+    float hillshade_z_factor;
+    
+    // Route preloading queue
+    map_tiles_key_t* preload_queue;
+    int preload_count;
+    int preload_next;
+    
+    // Budgeted loading (map_tiles_process.cpp)
+    map_tiles_key_t* requests;                                      /**< Tile requested for each slot */
+    bool* requested;                                                /**< Slot waits for map_tiles_process() */
+    int* request_order;                                             /**< Slots from the grid centre outwards */
+    map_tiles_job_t job;
+    map_tiles_slot_t* slots;                                        /**< Load status of each grid slot */
+    int retry_limit;
+    int retry_delay_ms;
+    int64_t io_burst_us;                                            /**< Longest wait of a request for a burst, 0 to read at once */
+    
+    // Tile integrity
+    bool verify_checksums;
+    map_tiles_key_t quarantine[MAP_TILES_QUARANTINE_SIZE];          /**< Plain tiles that failed a check, never read again */
+    int quarantine_count;
+    int quarantine_next;                                            /**< Ring position of the next entry */
+    
+    // Statistics (map_tiles_stats.cpp)
+    map_tiles_counters_t counters;
+    map_tiles_mem_account_t memory;                                 /**< Everything allocated for the handle except the cache */
+    
+    // Power policy (map_tiles_power.cpp)
+    map_tiles_power_mode_t power_mode;
+    int cache_trimmed;                                              /**< Extra tiles given back to the cache by the power mode */
+    int64_t io_last_us;                                             /**< esp_timer time tile I/O was last seen, 0 before any */
+    
+    // Fetching missing tiles (map_tiles_fetch.cpp)
+    map_tiles_fetch_handle_t fetch;                                 /**< NULL without a fetcher */
+};
+
+// Cache (map_tiles_cache.cpp)
+bool map_tiles_cache_attach(map_tiles_cache_handle_t cache, int tiles);
+void map_tiles_cache_detach(map_tiles_cache_handle_t cache, int tiles);
+bool map_tiles_cache_resize(map_tiles_cache_handle_t cache, int tiles);   // Grow (tiles > 0) or trim the capacity of an attached user
+int32_t map_tiles_cache_register_source(map_tiles_cache_handle_t cache, const char* base_path, const char* folder);
+void map_tiles_cache_unregister_source(map_tiles_cache_handle_t cache, int32_t source);
+int map_tiles_cache_tile_path(map_tiles_cache_handle_t cache, const map_tiles_key_t* key, char* path, size_t size);
+bool map_tiles_cache_contains(map_tiles_cache_handle_t cache, const map_tiles_key_t* key);
+map_tiles_cache_entry_t* map_tiles_cache_get(map_tiles_cache_handle_t cache, const map_tiles_key_t* key);
+bool map_tiles_cache_can_claim(map_tiles_cache_handle_t cache, map_tiles_claim_t policy);
+map_tiles_cache_entry_t* map_tiles_cache_claim(map_tiles_cache_handle_t cache, const map_tiles_key_t* key,
+                                               map_tiles_claim_t policy, bool* existing);
+void map_tiles_cache_publish(map_tiles_cache_handle_t cache, map_tiles_cache_entry_t* entry, bool ok, bool ref);
+// Claim that lookups cannot find until map_tiles_cache_publish_as(), for reads spanning several calls
+map_tiles_cache_entry_t* map_tiles_cache_claim_unlisted(map_tiles_cache_handle_t cache, const map_tiles_key_t* key,
+                                                        map_tiles_claim_t policy, bool* existing);
+map_tiles_cache_entry_t* map_tiles_cache_publish_as(map_tiles_cache_handle_t cache, map_tiles_cache_entry_t* entry,
+                                                    const map_tiles_key_t* key, bool ref);   // May return the copy cached meanwhile
+void map_tiles_cache_unref(map_tiles_cache_handle_t cache, map_tiles_cache_entry_t* entry);
+void map_tiles_cache_invalidate_source(map_tiles_cache_handle_t cache, int32_t source);
+void map_tiles_cache_forget(map_tiles_cache_handle_t cache, map_tiles_cache_entry_t* entry);   // Holders keep the buffer
+void map_tiles_cache_get_stats(map_tiles_cache_handle_t cache, map_tiles_stats_t* stats, bool reset);
+
+// Projections (map_tiles_projection.cpp); u, v are tile units at zoom 0
+bool map_tiles_projection_valid(const map_tiles_projection_t* projection);
+bool map_tiles_project(map_tiles_handle_t handle, int tile_type, double lat, double lon, double* u, double* v);
+void map_tiles_unproject(map_tiles_handle_t handle, int tile_type, double u, double v, double* lat, double* lon);
+int64_t map_tiles_wrap_columns(map_tiles_handle_t handle, int tile_type, int zoom);   // 0 if columns do not wrap
+int64_t map_tiles_world_wrap_width(map_tiles_handle_t handle);     // Current tile type, world units, 0 if no wrap
+bool map_tiles_tile_in_grid(map_tiles_handle_t handle, int tile_type, int zoom, int64_t tile_x, int64_t tile_y);
+double map_tiles_tile_meters(map_tiles_handle_t handle, int tile_type, int zoom, double lat);
+
+// Hillshading (map_tiles_hillshade.cpp)
+bool map_tiles_hillshade_init(map_tiles_handle_t handle, const map_tiles_config_t* config);
+void map_tiles_hillshade_cleanup(map_tiles_handle_t handle);
+bool map_tiles_hillshade_active(map_tiles_handle_t handle);
+void map_tiles_hillshade_apply(map_tiles_handle_t handle, const map_tiles_key_t* key, uint8_t* buf);
+
+// Budgeted loading (map_tiles_process.cpp)
+bool map_tiles_process_init(map_tiles_handle_t handle);
+void map_tiles_process_cleanup(map_tiles_handle_t handle);
+void map_tiles_process_cancel_slot(map_tiles_handle_t handle, int index);
+void map_tiles_slot_status(map_tiles_handle_t handle, int index, const map_tiles_key_t* key, map_tiles_tile_status_t status);
+bool map_tiles_slot_retry_due(map_tiles_handle_t handle, int index, int64_t now);
+
+// Tile integrity (map_tiles_integrity.cpp)
+bool map_tiles_quarantined(map_tiles_handle_t handle, const map_tiles_key_t* key);
+void map_tiles_quarantine_add(map_tiles_handle_t handle, const map_tiles_key_t* key);
+bool map_tiles_check_trailer(map_tiles_handle_t handle, FILE* f, const map_tiles_key_t* key, uint32_t crc);   // Quarantines on mismatch
+map_tiles_tile_status_t map_tiles_read_pixels(map_tiles_handle_t handle, FILE* f, const map_tiles_key_t* key,
+                                              bool verify, uint8_t* buf);   // Closes f
+
+// Statistics (map_tiles_stats.cpp)
+void map_tiles_stats_hit(map_tiles_handle_t handle);                // Grid tile shown from the cache
+void map_tiles_stats_load(map_tiles_handle_t handle, bool demand, size_t bytes, int64_t elapsed_us);   // demand: a grid tile, counts a miss
+void map_tiles_stats_failure(map_tiles_handle_t handle);
+void map_tiles_stats_io(map_tiles_handle_t handle);                 // Tile I/O starts, counts a burst if storage was idle
+
+// Power policy (map_tiles_power.cpp)
+bool map_tiles_io_awake(map_tiles_handle_t handle);                 // Storage is still within a burst
+bool map_tiles_power_allows_preload(map_tiles_handle_t handle);     // false pauses route preloading
+bool map_tiles_power_skips_preload(map_tiles_handle_t handle, const map_tiles_key_t* key);   // Route tile outside the prefetch radius
+
+// Accounted allocation (map_tiles_memory.cpp). Each block records its account,
+// category and size, so map_tiles_mem_free() needs none of them. caps 0
+// allocates like malloc().
+void* map_tiles_mem_alloc(map_tiles_mem_account_t* account, map_tiles_mem_category_t category, size_t size, uint32_t caps);
+void* map_tiles_mem_calloc(map_tiles_mem_account_t* account, map_tiles_mem_category_t category, size_t n, size_t size,
+                           uint32_t caps);
+void* map_tiles_mem_realloc(map_tiles_mem_account_t* account, map_tiles_mem_category_t category, void* ptr, size_t size);
+char* map_tiles_mem_strdup(map_tiles_mem_account_t* account, map_tiles_mem_category_t category, const char* s);
+void map_tiles_mem_free(void* ptr);                                 // NULL is ignored
+void map_tiles_mem_assign(void* ptr, map_tiles_mem_account_t* account);   // Charge a block allocated before its account existed
+void map_tiles_mem_reset_peaks(map_tiles_mem_account_t* account);
+
+// Fetching missing tiles (map_tiles_fetch.cpp)
+bool map_tiles_fetch_missing(map_tiles_handle_t handle, const map_tiles_key_t* key, bool demand);   // false without a fetcher or queue room
+bool map_tiles_fetch_waiting(map_tiles_handle_t handle, const map_tiles_key_t* key);                 // Queued or being fetched
+map_tiles_mem_account_t* map_tiles_fetch_memory(map_tiles_fetch_handle_t fetch);                    // Account of the fetcher and its backend
+
+// Route preloading (map_tiles_preload.cpp)
+bool map_tiles_preload_next(map_tiles_handle_t handle, map_tiles_key_t* key);   // Next tile to read, false to pause
+
+// Tile file access (map_tiles.cpp)
+bool map_tiles_make_key(map_tiles_handle_t handle, int tile_type, int zoom, int tile_x, int tile_y, map_tiles_key_t* key);
+bool map_tiles_shown_key(map_tiles_handle_t handle, const map_tiles_key_t* key, map_tiles_key_t* show_key);   // true if shaded
+void map_tiles_set_slot_entry(map_tiles_handle_t handle, int index, map_tiles_cache_entry_t* entry);   // Raises TILE_LOADED on change
+void map_tiles_notify(map_tiles_handle_t handle, map_tiles_event_type_t type, int index, int zoom, int tile_x, int tile_y);
+int map_tiles_build_path(map_tiles_handle_t handle, const map_tiles_key_t* key, char* path, size_t size);
+FILE* map_tiles_open_tile(map_tiles_handle_t handle, const map_tiles_key_t* key);   // Positioned at the pixel data
+FILE* map_tiles_open_file(map_tiles_handle_t handle, const map_tiles_key_t* key);   // Positioned at the header
+bool map_tiles_check_header(FILE* f, const map_tiles_key_t* key, bool* has_crc);   // Reads the header of an RGB565 map tile
+bool map_tiles_read_tile(FILE* f, uint8_t* buf);                   // Reads the pixel data and closes f
@@ -8,6 +8,9 @@ from PIL import Image  # pip install pillow
 # No implicit defaults; these are set from CLI in main()
 INPUT_ROOT = None
 OUTPUT_ROOT = None
+DEM_ENCODING = None  # "terrarium" or "terrain-rgb" converts elevation tiles
+OVERLAY_FORMAT = None  # "i8" or "a8" converts transparent overlay tiles
+CHECKSUM = False  # append a CRC32C trailer to map tiles
 
 
 # Convert RGB to 16-bit RGB565
@@ -15,6 +18,24 @@ def to_rgb565(r, g, b):
     return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3)
 
 
+# CRC32C (Castagnoli) table, reflected polynomial 0x82F63B78
+_CRC32C_TABLE = []
+for _i in range(256):
+    _c = _i
+    for _ in range(8):
+        _c = (_c >> 1) ^ 0x82F63B78 if _c & 1 else _c >> 1
+    _CRC32C_TABLE.append(_c)
+
+
+# CRC32C of data, as checked by the component with verify_checksums
+def crc32c(data):
+    crc = 0xFFFFFFFF
+    table = _CRC32C_TABLE
+    for byte in data:
+        crc = table[(crc ^ byte) & 0xFF] ^ (crc >> 8)
+    return crc ^ 0xFFFFFFFF
+
+
 # Strip .png or .bin extensions
 def clean_tile_name(filename):
     name = filename
@@ -33,7 +54,7 @@ def make_lvgl_bin(png_path, bin_path):
     pixels = im.load()
 
     stride = (w * 16 + 7) // 8  # bytes per row (RGB565 = 16 bpp)
-    flags = 0x00               # no compression, no premult
+    flags = 0x0100 if CHECKSUM else 0x00  # LV_IMAGE_FLAGS_USER1: CRC32C trailer follows
     color_format = 0x12        # RGB565
     magic = 0x19
 
@@ -63,11 +84,96 @@ def make_lvgl_bin(png_path, bin_path):
     with open(bin_path, "wb") as f:
         f.write(header)
         f.write(body)
+        if CHECKSUM:
+            f.write(struct.pack("<I", crc32c(body)))
 
     print(f"[OK] {png_path} → {bin_path}")
 
 
-# Yield (input_path, output_path) pairs for all PNG tiles under INPUT_ROOT
+# Decode an RGB-encoded elevation pixel to metres
+def decode_height(r, g, b):
+    if DEM_ENCODING == "terrarium":
+        return r * 256 + g + b / 256 - 32768
+    return -10000 + (r * 65536 + g * 256 + b) * 0.1  # Mapbox terrain-rgb
+
+
+# Create an elevation .bin: same header, raw little-endian int16 metres
+def make_dem_bin(png_path, bin_path):
+    im = Image.open(png_path).convert("RGB")
+    w, h = im.size
+    pixels = im.load()
+
+    header = bytearray()
+    header += struct.pack("<B", 0x19)   # magic
+    header += struct.pack("<B", 0x00)   # no LVGL color format: not an image
+    header += struct.pack("<H", 0)      # flags
+    header += struct.pack("<H", w)
+    header += struct.pack("<H", h)
+    header += struct.pack("<H", w * 2)  # stride
+    header += struct.pack("<H", 0)      # reserved
+
+    body = bytearray()
+    for y in range(h):
+        for x in range(w):
+            height = round(decode_height(*pixels[x, y]))
+            body += struct.pack("<h", max(-32768, min(32767, height)))
+
+    os.makedirs(os.path.dirname(bin_path), exist_ok=True)
+    with open(bin_path, "wb") as f:
+        f.write(header)
+        f.write(body)
+
+    print(f"[OK] {png_path} → {bin_path} (elevation)")
+
+
+# Create an overlay .bin: LVGL I8 (palette + indices) or A8 (alpha only)
+def make_overlay_bin(png_path, bin_path):
+    im = Image.open(png_path).convert("RGBA")
+    w, h = im.size
+
+    if OVERLAY_FORMAT == "i8":
+        # Fast octree quantisation keeps the alpha channel in the palette
+        quantized = im.quantize(colors=256, method=Image.Quantize.FASTOCTREE)
+        palette = quantized.getpalette(rawmode="RGBA") or []
+        palette += [0] * (1024 - len(palette))
+        color_format = 0x0A  # I8
+        body = bytearray()
+        for i in range(256):
+            r, g, b, a = palette[i * 4:i * 4 + 4]
+            body += struct.pack("<BBBB", b, g, r, a)  # lv_color32_t order
+        body += quantized.tobytes()
+    else:
+        color_format = 0x0E  # A8
+        body = bytearray(im.getchannel("A").tobytes())
+
+    header = bytearray()
+    header += struct.pack("<B", 0x19)  # magic
+    header += struct.pack("<B", color_format)
+    header += struct.pack("<H", 0)     # flags
+    header += struct.pack("<H", w)
+    header += struct.pack("<H", h)
+    header += struct.pack("<H", w)     # stride: one byte per pixel
+    header += struct.pack("<H", 0)     # reserved
+
+    os.makedirs(os.path.dirname(bin_path), exist_ok=True)
+    with open(bin_path, "wb") as f:
+        f.write(header)
+        f.write(body)
+
+    print(f"[OK] {png_path} → {bin_path} ({OVERLAY_FORMAT})")
+
+
+def convert_tile(png_path, bin_path):
+    if DEM_ENCODING:
+        make_dem_bin(png_path, bin_path)
+    elif OVERLAY_FORMAT:
+        make_overlay_bin(png_path, bin_path)
+    else:
+        make_lvgl_bin(png_path, bin_path)
+
+
+# Yield (input_path, output_path) pairs for all PNG tiles under INPUT_ROOT,
+# including time-series tiles laid out as zoom/x/y/time.png
 def _iter_tile_paths():
     for zoom in sorted(os.listdir(INPUT_ROOT)):
         zoom_path = os.path.join(INPUT_ROOT, zoom)
@@ -80,6 +186,16 @@ def _iter_tile_paths():
                 continue
 
             for y_file in sorted(os.listdir(x_path)):
+                y_path = os.path.join(x_path, y_file)
+                if os.path.isdir(y_path) and y_file.isdigit():
+                    for t_file in sorted(os.listdir(y_path)):
+                        if t_file.lower().endswith(".png"):
+                            input_path = os.path.join(y_path, t_file)
+                            output_path = os.path.join(OUTPUT_ROOT, zoom, x_tile, y_file,
+                                                       f"{clean_tile_name(t_file)}.bin")
+                            yield input_path, output_path
+                    continue
+
                 if not y_file.lower().endswith(".png"):
                     continue
 
@@ -117,7 +233,7 @@ def convert_all_tiles(jobs=1, force=False):
         # Serial path
         for inp, outp in tasks:
             try:
-                make_lvgl_bin(inp, outp)
+                convert_tile(inp, outp)
             except Exception as e:
                 print(f"[Error] Failed to convert {inp} → {e}")
         return
@@ -125,7 +241,7 @@ def convert_all_tiles(jobs=1, force=False):
     # Threaded path
     print_lock = threading.Lock()
     with ThreadPoolExecutor(max_workers=jobs) as ex:
-        future_map = {ex.submit(make_lvgl_bin, inp, outp): (inp, outp) for inp, outp in tasks}
+        future_map = {ex.submit(convert_tile, inp, outp): (inp, outp) for inp, outp in tasks}
         for fut in as_completed(future_map):
             inp, outp = future_map[fut]
             try:
@@ -163,6 +279,23 @@ if __name__ == "__main__":
         action="store_true",
         help="Rebuild even if output file already exists",
     )
+    parser.add_argument(
+        "--dem",
+        choices=["terrarium", "terrain-rgb"],
+        default=argparse.SUPPRESS,  # hide '(default: None)'
+        help="Input tiles are RGB-encoded elevation; write int16 height tiles for hillshading",
+    )
+    parser.add_argument(
+        "--overlay",
+        choices=["i8", "a8"],
+        default=argparse.SUPPRESS,  # hide '(default: None)'
+        help="Input tiles are transparent overlays (e.g. radar); write compact I8 or A8 tiles",
+    )
+    parser.add_argument(
+        "--checksum",
+        action="store_true",
+        help="Append a CRC32C of the pixel data to each map tile for integrity checks",
+    )
 
     args = parser.parse_args()
 
@@ -174,5 +307,12 @@ if __name__ == "__main__":
     # Apply CLI values
     INPUT_ROOT = args.input
     OUTPUT_ROOT = args.output
+    DEM_ENCODING = getattr(args, "dem", None)
+    OVERLAY_FORMAT = getattr(args, "overlay", None)
+    CHECKSUM = args.checksum
+    if DEM_ENCODING and OVERLAY_FORMAT:
+        parser.error("--dem and --overlay cannot be combined")
+    if CHECKSUM and (DEM_ENCODING or OVERLAY_FORMAT):
+        parser.error("--checksum applies to map tiles only")
 
     convert_all_tiles(jobs=max(1, args.jobs), force=args.force)
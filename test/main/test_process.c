@@ -0,0 +1,83 @@
+#include "unity.h"
+#include "map_tiles.h"
+#include "test_tiles.h"
+
+static map_tiles_handle_t init_view(map_tiles_cache_handle_t cache)
+{
+    map_tiles_config_t config = {
+        .base_path = TEST_BASE_PATH,
+        .tile_folders = { "street" },
+        .tile_type_count = 1,
+        .grid_cols = 3,
+        .grid_rows = 3,
+        .default_zoom = TEST_ZOOM,
+        .cache_tiles = 2,
+        .shared_cache = cache,
+    };
+    map_tiles_handle_t handle = map_tiles_init(&config);
+    TEST_ASSERT_NOT_NULL(handle);
+    return handle;
+}
+
+/**
+ * @brief Step the centre slot's read until its first chunk is in a cache buffer
+ */
+static void start_centre_read(map_tiles_handle_t handle)
+{
+    TEST_ASSERT_TRUE(map_tiles_request_tile(handle, 4, TEST_X, TEST_Y));
+    
+    // Start, open, header, first chunk
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL(MAP_TILES_STEP_BUSY, map_tiles_process_step(handle));
+    }
+    TEST_ASSERT_EQUAL(1, map_tiles_requests_pending(handle));
+}
+
+static void finish_reads(map_tiles_handle_t handle)
+{
+    for (int i = 0; i < 1000 && map_tiles_requests_pending(handle) > 0; i++) {
+        map_tiles_process_step(handle);
+    }
+    TEST_ASSERT_EQUAL(0, map_tiles_requests_pending(handle));
+}
+
+TEST_CASE("synchronous load of a tile the budgeted loader is reading", "[process]")
+{
+    test_write_street_tile(TEST_ZOOM, TEST_X, TEST_Y, 0x1234);
+    map_tiles_handle_t handle = init_view(NULL);
+    start_centre_read(handle);
+    
+    // Same task, same tile, another slot: must not wait for the read in progress
+    TEST_ASSERT_TRUE(map_tiles_load_tile(handle, 0, TEST_X, TEST_Y));
+    TEST_ASSERT_TRUE(map_tiles_request_tile(handle, 1, TEST_X, TEST_Y));
+    finish_reads(handle);
+    
+    // All three slots show the one cached copy
+    uint16_t* pixels = (uint16_t*)map_tiles_get_buffer(handle, 4);
+    TEST_ASSERT_NOT_NULL(pixels);
+    TEST_ASSERT_EQUAL_HEX16(0x1234, pixels[MAP_TILES_TILE_SIZE * MAP_TILES_TILE_SIZE - 1]);
+    TEST_ASSERT_EQUAL_PTR(map_tiles_get_buffer(handle, 0), pixels);
+    TEST_ASSERT_EQUAL_PTR(map_tiles_get_buffer(handle, 1), pixels);
+    
+    map_tiles_cleanup(handle);
+}
+
+TEST_CASE("view on a shared cache loads a tile another view is reading", "[process]")
+{
+    test_write_street_tile(TEST_ZOOM, TEST_X, TEST_Y, 0x5678);
+    map_tiles_cache_config_t cache_config = { .capacity_tiles = 0 };
+    map_tiles_cache_handle_t cache = map_tiles_cache_create(&cache_config);
+    TEST_ASSERT_NOT_NULL(cache);
+    map_tiles_handle_t reader = init_view(cache);
+    map_tiles_handle_t other = init_view(cache);
+    
+    start_centre_read(reader);
+    TEST_ASSERT_TRUE(map_tiles_load_tile(other, 4, TEST_X, TEST_Y));
+    finish_reads(reader);
+    
+    TEST_ASSERT_EQUAL_PTR(map_tiles_get_buffer(other, 4), map_tiles_get_buffer(reader, 4));
+    
+    map_tiles_cleanup(reader);
+    map_tiles_cleanup(other);
+    map_tiles_cache_destroy(cache);
+}
@@ -0,0 +1,92 @@
+#include <stdlib.h>
+#include <string.h>
+#include "unity.h"
+#include "map_tiles.h"
+#include "test_tiles.h"
+
+#define TEST_STREET_COLOUR 0xFFFF
+
+/**
+ * @brief Load a hillshaded view of one white tile on a slope rising to the east
+ */
+static map_tiles_handle_t init_shaded_view(map_tiles_cache_handle_t cache)
+{
+    uint16_t heights[MAP_TILES_TILE_SIZE];
+    for (int i = 0; i < MAP_TILES_TILE_SIZE; i++) {
+        heights[i] = (uint16_t)(i * 20);
+    }
+    test_write_street_tile(TEST_ZOOM, TEST_X, TEST_Y, TEST_STREET_COLOUR);
+    test_write_tile("dem", TEST_ZOOM, TEST_X, TEST_Y, heights);
+    
+    map_tiles_config_t config = {
+        .base_path = TEST_BASE_PATH,
+        .tile_folders = { "street" },
+        .tile_type_count = 1,
+        .grid_cols = 1,
+        .grid_rows = 1,
+        .default_zoom = TEST_ZOOM,
+        .cache_tiles = 2,
+        .dem_folder = "dem",
+        .dem_max_zoom = TEST_ZOOM,
+        .shared_cache = cache,
+    };
+    map_tiles_handle_t handle = map_tiles_init(&config);
+    TEST_ASSERT_NOT_NULL(handle);
+    map_tiles_hillshade_config_t sun = { .azimuth_deg = 315, .altitude_deg = 45, .z_factor = 1, .strength = 200 };
+    TEST_ASSERT_TRUE(map_tiles_set_hillshade(handle, &sun));
+    map_tiles_set_position(handle, TEST_X, TEST_Y);
+    TEST_ASSERT_TRUE(map_tiles_load_tile(handle, 0, TEST_X, TEST_Y));
+    return handle;
+}
+
+TEST_CASE("viewport renders hillshaded tiles as the grid shows them", "[render]")
+{
+    map_tiles_handle_t handle = init_shaded_view(NULL);
+    const uint16_t* shown = (const uint16_t*)map_tiles_get_buffer(handle, 0);
+    TEST_ASSERT_NOT_NULL(shown);
+    int centre = MAP_TILES_TILE_SIZE * (MAP_TILES_TILE_SIZE / 2) + MAP_TILES_TILE_SIZE / 2;
+    TEST_ASSERT_NOT_EQUAL(TEST_STREET_COLOUR, shown[centre]);
+    
+    size_t size = MAP_TILES_TILE_SIZE * MAP_TILES_TILE_SIZE * sizeof(uint16_t);
+    uint16_t* dst = (uint16_t*)malloc(size);
+    TEST_ASSERT_NOT_NULL(dst);
+    
+    memset(dst, 0, size);
+    TEST_ASSERT_TRUE(map_tiles_render_viewport(handle, 0, 0, (uint8_t*)dst, MAP_TILES_TILE_SIZE,
+                                               MAP_TILES_TILE_SIZE, MAP_TILES_TILE_SIZE * 2));
+    TEST_ASSERT_EQUAL_MEMORY(shown, dst, size);
+    
+    memset(dst, 0, size);
+    TEST_ASSERT_TRUE(map_tiles_render_viewport_scaled(handle, 0, 0, MAP_TILES_SCALE_ONE, MAP_TILES_FILTER_NEAREST,
+                                                      (uint8_t*)dst, MAP_TILES_TILE_SIZE,
+                                                      MAP_TILES_TILE_SIZE, MAP_TILES_TILE_SIZE * 2));
+    TEST_ASSERT_EQUAL_MEMORY(shown, dst, size);
+    
+    free(dst);
+    map_tiles_cleanup(handle);
+}
+
+TEST_CASE("shared cache drops the shading of views that are gone", "[render]")
+{
+    map_tiles_cache_config_t cache_config = { .capacity_tiles = 0 };
+    map_tiles_cache_handle_t cache = map_tiles_cache_create(&cache_config);
+    TEST_ASSERT_NOT_NULL(cache);
+    
+    // Measured through a view that stays, once the cache has filled its capacity
+    map_tiles_handle_t shaded = init_shaded_view(cache);
+    for (int i = 0; i < 4; i++) {
+        map_tiles_cleanup(init_shaded_view(cache));
+    }
+    map_tiles_memory_t before;
+    TEST_ASSERT_TRUE(map_tiles_get_memory(shaded, &before));
+    
+    for (int i = 0; i < 4; i++) {
+        map_tiles_cleanup(init_shaded_view(cache));
+    }
+    map_tiles_memory_t after;
+    TEST_ASSERT_TRUE(map_tiles_get_memory(shaded, &after));
+    TEST_ASSERT_EQUAL(before.categories[MAP_TILES_MEM_CACHE].current, after.categories[MAP_TILES_MEM_CACHE].current);
+    
+    map_tiles_cleanup(shaded);
+    map_tiles_cache_destroy(cache);
+}
@@ -0,0 +1,40 @@
+#include <stdio.h>
+#include <sys/stat.h>
+#include "unity.h"
+#include "map_tiles.h"
+#include "test_tiles.h"
+
+void test_write_tile(const char* folder, int zoom, int x, int y, const uint16_t* row)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "%s", TEST_BASE_PATH);
+    mkdir(path, 0755);
+    snprintf(path, sizeof(path), "%s/%s", TEST_BASE_PATH, folder);
+    mkdir(path, 0755);
+    snprintf(path, sizeof(path), "%s/%s/%d", TEST_BASE_PATH, folder, zoom);
+    mkdir(path, 0755);
+    snprintf(path, sizeof(path), "%s/%s/%d/%d", TEST_BASE_PATH, folder, zoom, x);
+    mkdir(path, 0755);
+    snprintf(path, sizeof(path), "%s/%s/%d/%d/%d.bin", TEST_BASE_PATH, folder, zoom, x, y);
+    
+    FILE* f = fopen(path, "wb");
+    TEST_ASSERT_NOT_NULL(f);
+    uint8_t header[12] = { 0x19, 0x12, 0, 0,
+                           MAP_TILES_TILE_SIZE & 0xFF, MAP_TILES_TILE_SIZE >> 8,
+                           MAP_TILES_TILE_SIZE & 0xFF, MAP_TILES_TILE_SIZE >> 8,
+                           (MAP_TILES_TILE_SIZE * 2) & 0xFF, (MAP_TILES_TILE_SIZE * 2) >> 8, 0, 0 };
+    fwrite(header, 1, sizeof(header), f);
+    for (int i = 0; i < MAP_TILES_TILE_SIZE; i++) {
+        fwrite(row, sizeof(uint16_t), MAP_TILES_TILE_SIZE, f);
+    }
+    fclose(f);
+}
+
+void test_write_street_tile(int zoom, int x, int y, uint16_t colour)
+{
+    uint16_t row[MAP_TILES_TILE_SIZE];
+    for (int i = 0; i < MAP_TILES_TILE_SIZE; i++) {
+        row[i] = colour;
+    }
+    test_write_tile("street", zoom, x, y, row);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifndef TEST_BASE_PATH
+#define TEST_BASE_PATH "/tmp/map_tiles_test"
+#endif
+
+#define TEST_ZOOM 10
+#define TEST_X 163
+#define TEST_Y 395
+
+/**
+ * @brief Write one 256x256 tile of 16-bit values with every row equal to row
+ * 
+ * @param folder Tile folder under TEST_BASE_PATH, e.g. "street" or "dem"
+ * @param zoom Zoom level
+ * @param x Tile X coordinate
+ * @param y Tile Y coordinate
+ * @param row MAP_TILES_TILE_SIZE RGB565 colours or elevations in metres
+ */
+void test_write_tile(const char* folder, int zoom, int x, int y, const uint16_t* row);
+
+/**
+ * @brief Write one RGB565 street tile filled with a single colour
+ */
+void test_write_street_tile(int zoom, int x, int y, uint16_t colour);